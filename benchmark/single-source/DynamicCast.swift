@@ -0,0 +1,85 @@
+//===--- DynamicCast.swift ------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the performance of conditional casts out of a
+// heterogeneous [Any], the way a JSON encoder walks its input. The same few
+// (source type, target type) pairs are cast over and over, both to concrete
+// types and to protocol existentials.
+import TestsUtils
+
+protocol DCJSONValue {
+  func jsonWeight() -> Int
+}
+
+struct DCPoint : DCJSONValue {
+  var x: Int
+  var y: Int
+
+  func jsonWeight() -> Int {
+    return x + y
+  }
+}
+
+enum DCColor : DCJSONValue {
+  case Red, Green, Blue
+
+  func jsonWeight() -> Int {
+    return 1
+  }
+}
+
+struct DCOpaque {
+  var value: Int
+}
+
+@inline(never)
+func makeDynamicCastValues() -> [Any] {
+  var values: [Any] = []
+  for i in 0..<100 {
+    switch i % 6 {
+    case 0: values.append(i)
+    case 1: values.append(String(i))
+    case 2: values.append(Double(i))
+    case 3: values.append(DCPoint(x: i, y: 1))
+    case 4: values.append(DCColor.Green)
+    default: values.append(DCOpaque(value: i))
+    }
+  }
+  return values
+}
+
+@inline(never)
+func weighDynamicCastValues(values: [Any]) -> Int {
+  var total = 0
+  for value in values {
+    if let i = value as? Int {
+      total += i
+    } else if let s = value as? String {
+      total += s.utf8.count
+    } else if let d = value as? Double {
+      total += Int(d)
+    } else if let v = value as? DCJSONValue {
+      total += v.jsonWeight()
+    }
+  }
+  return total
+}
+
+@inline(never)
+public func run_DynamicCast(N: Int) {
+  let values = makeDynamicCastValues()
+  var total = 0
+  for _ in 0..<(N * 1000) {
+    total = weighDynamicCastValues(values)
+  }
+  CheckResults(total == 2598, "Incorrect results in DynamicCast")
+}
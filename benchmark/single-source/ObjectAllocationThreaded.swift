@@ -0,0 +1,113 @@
+//===--- ObjectAllocationThreaded.swift -----------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the throughput of small object allocations when several
+// threads allocate and free at the same time. Each thread runs the same
+// allocation-heavy loop, so the total work grows with the thread count;
+// compare scores across the variants to see how allocation scales.
+import Dispatch
+import TestsUtils
+
+final class TXX {
+  var xx: Int
+
+  init(_ x: Int) {
+    xx = x
+  }
+}
+
+final class TTreeNode {
+  let left: TXX
+  let right: TXX
+
+  init(_ l: TXX, _ r: TXX) {
+    left = l
+    right = r
+  }
+}
+
+final class TLinkedNode {
+  var next: TLinkedNode?
+  var xx: Int
+
+  init(_ x: Int, _ n: TLinkedNode?) {
+    xx = x
+    next = n
+  }
+}
+
+@inline(never)
+func addTreeInts(t: TTreeNode) -> Int {
+  return t.left.xx + t.right.xx
+}
+
+@inline(never)
+func addListInts(n: TLinkedNode) -> Int {
+  var s = 0
+  var iter: TLinkedNode? = n
+  while let iter2 = iter {
+     s += iter2.xx
+     iter = iter2.next
+  }
+  return s
+}
+
+@inline(never)
+func allocateOnOneThread() -> Int {
+  var s = 0
+  for i in 0..<300 {
+    let t = TTreeNode(TXX(i), TXX(i + 1))
+    s += addTreeInts(t)
+  }
+  for i in 0..<250 {
+    let l = TLinkedNode(i, TLinkedNode(27, TLinkedNode(42, nil)))
+    s += addListInts(l)
+  }
+  return s
+}
+
+func runAllocation(N: Int, threads: Int) {
+  let results = UnsafeMutablePointer<Int>.alloc(threads)
+  let queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0)
+
+  for _ in 0..<N {
+    dispatch_apply(threads, queue) { t in
+      results[t] = allocateOnOneThread()
+    }
+  }
+
+  for t in 0..<threads {
+    CheckResults(results[t] == 138375,
+                 "Incorrect results in ObjectAllocationThreaded")
+  }
+  results.dealloc(threads)
+}
+
+@inline(never)
+public func run_ObjectAllocationThreads1(N: Int) {
+  runAllocation(N, threads: 1)
+}
+
+@inline(never)
+public func run_ObjectAllocationThreads2(N: Int) {
+  runAllocation(N, threads: 2)
+}
+
+@inline(never)
+public func run_ObjectAllocationThreads4(N: Int) {
+  runAllocation(N, threads: 4)
+}
+
+@inline(never)
+public func run_ObjectAllocationThreads8(N: Int) {
+  runAllocation(N, threads: 8)
+}
@@ -0,0 +1,98 @@
+//===--- TypeNameThreaded.swift -------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+// This test checks the throughput of type name lookups when several threads
+// ask for the names of the same types at the same time, as logging code
+// does. Each thread does the same number of lookups, so the total work grows
+// with the thread count; compare scores across the variants to see how the
+// runtime's type name cache scales.
+import Dispatch
+import TestsUtils
+
+struct TNPoint<T> {
+  var x: T
+  var y: T
+}
+
+class TNBox<T> {
+  var value: T
+
+  init(_ v: T) {
+    value = v
+  }
+}
+
+let typeNameTypes: [Any.Type] = [
+  Int.self,
+  String.self,
+  Array<Int>.self,
+  Dictionary<String, [Int]>.self,
+  Optional<Set<Int>>.self,
+  TNPoint<Double>.self,
+  TNBox<TNPoint<Int>>.self,
+  (Int, String, Bool).self,
+]
+
+@inline(never)
+func lookUpTypeNames(expected: [String]) -> Int {
+  var matches = 0
+  for _ in 0..<50 {
+    for (i, type) in typeNameTypes.enumerate() {
+      if _typeName(type, qualified: i % 2 == 0) == expected[i] {
+        matches += 1
+      }
+    }
+  }
+  return matches
+}
+
+func runTypeNames(N: Int, threads: Int) {
+  var expected: [String] = []
+  for (i, type) in typeNameTypes.enumerate() {
+    expected.append(_typeName(type, qualified: i % 2 == 0))
+  }
+
+  let results = UnsafeMutablePointer<Int>.alloc(threads)
+  let queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0)
+
+  for _ in 0..<N {
+    dispatch_apply(threads, queue) { t in
+      results[t] = lookUpTypeNames(expected)
+    }
+  }
+
+  for t in 0..<threads {
+    CheckResults(results[t] == 50 * typeNameTypes.count,
+                 "Incorrect results in TypeNameThreaded")
+  }
+  results.dealloc(threads)
+}
+
+@inline(never)
+public func run_TypeNameThreads1(N: Int) {
+  runTypeNames(N, threads: 1)
+}
+
+@inline(never)
+public func run_TypeNameThreads2(N: Int) {
+  runTypeNames(N, threads: 2)
+}
+
+@inline(never)
+public func run_TypeNameThreads4(N: Int) {
+  runTypeNames(N, threads: 4)
+}
+
+@inline(never)
+public func run_TypeNameThreads8(N: Int) {
+  runTypeNames(N, threads: 8)
+}
@@ -45,6 +45,7 @@ import DictionaryBridge
 import DictionaryLiteral
 import DictionaryRemove
 import DictionarySwap
+import DynamicCast
 import ErrorHandling
 import Fibonacci
 import GlobalClass
@@ -63,6 +64,7 @@ import NSError
 import NSStringConversion
 import NopDeinit
 import ObjectAllocation
+import ObjectAllocationThreaded
 import OpenClose
 import Phonebook
 import PolymorphicCalls
@@ -90,6 +92,7 @@ import StringWalk
 import SuperChars
 import TwoSum
 import TypeFlood
+import TypeNameThreaded
 import Walsh
 import XorLoop
 
@@ -123,6 +126,7 @@ precommitTests = [
   "DictionaryLiteral": run_DictionaryLiteral,
   "DictionaryRemove": run_DictionaryRemove,
   "DictionarySwap": run_DictionarySwap,
+  "DynamicCast": run_DynamicCast,
   "ErrorHandling": run_ErrorHandling,
   "GlobalClass": run_GlobalClass,
   "Hanoi": run_Hanoi,
@@ -140,6 +144,10 @@ precommitTests = [
   "NSStringConversion": run_NSStringConversion,
   "NopDeinit": run_NopDeinit,
   "ObjectAllocation": run_ObjectAllocation,
+  "ObjectAllocationThreads1": run_ObjectAllocationThreads1,
+  "ObjectAllocationThreads2": run_ObjectAllocationThreads2,
+  "ObjectAllocationThreads4": run_ObjectAllocationThreads4,
+  "ObjectAllocationThreads8": run_ObjectAllocationThreads8,
   "OpenClose": run_OpenClose,
   "Phonebook": run_Phonebook,
   "PolymorphicCalls": run_PolymorphicCalls,
@@ -171,6 +179,10 @@ precommitTests = [
   "SuperChars": run_SuperChars,
   "TwoSum": run_TwoSum,
   "TypeFlood": run_TypeFlood,
+  "TypeNameThreads1": run_TypeNameThreads1,
+  "TypeNameThreads2": run_TypeNameThreads2,
+  "TypeNameThreads4": run_TypeNameThreads4,
+  "TypeNameThreads8": run_TypeNameThreads8,
   "Walsh": run_Walsh,
   "XorLoop": run_XorLoop,
 ]
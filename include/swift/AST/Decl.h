@@ -2653,6 +2653,14 @@ class NominalTypeDecl : public TypeDecl, public DeclContext,
   /// Prepare the lookup table to make it ready for lookups.
   void prepareLookupTable(bool ignoreNewExtensions);
 
+  /// Add the members with the given name to the lookup table, loading only
+  /// those members from this type and its extensions that have lazy member
+  /// loaders.
+  ///
+  /// \returns false if this type's own member loader can't load members by
+  /// name, in which case the lookup table is unchanged.
+  bool prepareLookupTableForName(DeclName name, bool ignoreNewExtensions);
+
   /// Note that we have added a member into the iterable declaration context,
   /// so that it can also be added to the lookup table (if needed).
   void addedMember(Decl *member);
@@ -588,6 +588,12 @@ public:
   /// Retrieve the set of members in this context.
   DeclRange getMembers() const;
 
+  /// Retrieve the members that have been added to this context so far,
+  /// without loading any from the lazy member loader.
+  DeclRange getCurrentMembersWithoutLoading() const {
+    return DeclRange(FirstDecl, nullptr);
+  }
+
   /// Add a member to this context. If the hint decl is specified, the new decl
   /// is inserted immediately after the hint.
   void addMember(Decl *member, Decl *hint = nullptr);
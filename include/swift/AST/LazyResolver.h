@@ -17,6 +17,7 @@
 #ifndef SWIFT_AST_LAZYRESOLVER_H
 #define SWIFT_AST_LAZYRESOLVER_H
 
+#include "swift/AST/Identifier.h"
 #include "swift/AST/TypeLoc.h"
 #include "llvm/ADT/PointerEmbeddedInt.h"
 
@@ -134,6 +135,19 @@ public:
     llvm_unreachable("unimplemented");
   }
 
+  /// Populates \p Members with the members of \p D whose base name is \p N,
+  /// without loading any of its other members.
+  ///
+  /// The implementation should \em not add the members to \p D.
+  ///
+  /// \returns false if this loader can only load all of the members of \p D
+  /// at once, in which case \p Members is left untouched.
+  virtual bool
+  loadNamedMembers(const Decl *D, Identifier N, uint64_t contextData,
+                   SmallVectorImpl<ValueDecl *> &Members) {
+    return false;
+  }
+
   /// Populates the given vector with all conformances for \p D.
   ///
   /// The implementation should \em not call setConformances on \p D.
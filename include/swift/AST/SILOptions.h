@@ -95,12 +95,19 @@ public:
   /// Emit a mapping of profile counters for use in coverage.
   bool EmitProfileCoverageMapping = false;
 
+  /// The profile to read execution counts from, if any.
+  std::string UseProfile;
+
   /// Should we use a pass pipeline passed in via a json file? Null by default.
   StringRef ExternalPassPipelineFilename;
   
   /// Emit captures and function contexts using +0 caller-guaranteed ARC
   /// conventions.
   bool EnableGuaranteedClosureContexts = false;
+
+  /// Link the specializations of generic functions that were created when
+  /// imported modules were compiled, instead of creating them again.
+  bool EnableImportedSpecializations = false;
 };
 
 } // end namespace swift
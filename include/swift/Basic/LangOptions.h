@@ -140,6 +140,18 @@ namespace swift {
     /// \brief Enable experimental property behavior feature.
     bool EnableExperimentalPropertyBehaviors = false;
 
+    /// Whether name lookup into a type from a serialized module should load
+    /// only the members with that name, rather than all of its members.
+    bool NamedLazyMemberLoading = true;
+
+    /// Whether the constraint solver should first try the overload choices
+    /// that solved an earlier expression of the same shape.
+    bool ConstraintSolverMemoization = true;
+
+    /// Whether the constraint solver should skip operator overloads that
+    /// cannot accept the argument types that are already known.
+    bool OperatorOverloadPruning = true;
+
     /// Should we check the target OSs of serialized modules to see that they're
     /// new enough?
     bool EnableTargetOSChecking = true;
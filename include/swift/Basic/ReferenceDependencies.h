@@ -0,0 +1,124 @@
+//===--- ReferenceDependencies.h - Swift dependency files -------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Reading and writing the ".swiftdeps" files that the frontend emits
+/// for each primary file and the driver loads for incremental builds.
+///
+/// There are two encodings of the same information. The YAML encoding is meant
+/// to be read by people. The binary encoding is the default; it stores every
+/// distinct name once in a string table and is read in place, without copying
+/// any names out of the file.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_BASIC_REFERENCEDEPENDENCIES_H
+#define SWIFT_BASIC_REFERENCEDEPENDENCIES_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include <memory>
+
+namespace swift {
+namespace reference_dependencies {
+
+/// The sections of a dependencies file.
+///
+/// The values are part of the binary encoding and must not change.
+enum class Section : uint8_t {
+  ProvidesTopLevel = 0,
+  ProvidesNominal,
+  ProvidesMember,
+  ProvidesDynamicLookup,
+  DependsTopLevel,
+  DependsMember,
+  DependsNominal,
+  DependsDynamicLookup,
+  DependsExternal,
+  InterfaceHash,
+  TopLevelFingerprints,
+  NominalFingerprints,
+  MemberFingerprints,
+  DynamicLookupFingerprints,
+  Last_Section = DynamicLookupFingerprints
+};
+
+/// Returns the key used for \p section in the YAML encoding.
+StringRef getSectionKey(Section section);
+
+/// Accepts the contents of a dependencies file, one section at a time.
+class Writer {
+public:
+  virtual ~Writer();
+
+  /// Starts a new section. Any section may be left out.
+  virtual void beginSection(Section section) = 0;
+
+  /// Adds a name to the current section.
+  virtual void addName(StringRef name, bool isCascading = true) = 0;
+
+  /// Adds a member of the nominal type with the mangled name \p baseName to
+  /// the current section. An empty \p memberName stands for all members.
+  virtual void addMember(StringRef baseName, StringRef memberName,
+                         bool isCascading = true) = 0;
+
+  /// Adds the fingerprint of a provided name to the current section, which
+  /// must be one of the *Fingerprints sections.
+  ///
+  /// A fingerprint summarizes the interface of the declarations behind the
+  /// name, so that clients can tell which names changed between two versions
+  /// of a file rather than only whether the file's interface changed.
+  virtual void addFingerprint(StringRef name, StringRef fingerprint) = 0;
+
+  /// Adds the fingerprint of a provided member to the MemberFingerprints
+  /// section.
+  virtual void addMemberFingerprint(StringRef baseName, StringRef memberName,
+                                    StringRef fingerprint) = 0;
+
+  /// Writes the InterfaceHash section.
+  virtual void setInterfaceHash(StringRef hash) = 0;
+
+  /// Writes anything that has been buffered to the output stream.
+  virtual void finish() {}
+};
+
+/// Creates a writer that emits the human-readable YAML encoding.
+std::unique_ptr<Writer> createYAMLWriter(raw_ostream &out);
+
+/// Creates a writer that emits the binary encoding.
+///
+/// Nothing is written to \p out until Writer::finish is called.
+std::unique_ptr<Writer> createBinaryWriter(raw_ostream &out);
+
+/// Returns true if \p data starts with the signature of the binary encoding.
+bool isBinary(StringRef data);
+
+/// Called for each entry of a binary dependencies file, in order.
+///
+/// Member entries are passed as the base name and member name joined by a
+/// '\\0', the same way the YAML reader passes them. Entries of the
+/// *Fingerprints sections have the fingerprint appended after another '\\0'.
+/// The strings point into the file's data.
+///
+/// \returns true to stop reading.
+using EntryCallbackTy = bool(Section section, StringRef name, bool isCascading);
+
+/// Reads a file in the binary encoding.
+///
+/// \returns true if \p data is malformed or \p callback stopped early.
+bool readBinary(StringRef data, llvm::function_ref<EntryCallbackTy> callback);
+
+} // end namespace reference_dependencies
+} // end namespace swift
+
+#endif
@@ -18,9 +18,11 @@
 #include "llvm/Config/config.h"
 #include "llvm/Support/Program.h"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <queue>
+#include <vector>
 
 namespace swift {
 namespace sys {
@@ -38,14 +40,71 @@ enum class TaskFinishedResponse {
   StopExecution,
 };
 
+/// \brief Resources used by a task that has finished execution, as reported
+/// by the operating system.
+struct TaskResourceUsage {
+  /// CPU time spent running the task's own code, in microseconds.
+  uint64_t UserTimeMicros = 0;
+
+  /// CPU time spent in the kernel on behalf of the task, in microseconds.
+  uint64_t SystemTimeMicros = 0;
+
+  /// The largest resident set size the task reached, in bytes.
+  uint64_t MaxRSSBytes = 0;
+
+  /// Whether the values above were reported at all. Not every system
+  /// supports this.
+  bool IsValid = false;
+
+  uint64_t getCPUTimeMicros() const {
+    return UserTimeMicros + SystemTimeMicros;
+  }
+};
+
 /// \brief A class encapsulating the execution of multiple tasks in parallel.
 class TaskQueue {
-  /// Tasks which have not begun execution.
-  std::queue<std::unique_ptr<Task>> QueuedTasks;
+  struct QueuedTask {
+    std::unique_ptr<Task> T;
+
+    /// The estimated cost of the task; more expensive tasks start first.
+    uint64_t Cost;
+
+    /// The order in which the task was added, which breaks ties in cost.
+    uint64_t SequenceNumber;
+
+    /// Orders tasks so that the front of a max-heap is the most expensive
+    /// task, or among equally expensive tasks, the one added first.
+    bool operator<(const QueuedTask &RHS) const {
+      if (Cost != RHS.Cost)
+        return Cost < RHS.Cost;
+      return SequenceNumber > RHS.SequenceNumber;
+    }
+  };
+
+  /// Tasks which have not begun execution, kept as a heap so that the most
+  /// expensive task is at the front.
+  std::vector<QueuedTask> QueuedTasks;
+
+  /// The sequence number to give to the next task that is added.
+  uint64_t NextSequenceNumber = 0;
 
   /// The number of tasks to execute in parallel.
   unsigned NumberOfParallelTasks;
 
+  /// If nonzero, additional tasks are only started while the system reports
+  /// at least this many bytes of available memory.
+  uint64_t MinAvailableMemory = 0;
+
+  /// Adds \p T to the queue of tasks which have not begun execution.
+  void enqueueTask(std::unique_ptr<Task> T, uint64_t Cost);
+
+  /// Removes the next task to execute from the queue.
+  std::unique_ptr<Task> dequeueTask();
+
+  /// \returns true if starting another task while \p NumExecutingTasks are
+  /// already running would exceed the limits on parallel execution.
+  bool isAtParallelLimit(size_t NumExecutingTasks) const;
+
 public:
   /// \brief Create a new TaskQueue instance.
   ///
@@ -73,11 +132,13 @@ public:
   /// \param Output the output from the task which finished execution,
   /// if available. (This may not be available on all platforms.)
   /// \param Context the context which was passed when the task was added
+  /// \param Usage the resources used by the task which finished execution
   ///
   /// \returns true if further execution of tasks should stop,
   /// false if execution should continue
   typedef std::function<TaskFinishedResponse(ProcessId Pid, int ReturnCode,
-                                             StringRef Output, void *Context)>
+                                             StringRef Output, void *Context,
+                                             const TaskResourceUsage &Usage)>
     TaskFinishedCallback;
 
   /// \brief A callback which will be executed if a task exited abnormally due
@@ -89,11 +150,13 @@ public:
   /// \param Output the output from the task which exited abnormally, if
   /// available. (This may not be available on all platforms.)
   /// \param Context the context which was passed when the task was added
+  /// \param Usage the resources used by the task which exited abnormally
   ///
   /// \returns a TaskFinishedResponse indicating whether or not execution
   /// should proceed
   typedef std::function<TaskFinishedResponse(ProcessId Pid, StringRef ErrorMsg,
-                                             StringRef Output, void *Context)>
+                                             StringRef Output, void *Context,
+                                             const TaskResourceUsage &Usage)>
     TaskSignalledCallback;
 #pragma clang diagnostic pop
 
@@ -113,16 +176,35 @@ public:
   /// parallel
   unsigned getNumberOfParallelTasks() const;
 
+  /// \brief Sets the amount of memory which must be available for the
+  /// TaskQueue to start another task while others are still executing.
+  ///
+  /// At least one task is always allowed to run, so that execution makes
+  /// progress even on a heavily loaded system. Zero (the default) disables
+  /// the check.
+  void setMinAvailableMemory(uint64_t Bytes) { MinAvailableMemory = Bytes; }
+
+  /// \returns the amount of physical memory currently available to new
+  /// processes, or UINT64_MAX if it cannot be determined on this system.
+  static uint64_t getAvailableMemory();
+
   /// \brief Adds a task to the TaskQueue.
   ///
+  /// When tasks are executed in parallel, queued tasks are started in order
+  /// of decreasing \p Cost, so that long-running tasks don't end up
+  /// stretching the end of the build. Tasks of equal cost, and all tasks
+  /// when executing serially, are started in the order they were added.
+  ///
   /// \param ExecPath the path to the executable which the task should execute
   /// \param Args the arguments which should be passed to the task
   /// \param Env the environment which should be used for the task;
   /// must be null-terminated. If empty, inherits the parent's environment.
   /// \param Context an optional context which will be associated with the task
+  /// \param Cost an estimate of how long the task will take to execute, in
+  /// arbitrary units
   virtual void addTask(const char *ExecPath, ArrayRef<const char *> Args,
                        ArrayRef<const char *> Env = llvm::None,
-                       void *Context = nullptr);
+                       void *Context = nullptr, uint64_t Cost = 0);
 
   /// \brief Synchronously executes the tasks in the TaskQueue.
   ///
@@ -168,7 +250,7 @@ public:
 
   virtual void addTask(const char *ExecPath, ArrayRef<const char *> Args,
                        ArrayRef<const char *> Env = llvm::None,
-                       void *Context = nullptr);
+                       void *Context = nullptr, uint64_t Cost = 0);
 
   virtual bool
   execute(TaskBeganCallback Began = TaskBeganCallback(),
@@ -0,0 +1,113 @@
+//===--- BuildHistory.h - Timing of driver jobs across builds ---*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Records of how long the driver's jobs took, both in earlier builds
+/// (kept in the build record) and in the current one.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_DRIVER_BUILDHISTORY_H
+#define SWIFT_DRIVER_BUILDHISTORY_H
+
+#include "swift/Basic/LLVM.h"
+#include "swift/Basic/TaskQueue.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <string>
+
+namespace swift {
+namespace driver {
+
+class Job;
+
+/// What it cost to compile one input file the last time it was compiled.
+struct JobHistoryEntry {
+  uint64_t WallTimeMicros = 0;
+  uint64_t CPUTimeMicros = 0;
+  uint64_t MaxRSSBytes = 0;
+};
+
+/// What it cost to compile each input file in earlier builds, keyed by the
+/// path of the input as given on the command line.
+///
+/// When several inputs were compiled by one process, that process's time is
+/// split between them in proportion to their expected cost.
+class BuildHistory {
+  llvm::StringMap<JobHistoryEntry> Entries;
+
+public:
+  bool empty() const { return Entries.empty(); }
+
+  /// \returns the entry for \p Input, or null if it has never been compiled.
+  const JobHistoryEntry *lookup(StringRef Input) const {
+    auto Found = Entries.find(Input);
+    if (Found == Entries.end())
+      return nullptr;
+    return &Found->getValue();
+  }
+
+  void record(StringRef Input, const JobHistoryEntry &Entry) {
+    Entries[Input] = Entry;
+  }
+
+  /// Reads the "job_history" section of the build record at \p Path.
+  ///
+  /// A missing build record, or one without a history, leaves this empty.
+  ///
+  /// \returns true if the build record could not be parsed.
+  bool read(StringRef Path);
+
+  /// Writes the "job_history" section of a build record, including only the
+  /// entries for \p Inputs.
+  void write(raw_ostream &Out, ArrayRef<StringRef> Inputs) const;
+};
+
+/// When one task ran during the current build, and what it used.
+struct TaskTiming {
+  /// The job the task ran. In batch mode this may stand for several jobs.
+  const Job *Cmd = nullptr;
+
+  /// A short description of the task for reports, such as
+  /// "compile main.swift".
+  std::string Description;
+
+  /// When the task began and finished, in microseconds since the build
+  /// started.
+  uint64_t StartMicros = 0;
+  uint64_t EndMicros = 0;
+  bool Finished = false;
+
+  sys::TaskResourceUsage Usage;
+
+  /// The task whose completion allowed this one to be queued, or null if it
+  /// was ready when the build started.
+  const Job *WaitedOn = nullptr;
+
+  /// An index that no other task running at the same time has, used to lay
+  /// out the trace.
+  unsigned Lane = 0;
+};
+
+/// Writes \p Timings in the Chrome trace event format, which chrome://tracing
+/// and similar viewers can display.
+void writeTrace(raw_ostream &Out, ArrayRef<TaskTiming> Timings);
+
+/// Prints the chain of tasks that ended with the last task to finish, where
+/// each task in the chain waited on the one before it. Speeding up any other
+/// task would not have made the build finish sooner.
+void printCriticalPath(raw_ostream &Out, ArrayRef<TaskTiming> Timings);
+
+} // end namespace driver
+} // end namespace swift
+
+#endif
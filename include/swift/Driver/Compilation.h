@@ -17,6 +17,7 @@
 #ifndef SWIFT_DRIVER_COMPILATION_H
 #define SWIFT_DRIVER_COMPILATION_H
 
+#include "swift/Driver/BuildHistory.h"
 #include "swift/Driver/Job.h"
 #include "swift/Driver/Util.h"
 #include "swift/Basic/ArrayRefView.h"
@@ -40,6 +41,7 @@ namespace swift {
 
 namespace driver {
   class Driver;
+  class OutputInfo;
   class ToolChain;
 
 /// An enum providing different levels of output which should be produced
@@ -110,6 +112,10 @@ private:
   /// parallel.
   unsigned NumberOfParallelCommands;
 
+  /// If nonzero, additional commands are only started in parallel while at
+  /// least this many bytes of memory are available.
+  uint64_t MinAvailableMemory = 0;
+
   /// Indicates whether this Compilation should use skip execution of
   /// subtasks during performJobs() by using a dummy TaskQueue.
   ///
@@ -128,10 +134,28 @@ private:
   /// True if temporary files should not be deleted.
   bool SaveTemps;
 
+  /// How long each input took to compile in earlier builds.
+  BuildHistory History;
+
+  /// If non-empty, the path to which a trace of the tasks run by this
+  /// compilation should be written.
+  std::string TracePath;
+
+  /// When true, prints the chain of tasks that determined how long this
+  /// compilation took.
+  bool ShowCriticalPath = false;
+
   /// When true, dumps information about why files are being scheduled to be
   /// rebuilt.
   bool ShowIncrementalBuildDecisions = false;
 
+  /// When non-null, compile jobs that are ready to run at the same time are
+  /// combined into batches, each run by a single frontend invocation.
+  const ToolChain *BatchModeToolChain = nullptr;
+
+  /// The OutputInfo the jobs were built with, used to construct batches.
+  std::unique_ptr<OutputInfo> BatchModeOutputInfo;
+
   static const Job *unwrap(const std::unique_ptr<const Job> &p) {
     return p.get();
   }
@@ -171,6 +195,20 @@ public:
     return NumberOfParallelCommands;
   }
 
+  uint64_t getMinAvailableMemory() const {
+    return MinAvailableMemory;
+  }
+  void setMinAvailableMemory(uint64_t Bytes) {
+    MinAvailableMemory = Bytes;
+  }
+
+  /// Combines compile jobs into about one batch per parallel command, using
+  /// \p TC to construct the batched jobs.
+  void enableBatchMode(const ToolChain &TC, const OutputInfo &OI);
+  bool getBatchModeEnabled() const {
+    return BatchModeToolChain != nullptr;
+  }
+
   bool getIncrementalBuildEnabled() const {
     return EnableIncrementalBuild;
   }
@@ -198,6 +236,18 @@ public:
     LastBuildTime = time;
   }
 
+  void setBuildHistory(BuildHistory history) {
+    History = std::move(history);
+  }
+
+  void setTracePath(StringRef path) {
+    TracePath = path;
+  }
+
+  void setShowCriticalPath(bool value = true) {
+    ShowCriticalPath = value;
+  }
+
   /// Requests the path to a file containing all input source files. This can
   /// be shared across jobs.
   ///
@@ -88,8 +88,24 @@ private:
   static_assert(std::is_move_constructible<DependencyEntryTy>::value, "");
 
   struct ProvidesEntryTy {
-    std::string name;
+    /// Points into ProvidedNames.
+    StringRef name;
     DependencyMaskTy kindMask;
+
+    /// The combined fingerprints of the declarations behind this entry, if
+    /// the dependencies file had any.
+    size_t fingerprint = 0;
+    bool hasFingerprint = false;
+
+    /// Whether this entry was added, removed, or changed by the most recent
+    /// reload of the node.
+    bool changed = false;
+
+    /// Whether the node no longer provides this entry.
+    bool isStale = false;
+
+    ProvidesEntryTy(StringRef name, DependencyMaskTy kindMask)
+      : name(name), kindMask(kindMask) {}
   };
   static_assert(std::is_move_constructible<ProvidesEntryTy>::value, "");
 
@@ -119,6 +135,16 @@ private:
   /// The set of marked nodes.
   llvm::SmallPtrSet<const void *, 16> Marked;
 
+  /// Nodes whose most recent dependencies file had fingerprints.
+  ///
+  /// Marking through one of these nodes only follows the entries that changed
+  /// when it was last reloaded, rather than everything it provides.
+  llvm::SmallPtrSet<const void *, 16> FineGrainedNodes;
+
+  /// Every name that any node provides, so that each one is only stored once
+  /// no matter how many times it is loaded.
+  llvm::StringSet<> ProvidedNames;
+
   /// A list of all "external" dependencies that cannot be resolved just from
   /// this dependency graph.
   llvm::StringSet<> ExternalDependencies;
@@ -243,6 +269,10 @@ public:
   /// ("depends") are not cleared; new dependencies are considered additive.
   ///
   /// If \p node has already been marked, only its outgoing edges are updated.
+  ///
+  /// If the file has fingerprints for the names \p node provides, marking
+  /// through \p node afterwards only follows the names whose fingerprints
+  /// differ from the previous load.
   LoadResult loadFromPath(T node, StringRef path) {
     return DependencyGraphImpl::loadFromPath(Traits::getAsVoidPointer(node),
                                              path);
@@ -60,6 +60,12 @@ protected:
     const CommandOutput &Output;
     const OutputInfo &OI;
 
+    /// When several compile jobs are combined into one frontend invocation,
+    /// the outputs of each of them, in the same order as InputActions.
+    ///
+    /// Empty for ordinary jobs.
+    ArrayRef<const CommandOutput *> BatchOutputs;
+
     /// The arguments to the driver. Can also be used to create new strings with
     /// the same lifetime.
     ///
@@ -69,7 +75,11 @@ protected:
   public:
     JobContext(Compilation &C, ArrayRef<const Job *> Inputs,
                ArrayRef<const Action *> InputActions,
-               const CommandOutput &Output, const OutputInfo &OI);
+               const CommandOutput &Output, const OutputInfo &OI,
+               ArrayRef<const CommandOutput *> BatchOutputs = {});
+
+    /// Whether this job compiles several primary inputs at once.
+    bool isBatch() const { return !BatchOutputs.empty(); }
 
     /// Forwards to Compilation::getInputFiles.
     ArrayRef<InputPair> getTopLevelInputFiles() const;
@@ -128,6 +138,10 @@ protected:
   constructInvocation(const LinkJobAction &job,
                       const JobContext &context) const;
 
+  /// Resolves the executable named by an InvocationInfo to the path that
+  /// should be run.
+  const char *findExecutable(const char *executableName, Compilation &C) const;
+
   /// Searches for the given executable in appropriate paths relative to the
   /// Swift binary.
   ///
@@ -160,6 +174,18 @@ public:
                                     std::unique_ptr<CommandOutput> output,
                                     const OutputInfo &OI) const;
 
+  /// Returns true if \p Cmd may be combined with other jobs by
+  /// constructBatchJob().
+  bool jobIsBatchable(const Job *Cmd) const;
+
+  /// Construct a single Job that performs all of the given compile \p Jobs in
+  /// one frontend invocation, writing the same outputs they would have.
+  ///
+  /// All of \p Jobs must satisfy jobIsBatchable().
+  std::unique_ptr<Job> constructBatchJob(ArrayRef<const Job *> Jobs,
+                                         Compilation &C,
+                                         const OutputInfo &OI) const;
+
   /// Return the default language type to use for the given extension.
   virtual types::ID lookupTypeForExtension(StringRef Ext) const;
 };
@@ -26,6 +26,7 @@
 #include "swift/AST/IRGenOptions.h"
 #include "swift/AST/LinkLibrary.h"
 #include "swift/AST/Module.h"
+#include "swift/AST/ReferencedNameTracker.h"
 #include "swift/AST/SearchPathOptions.h"
 #include "swift/AST/SILOptions.h"
 #include "swift/Parse/CodeCompletionCallbacks.h"
@@ -313,8 +314,22 @@ class CompilerInstance {
 
   SourceFile *PrimarySourceFile = nullptr;
 
+  /// In batch mode, the buffer IDs and source files of all primary inputs,
+  /// in the order they were given.
+  std::vector<unsigned> BatchPrimaryBufferIDs;
+  std::vector<SourceFile *> BatchPrimarySourceFiles;
+
+  /// In batch mode, the reference trackers of every primary source file but
+  /// the first, which uses NameTracker.
+  std::vector<std::unique_ptr<ReferencedNameTracker>> BatchNameTrackers;
+
   void createSILModule(bool WholeModule = false);
+  void applyInvocationOptions();
+  bool setupInputs();
   void setPrimarySourceFile(SourceFile *SF);
+  void recordPrimarySourceFile(SourceFile *SF);
+  bool isPrimaryBuffer(unsigned BufferID) const;
+  bool isPrimarySourceFile(const SourceFile *SF) const;
 
 public:
   SourceManager &getSourceMgr() { return SourceMgr; }
@@ -386,9 +401,30 @@ public:
   /// \returns the primary SourceFile, or nullptr if there is no primary input
   SourceFile *getPrimarySourceFile() { return PrimarySourceFile; }
 
+  /// In batch mode, gets the SourceFiles of all primary inputs, in the order
+  /// they were given. Empty otherwise.
+  ArrayRef<SourceFile *> getBatchPrimarySourceFiles() const {
+    return BatchPrimarySourceFiles;
+  }
+
+  /// In batch mode, makes the \p Index'th primary input the one returned by
+  /// getPrimarySourceFile(). Must be called after performSema().
+  void selectBatchPrimarySourceFile(unsigned Index);
+
   /// \brief Returns true if there was an error during setup.
   bool setup(const CompilerInvocation &Invocation);
 
+  /// Sets up an instance that has been set up before, but not yet used to
+  /// compile anything, to compile the inputs of \p Invocation. The ASTContext
+  /// and the modules it has already loaded are kept.
+  ///
+  /// The caller must make sure that everything the ASTContext and its module
+  /// loaders were created with -- the target, search paths, Clang importer
+  /// options and so on -- is the same in \p Invocation.
+  ///
+  /// \returns true if there was an error during setup.
+  bool setupReusingASTContext(const CompilerInvocation &Invocation);
+
   /// Parses and type-checks all input files.
   void performSema();
 
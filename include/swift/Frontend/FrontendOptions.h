@@ -74,6 +74,25 @@ public:
   /// be generated for the whole module.
   Optional<SelectedInput> PrimaryInput;
 
+  /// One primary input of a batch, along with the outputs that belong to it.
+  struct BatchEntry {
+    SelectedInput Input;
+    std::string OutputFilename;
+    std::string ModuleOutputPath;
+    std::string ModuleDocOutputPath;
+    std::string SerializedDiagnosticsPath;
+    std::string DependenciesFilePath;
+    std::string ReferenceDependenciesFilePath;
+
+    BatchEntry(SelectedInput Input) : Input(Input) {}
+  };
+
+  /// When more than one primary input is given, the frontend is in batch mode:
+  /// the whole module is parsed and imported once, and output is generated
+  /// for each entry in turn. PrimaryInput and the single-file output paths
+  /// below always reflect the entry currently being compiled.
+  std::vector<BatchEntry> Batch;
+
   /// The kind of input on which the frontend should operate.
   InputFileKind InputKind = InputFileKind::IFK_Swift;
 
@@ -112,6 +131,10 @@ public:
   /// The path to which we should output a Swift reference dependencies file.
   std::string ReferenceDependenciesFilePath;
 
+  /// If set, the Swift reference dependencies file is written as YAML rather
+  /// than in the binary format.
+  bool EmitYAMLReferenceDependencies = false;
+
   /// The path to which we should output a fixits as source edits.
   std::string FixitsOutputPath;
 
@@ -128,6 +151,15 @@ public:
   /// The path to collect the group information for the compiled source files.
   std::string GroupInfoPath;
 
+  /// If set, the frontend does not compile anything itself. It listens on a
+  /// socket at this path and compiles the jobs it is sent there, reusing the
+  /// modules it loaded for this invocation.
+  std::string CompileServerPath;
+
+  /// If nonzero, the compile server stops after it has not been sent a job
+  /// for this many seconds.
+  unsigned CompileServerIdleTimeout = 0;
+
   enum ActionType {
     NoneAction, ///< No specific action
     Parse, ///< Parse and type-check only
@@ -179,6 +211,12 @@ public:
   /// until the end of all files.
   bool DelayedFunctionBodyParsing = false;
 
+  /// Indicates whether the function bodies of non-primary files should be
+  /// skipped by the parser. Only the declarations of those files are needed
+  /// to compile the primary files, and their bodies make up most of their
+  /// tokens.
+  bool SkipSecondaryFunctionBodies = false;
+
   /// Indicates whether or not an import statement can pick up a Swift source
   /// file (as opposed to a module file).
   bool EnableSourceImport = false;
@@ -250,6 +288,13 @@ public:
   /// Indicates whether the RequestedAction will immediately run code.
   bool actionIsImmediate() const;
 
+  /// Indicates whether more than one primary input was given.
+  bool isBatchMode() const { return Batch.size() > 1; }
+
+  /// Makes the \p Index'th entry of the batch the primary input, and points
+  /// the output paths at its outputs.
+  void selectBatchEntry(unsigned Index);
+
   void forAllOutputPaths(std::function<void(const std::string &)> fn) const;
   
   /// Gets the name of the specified output filename.
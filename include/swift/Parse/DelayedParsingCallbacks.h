@@ -44,6 +44,17 @@ class AlwaysDelayedCallbacks : public DelayedParsingCallbacks {
   }
 };
 
+/// \brief Implementation of callbacks that skip every function body, without
+/// building any AST for it or diagnosing anything inside it.
+class AlwaysSkippedCallbacks : public DelayedParsingCallbacks {
+  bool shouldDelayFunctionBodyParsing(Parser &TheParser,
+                                      AbstractFunctionDecl *AFD,
+                                      const DeclAttributes &Attrs,
+                                      SourceRange BodyRange) override {
+    return false;
+  }
+};
+
 /// \brief Implementation of callbacks that guide the parser in delayed
 /// parsing for code completion.
 class CodeCompleteDelayedCallbacks : public DelayedParsingCallbacks {
@@ -14,6 +14,8 @@
 #include <iterator>
 #include <atomic>
 #include <stdint.h>
+#include <stdio.h>
+#include <thread>
 
 /// This is a node in a concurrent linked list.
 template <class ElemTy> struct ConcurrentListNode {
@@ -119,9 +121,23 @@ template <class ElemTy> struct ConcurrentList {
   std::atomic<ConcurrentListNode<ElemTy> *> First;
 };
 
-/// A concurrent map that is implemented using a binary tree. It supports
-/// concurrent insertions but does not support removals or rebalancing of
-/// the tree.
+/// A concurrent map that is implemented using an open-addressed hash table
+/// with linear probing. It supports lookups that never block and never
+/// write to shared memory, concurrent insertions, and growing the table,
+/// but it does not support removals.
+///
+/// Entries are allocated individually and are never moved, so a pointer
+/// returned by find or getOrInsert stays valid for the lifetime of the map.
+/// The bucket array holds pointers to the entries. Insertions (and the
+/// occasional resize) are serialized by a spin lock that is encoded in the
+/// low bit of the table pointer; readers just mask that bit off. When the
+/// table grows, the old bucket array is kept alive on a list of retired
+/// tables until the map is destroyed, because a concurrent reader may still
+/// be probing it. The retired tables always add up to less than the size of
+/// the current table.
+///
+/// All-zero is a valid state for the map, and the map is exactly two
+/// pointers in size; MetadataCache relies on both of these properties.
 ///
 /// The entry type must provide the following operations:
 ///
@@ -129,83 +145,196 @@ template <class ElemTy> struct ConcurrentList {
 ///   long getKeyIntValueForDump() const;
 ///
 ///   /// A ternary comparison.  KeyTy is the type of the key provided
-///   /// to find or getOrInsert.
+///   /// to find or getOrInsert. Only equality (a result of zero) is
+///   /// significant to the map.
 ///   int compareWithKey(KeyTy key) const;
 ///
+///   /// Hash the key. Keys that compare equal must have equal hash values.
+///   /// The low bits of the result select the bucket, so they should be
+///   /// well distributed.
+///   static size_t getKeyHash(KeyTy key);
+///
 ///   /// Return the amount of extra trailing space required by an entry,
 ///   /// where KeyTy is the type of the first argument to getOrInsert and
 ///   /// ArgTys is the type of the remaining arguments.
 ///   static size_t getExtraAllocationSize(KeyTy key, ArgTys...)
 template <class EntryTy> class ConcurrentMap {
   struct Node {
-    std::atomic<Node*> Left;
-    std::atomic<Node*> Right;
+    /// The hash value of the key, cached so that probing and rehashing
+    /// don't need to call back into the entry.
+    size_t Hash;
     EntryTy Payload;
 
     template <class... Args>
-    Node(Args &&... args)
-      : Left(nullptr), Right(nullptr), Payload(std::forward<Args>(args)...) {}
+    Node(size_t hash, Args &&... args)
+      : Hash(hash), Payload(std::forward<Args>(args)...) {}
 
     Node(const Node &) = delete;
     Node &operator=(const Node &) = delete;
+  };
 
-    ~Node() {
-      // These can be relaxed accesses because there is no safe way for
-      // another thread to race an access to this node with our destruction
-      // of it.
-      ::delete Left.load(std::memory_order_relaxed);
-      ::delete Right.load(std::memory_order_relaxed);
+  /// A bucket array. The buckets are allocated as trailing storage.
+  struct Storage {
+    /// The number of buckets. Always a power of two.
+    size_t Capacity;
+
+    /// The number of occupied buckets. Only accessed with the writer lock
+    /// held.
+    size_t Count;
+
+    /// The next table on the list of retired tables.
+    Storage *NextRetired;
+
+    std::atomic<Node*> *buckets() {
+      return reinterpret_cast<std::atomic<Node*> *>(this + 1);
     }
 
-#ifndef NDEBUG
-    void dump() const {
-      auto L = Left.load(std::memory_order_acquire);
-      auto R = Right.load(std::memory_order_acquire);
-      printf("\"%p\" [ label = \" {<f0> %08lx | {<f1> | <f2>}}\" "
-             "style=\"rounded\" shape=\"record\"];\n",
-             this, (long) Payload.getKeyValueForDump());
-
-      if (L) {
-        L->dump();
-        printf("\"%p\":f1 -> \"%p\":f0;\n", this, L);
-      }
-      if (R) {
-        R->dump();
-        printf("\"%p\":f2 -> \"%p\":f0;\n", this, R);
+    static Storage *allocate(size_t capacity) {
+      void *memory = ::operator new(sizeof(Storage) +
+                                    capacity * sizeof(std::atomic<Node*>));
+      auto table = ::new (memory) Storage{capacity, 0, nullptr};
+      auto buckets = table->buckets();
+      for (size_t i = 0; i < capacity; ++i)
+        ::new (&buckets[i]) std::atomic<Node*>(nullptr);
+      return table;
+    }
+
+    static void deallocate(Storage *table) {
+      ::operator delete(table);
+    }
+
+    /// Probe for an entry matching the given key.
+    template <class KeyTy>
+    Node *find(size_t hash, const KeyTy &key) {
+      size_t mask = Capacity - 1;
+      auto buckets = this->buckets();
+      for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        Node *node = buckets[i].load(std::memory_order_acquire);
+        // The load factor is bounded, so we always reach an empty bucket.
+        if (!node)
+          return nullptr;
+        if (node->Hash == hash && node->Payload.compareWithKey(key) == 0)
+          return node;
       }
     }
-#endif
+
+    /// Add a node that is known not to be in the table yet. The writer
+    /// lock must be held.
+    void insert(Node *newNode) {
+      size_t mask = Capacity - 1;
+      auto buckets = this->buckets();
+      size_t i = newNode->Hash & mask;
+      while (buckets[i].load(std::memory_order_relaxed))
+        i = (i + 1) & mask;
+      buckets[i].store(newNode, std::memory_order_release);
+      ++Count;
+    }
   };
 
-  /// The root of the tree.
-  std::atomic<Node*> Root;
+  /// The smallest table we allocate.
+  enum : size_t { InitialCapacity = 16 };
+
+  /// The current table, with the writer lock in the low bit.
+  std::atomic<uintptr_t> Table;
+
+  /// Tables that have been replaced by a bigger one. Only accessed with the
+  /// writer lock held, or in the destructor.
+  Storage *RetiredTables;
+
+  /// Get the current table for reading. May be null.
+  Storage *getTableForReading() const {
+    return reinterpret_cast<Storage *>(
+             Table.load(std::memory_order_acquire) & ~uintptr_t(1));
+  }
+
+  /// Acquire the writer lock and return the current table. May be null.
+  Storage *lockForWriting() {
+    uintptr_t value = Table.load(std::memory_order_relaxed);
+    while (true) {
+      if (value & 1) {
+        std::this_thread::yield();
+        value = Table.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (Table.compare_exchange_weak(value, value | 1,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed))
+        return reinterpret_cast<Storage *>(value);
+    }
+  }
+
+  /// Publish the given table and release the writer lock.
+  void unlockForWriting(Storage *table) {
+    Table.store(reinterpret_cast<uintptr_t>(table), std::memory_order_release);
+  }
 
-  /// This member stores the address of the last node that was found by the
-  /// search procedure. We cache the last search to accelerate code that
-  /// searches the same value in a loop.
-  std::atomic<Node*> LastSearch;
+  /// Make room for one more entry, replacing the table with a bigger one if
+  /// the load factor would exceed 3/4. The writer lock must be held.
+  Storage *reserveOneMore(Storage *table) {
+    if (table && (table->Count + 1) * 4 <= table->Capacity * 3)
+      return table;
+
+    size_t newCapacity = table ? table->Capacity * 2 : size_t(InitialCapacity);
+    Storage *newTable = Storage::allocate(newCapacity);
+    if (table) {
+      auto buckets = table->buckets();
+      for (size_t i = 0; i < table->Capacity; ++i)
+        if (Node *node = buckets[i].load(std::memory_order_relaxed))
+          newTable->insert(node);
+
+      // Concurrent readers may still be probing the old table.
+      table->NextRetired = RetiredTables;
+      RetiredTables = table;
+    }
+    return newTable;
+  }
 
 public:
-  constexpr ConcurrentMap() : Root(nullptr), LastSearch(nullptr) {}
+  constexpr ConcurrentMap() : Table(0), RetiredTables(nullptr) {}
 
   ConcurrentMap(const ConcurrentMap &) = delete;
   ConcurrentMap &operator=(const ConcurrentMap &) = delete;
 
   ~ConcurrentMap() {
-    ::delete Root.load(std::memory_order_relaxed);
+    // These can be relaxed accesses because there is no safe way for
+    // another thread to race an access to this map with our destruction
+    // of it.
+    auto table = reinterpret_cast<Storage *>(
+                   Table.load(std::memory_order_relaxed));
+    if (table) {
+      // Every node is reachable from the current table.
+      auto buckets = table->buckets();
+      for (size_t i = 0; i < table->Capacity; ++i) {
+        if (Node *node = buckets[i].load(std::memory_order_relaxed)) {
+          node->~Node();
+          ::operator delete(node);
+        }
+      }
+      Storage::deallocate(table);
+    }
+    while (Storage *retired = RetiredTables) {
+      RetiredTables = retired->NextRetired;
+      Storage::deallocate(retired);
+    }
   }
 
 #ifndef NDEBUG
   void dump() const {
-    auto R = Root.load(std::memory_order_acquire);
-    printf("digraph g {\n"
-           "graph [ rankdir = \"TB\"];\n"
-           "node  [ fontsize = \"16\" ];\n"
-           "edge  [ ];\n");
-    if (R) {
-      R->dump();
+    auto table = getTableForReading();
+    if (!table) {
+      printf("<empty>\n");
+      return;
+    }
+    printf("%zu entries in %zu buckets\n", table->Count, table->Capacity);
+    auto buckets = table->buckets();
+    for (size_t i = 0; i < table->Capacity; ++i) {
+      Node *node = buckets[i].load(std::memory_order_acquire);
+      if (!node)
+        continue;
+      printf("  [%zu] %p hash %08zx home %zu key %08lx\n", i, (void*) node,
+             node->Hash, node->Hash & (table->Capacity - 1),
+             (long) node->Payload.getKeyIntValueForDump());
     }
-    printf("\n}\n");
   }
 #endif
 
@@ -213,27 +342,12 @@ public:
   /// \returns a pointer to the value or null if the value is not in the map.
   template <class KeyTy>
   EntryTy *find(const KeyTy &key) {
-    // Check if we are looking for the same key that we looked for in the last
-    // time we called this function.
-    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
-      if (last->Payload.compareWithKey(key) == 0)
-        return &last->Payload;
-    }
-
-    // Search the tree, starting from the root.
-    Node *node = Root.load(std::memory_order_acquire);
-    while (node) {
-      int comparisonResult = node->Payload.compareWithKey(key);
-      if (comparisonResult == 0) {
-        LastSearch.store(node, std::memory_order_release);
-        return &node->Payload;
-      } else if (comparisonResult < 0) {
-        node = node->Left.load(std::memory_order_acquire);
-      } else {
-        node = node->Right.load(std::memory_order_acquire);
-      }
-    }
+    auto table = getTableForReading();
+    if (!table)
+      return nullptr;
 
+    if (Node *node = table->find(EntryTy::getKeyHash(key), key))
+      return &node->Payload;
     return nullptr;
   }
 
@@ -243,69 +357,38 @@ public:
   ///   or already existed (false)
   template <class KeyTy, class... ArgTys>
   std::pair<EntryTy*, bool> getOrInsert(KeyTy key, ArgTys &&... args) {
-    // Check if we are looking for the same key that we looked for the
-    // last time we called this function.
-    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
-      if (last && last->Payload.compareWithKey(key) == 0)
-        return { &last->Payload, false };
-    }
-
-    // The node we allocated.
-    Node *newNode = nullptr;
-
-    // Start from the root.
-    auto edge = &Root;
-
-    while (true) {
-      // Load the edge.
-      Node *node = edge->load(std::memory_order_acquire);
-
-      // If there's a node there, it's either a match or we're going to
-      // one of its children.
-      if (node) {
-      searchFromNode:
-
-        // Compare our key against the node's key.
-        int comparisonResult = node->Payload.compareWithKey(key);
-
-        // If it's equal, we can use this node.
-        if (comparisonResult == 0) {
-          // Destroy the node we allocated before if we're carrying one around.
-          ::delete newNode;
-
-          // Cache and report that we found an existing node.
-          LastSearch.store(node, std::memory_order_release);
-          return { &node->Payload, false };
-        }
-
-        // Otherwise, select the appropriate child edge and descend.
-        edge = (comparisonResult < 0 ? &node->Left : &node->Right);
-        continue;
-      }
-
-      // Create a new node.
-      if (!newNode) {
-        size_t allocSize =
-          sizeof(Node) + EntryTy::getExtraAllocationSize(key, args...);
-        void *memory = ::operator new(allocSize);
-        newNode = ::new (memory) Node(key, std::forward<ArgTys>(args)...);
+    size_t hash = EntryTy::getKeyHash(key);
+
+    // Try a lock-free lookup first; most calls find an existing entry.
+    if (auto table = getTableForReading())
+      if (Node *node = table->find(hash, key))
+        return { &node->Payload, false };
+
+    // Create the new node before taking the lock to keep the critical
+    // section short.
+    size_t allocSize =
+      sizeof(Node) + EntryTy::getExtraAllocationSize(key, args...);
+    void *memory = ::operator new(allocSize);
+    Node *newNode = ::new (memory) Node(hash, key,
+                                        std::forward<ArgTys>(args)...);
+
+    Storage *table = lockForWriting();
+
+    // Another thread may have inserted the key while we weren't holding the
+    // lock.
+    if (table) {
+      if (Node *node = table->find(hash, key)) {
+        unlockForWriting(table);
+        newNode->~Node();
+        ::operator delete(newNode);
+        return { &node->Payload, false };
       }
-
-      // Try to set the edge to the new node.
-      if (std::atomic_compare_exchange_strong_explicit(edge, &node, newNode,
-                                                  std::memory_order_release,
-                                                  std::memory_order_acquire)) {
-        // If that succeeded, cache and report that we created a new node.
-        LastSearch.store(newNode, std::memory_order_release);
-        return { &newNode->Payload, true };
-      }
-
-      // Otherwise, we lost the race because some other thread initialized
-      // the edge before us.  node will be set to the current value;
-      // repeat the search from there.
-      assert(node && "spurious failure from compare_exchange_strong?");
-      goto searchFromNode;
     }
+
+    table = reserveOneMore(table);
+    table->insert(newNode);
+    unlockForWriting(table);
+    return { &newNode->Payload, true };
   }
 };
 
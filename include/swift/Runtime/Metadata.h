@@ -34,19 +34,52 @@
 
 namespace swift {
 
+/// Usage counters for one kind of metadata cache, e.g. all tuple type
+/// caches or all generic witness table caches. Every cache of a given kind
+/// shares one instance, which is linked into a global list the first time
+/// one of those caches is created. The counters are updated with relaxed
+/// atomics and are only meant to be read for reporting.
+struct MetadataCacheStatistics {
+  /// The name of the cache kind, as reported by the cache entry type.
+  const char *Name;
+
+  /// The number of entries that have been instantiated in caches of this
+  /// kind.
+  std::atomic<size_t> NumEntries;
+
+  /// The number of bytes of metadata allocated on behalf of caches of this
+  /// kind.
+  std::atomic<size_t> NumBytes;
+
+  /// Whether this record has been linked into the global list.
+  std::atomic<bool> Registered;
+
+  /// The next record in the global list.
+  MetadataCacheStatistics *Next;
+
+  constexpr MetadataCacheStatistics()
+    : Name(nullptr), NumEntries(0), NumBytes(0), Registered(false),
+      Next(nullptr) {}
+
+  MetadataCacheStatistics(const MetadataCacheStatistics &) = delete;
+  MetadataCacheStatistics &operator=(const MetadataCacheStatistics &) = delete;
+};
+
 /// A bump pointer for metadata allocations. Since metadata is (currently)
-/// never released, it does not support deallocation. This allocator by itself
-/// is not thread-safe; in concurrent uses, allocations must be guarded by
-/// a lock, such as the per-metadata-cache lock used to guard metadata
-/// instantiations. All allocations are pointer-aligned.
+/// never released, it does not support deallocation. All allocations are
+/// pointer-aligned.
+///
+/// The allocator itself is only a handle: the memory comes from per-thread
+/// arenas that are refilled a slab at a time from a global pool, so it is
+/// safe to allocate from any thread without holding a cache lock, and
+/// concurrent instantiations on different threads do not contend. The slab
+/// size defaults to 64KB and can be overridden with the
+/// SWIFT_METADATA_SLAB_SIZE environment variable.
 class MetadataAllocator {
-  /// Address of the next available space. The allocator grabs a page at a time,
-  /// so the need for a new page can be determined by page alignment.
-  ///
-  /// Initializing to -1 instead of nullptr ensures that the first allocation
-  /// triggers a page allocation since it will always span a "page" boundary.
-  char *next = (char*)(~(uintptr_t)0U);
-  
+  /// The statistics record charged for allocations made through this
+  /// allocator, or null if they are not attributed to any cache kind.
+  MetadataCacheStatistics *Statistics = nullptr;
+
 public:
   MetadataAllocator() = default;
 
@@ -55,7 +88,9 @@ public:
   MetadataAllocator(MetadataAllocator &&) = delete;
   MetadataAllocator &operator=(const MetadataAllocator &) = delete;
   MetadataAllocator &operator=(MetadataAllocator &&) = delete;
-  
+
+  void setStatistics(MetadataCacheStatistics *stats) { Statistics = stats; }
+
   void *alloc(size_t size);
 };
 
@@ -3055,6 +3090,35 @@ extern "C"
 void swift_registerTypeMetadataRecords(const TypeMetadataRecord *begin,
                                        const TypeMetadataRecord *end);
 
+/// Global usage counters for the metadata allocator.
+struct MetadataAllocationStatistics {
+  /// The number of bytes handed out to metadata, including padding to
+  /// pointer alignment.
+  size_t BytesAllocated;
+
+  /// The number of bytes mapped from the system for metadata, including the
+  /// unused tails of per-thread slabs.
+  size_t BytesReserved;
+
+  /// The number of slabs and dedicated large-allocation mappings.
+  size_t NumSlabs;
+};
+
+/// Fill in the global metadata allocator statistics.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+void swift_getMetadataAllocationStatistics(MetadataAllocationStatistics *stats);
+
+/// Call \p callback once for every kind of metadata cache that has been
+/// created so far, passing its name, the number of entries instantiated in
+/// caches of that kind and the number of bytes of metadata they allocated.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+void swift_enumerateMetadataCacheStatistics(
+    void (*callback)(void *context, const char *name, size_t numEntries,
+                     size_t numBytes),
+    void *context);
+
 /// Return the type name for a given type metadata.
 std::string nameForMetadata(const Metadata *type,
                             bool qualified = true);
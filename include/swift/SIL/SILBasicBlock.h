@@ -49,6 +49,10 @@ private:
   /// The ordered set of instructions in the SILBasicBlock.
   InstListType InstList;
 
+  /// The number of times this block was executed according to the profile
+  /// given with -profile-use, if it is known.
+  Optional<uint64_t> ExecutionCount;
+
   friend struct llvm::ilist_sentinel_traits<SILBasicBlock>;
   friend struct llvm::ilist_traits<SILBasicBlock>;
   SILBasicBlock() : Parent(0) {}
@@ -74,6 +78,11 @@ public:
   /// This method unlinks 'self' from the containing SILFunction and deletes it.
   void eraseFromParent();
 
+  /// Returns the number of times this block was executed in the profile given
+  /// with -profile-use, or None if it isn't known.
+  Optional<uint64_t> getExecutionCount() const { return ExecutionCount; }
+  void setExecutionCount(uint64_t Count) { ExecutionCount = Count; }
+
   /// This method unlinks 'self' from the containing SILFunction.
   void removeFromParent();
 
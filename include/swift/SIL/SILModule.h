@@ -101,6 +101,9 @@ private:
   /// Allocator that manages the memory of all the pieces of the SILModule.
   mutable llvm::BumpPtrAllocator BPA;
 
+  /// The number of bytes requested through allocate and allocateInst so far.
+  mutable uint64_t NumAllocatedBytes = 0;
+
   /// The swift Module associated with this SILModule.
   ModuleDecl *TheSwiftModule;
 
@@ -562,6 +565,10 @@ public:
   /// Deallocate memory of an instruction.
   void deallocateInst(SILInstruction *I);
 
+  /// Returns the number of bytes allocated for the module so far, including
+  /// the memory of instructions that have since been deallocated.
+  uint64_t getNumAllocatedBytes() const { return NumAllocatedBytes; }
+
   /// \brief Looks up the llvm intrinsic ID and type for the builtin function.
   ///
   /// \returns Returns llvm::Intrinsic::not_intrinsic if the function is not an
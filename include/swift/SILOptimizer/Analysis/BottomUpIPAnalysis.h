@@ -306,6 +306,32 @@ protected:
       FInfo->UpdateID = 0;
     }
   }
+
+  /// Invalidates \p FInfo, but keeps its callers valid. This is only correct
+  /// if the analysis data of \p FInfo is recomputed before it is used, and
+  /// the callers are invalidated with invalidateAllCallers() if the
+  /// recomputed data is not already included in the data of the callers.
+  template<typename FunctionInfo>
+  void invalidateExcludingCallers(FunctionInfo *FInfo) {
+    // The recomputation expects all caller entries to be valid.
+    FInfo->removeInvalidCallers();
+    FInfo->clear();
+    FInfo->UpdateID = 0;
+  }
+
+  /// Invalidates all callers of \p FInfo, including their callers.
+  template<typename FunctionInfo>
+  void invalidateAllCallers(FunctionInfo *FInfo) {
+    llvm::SmallVector<FunctionInfo *, 8> Callers;
+    for (const auto &E : FInfo->Callers) {
+      if (E.isValid() && E.Caller->isValid())
+        Callers.push_back(E.Caller);
+    }
+    for (FunctionInfo *Caller : Callers) {
+      if (Caller->isValid())
+        invalidateIncludingAllCallers(Caller);
+    }
+  }
 };
 
 } // end namespace swift
@@ -22,6 +22,9 @@ class SILBasicBlock;
 
 /// Cache a set of basic blocks that have been determined to be cold or hot.
 ///
+/// Blocks are cold if they are dominated by a _slowPath branch hint, or if the
+/// profile given with -profile-use shows that they were never executed.
+///
 /// This does not inherit from SILAnalysis because it is not worth preserving
 /// across passes.
 class ColdBlockInfo {
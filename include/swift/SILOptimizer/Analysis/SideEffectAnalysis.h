@@ -318,6 +318,14 @@ private:
   /// Callee analysis, used for determining the callees at call sites.
   BasicCalleeAnalysis *BCA;
 
+  /// The module, which is needed to recompute the analysis for verification.
+  SILModule *M;
+
+  /// Functions which were changed since their side-effects were computed.
+  /// Their side-effects are recomputed before the next query, and their
+  /// callers are only invalidated if the side-effects got worse.
+  llvm::SetVector<FunctionInfo *> PendingUpdates;
+
   /// Get the side-effects of a function, which has an @effects attribute.
   /// Returns true if \a F has an @effects attribute which could be handled.
   static bool getDefinedEffects(FunctionEffects &Effects, SILFunction *F);
@@ -354,9 +362,12 @@ private:
   /// all called functions, up to a recursion depth of MaxRecursionDepth.
   void recompute(FunctionInfo *Initial);
 
+  /// Recomputes the side-effects of the functions in PendingUpdates.
+  void applyPendingUpdates();
+
 public:
-  SideEffectAnalysis()
-      : BottomUpIPAnalysis(AnalysisKind::SideEffect) {}
+  SideEffectAnalysis(SILModule *M)
+      : BottomUpIPAnalysis(AnalysisKind::SideEffect), M(M) {}
 
   static bool classof(const SILAnalysis *S) {
     return S->getKind() == AnalysisKind::SideEffect;
@@ -366,6 +377,8 @@ public:
   
   /// Get the side-effects of a function.
   const FunctionEffects &getEffects(SILFunction *F) {
+    if (!PendingUpdates.empty())
+      applyPendingUpdates();
     FunctionInfo *FInfo = getFunctionInfo(F);
     if (!FInfo->isValid())
       recompute(FInfo);
@@ -375,11 +388,19 @@ public:
   /// Get the side-effects of a call site.
   void getEffects(FunctionEffects &ApplyEffects, FullApplySite FAS);
   
-  /// No invalidation is needed. See comment for SideEffectAnalysis.
+  /// Invalidates the side-effects of all functions, unless \p K only
+  /// includes changes to branches, which don't affect side-effects.
   virtual void invalidate(InvalidationKind K) override;
   
-  /// No invalidation is needed. See comment for SideEffectAnalysis.
+  /// Schedules the side-effects of \p F to be recomputed, unless \p K only
+  /// includes changes to branches. The side-effects of its callers are kept if
+  /// the recomputed side-effects of \p F are not worse than before.
   virtual void invalidate(SILFunction *F, InvalidationKind K)  override;
+
+  /// With -sil-verify-side-effect-updates, checks that the side-effects which
+  /// are kept across invalidations include all the side-effects of a full
+  /// recomputation.
+  virtual void verify() const override;
 };
 
 } // end namespace swift
@@ -287,6 +287,16 @@ private:
 
   std::unique_ptr<SerializedObjCMethodTable> ObjCMethods;
 
+  class DeclMemberNamesTableInfo;
+  using SerializedDeclMemberNamesTable =
+    llvm::OnDiskIterableChainedHashTable<DeclMemberNamesTableInfo>;
+
+  std::unique_ptr<SerializedDeclMemberNamesTable> DeclMemberNames;
+
+  /// The IDs of the nominal types and extensions whose members are loaded
+  /// lazily, used as keys into DeclMemberNames.
+  llvm::DenseMap<const Decl *, serialization::DeclID> LazyMemberContextIDs;
+
   llvm::DenseMap<const ValueDecl *, Identifier> PrivateDiscriminatorsByValue;
 
   TinyPtrVector<Decl *> ImportDecls;
@@ -394,6 +404,11 @@ private:
   std::unique_ptr<ModuleFile::SerializedObjCMethodTable>
   readObjCMethodTable(ArrayRef<uint64_t> fields, StringRef blobData);
 
+  /// Read an on-disk member name table stored in
+  /// index_block::DeclMemberNamesLayout format.
+  std::unique_ptr<ModuleFile::SerializedDeclMemberNamesTable>
+  readDeclMemberNamesTable(ArrayRef<uint64_t> fields, StringRef blobData);
+
   /// Reads the index block, which contains global tables.
   ///
   /// Returns false if there was an error.
@@ -607,6 +622,10 @@ public:
   virtual void loadAllMembers(Decl *D,
                               uint64_t contextData) override;
 
+  virtual bool
+  loadNamedMembers(const Decl *D, Identifier N, uint64_t contextData,
+                   SmallVectorImpl<ValueDecl *> &Members) override;
+
   virtual void
   loadAllConformances(const Decl *D, uint64_t contextData,
                     SmallVectorImpl<ProtocolConformance*> &Conforms) override;
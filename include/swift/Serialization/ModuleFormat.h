@@ -53,7 +53,7 @@ const uint16_t VERSION_MAJOR = 0;
 /// in source control, you should also update the comment to briefly
 /// describe what change you made. The content of this comment isn't important;
 /// it just ensures a conflict if two people change the module format.
-const uint16_t VERSION_MINOR = 239; // multiple results for SILFunctionType
+const uint16_t VERSION_MINOR = 240; // per-context member name table
 
 using DeclID = PointerEmbeddedInt<unsigned, 31>;
 using DeclIDField = BCFixed<31>;
@@ -1450,6 +1450,11 @@ namespace index_block {
     DECL_CONTEXT_OFFSETS,
     LOCAL_TYPE_DECLS,
     NORMAL_CONFORMANCE_OFFSETS,
+
+    /// The member name index, which maps each nominal type or extension and
+    /// the base name of some of its members to those members, so that they
+    /// can be loaded without loading all of the context's members.
+    DECL_MEMBER_NAMES,
   };
 
   using OffsetsLayout = BCGenericRecordLayout<
@@ -1474,6 +1479,12 @@ namespace index_block {
     BCBlob         // map from Objective-C selectors to methods with that selector
   >;
 
+  using DeclMemberNamesLayout = BCRecordLayout<
+    DECL_MEMBER_NAMES, // record ID
+    BCVBR<16>,         // table offset within the blob (see below)
+    BCBlob             // map from context IDs and names to member decl IDs
+  >;
+
   using EntryPointLayout = BCRecordLayout<
     ENTRY_POINT,
     DeclIDField  // the ID of the main class; 0 if there was a main source file
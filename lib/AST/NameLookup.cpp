@@ -923,8 +923,57 @@ void NominalTypeDecl::makeMemberVisible(ValueDecl *member) {
   LookupTable.getPointer()->addMember(member);
 }
 
+bool NominalTypeDecl::prepareLookupTableForName(DeclName name,
+                                                bool ignoreNewExtensions) {
+  if (!getASTContext().LangOpts.NamedLazyMemberLoading)
+    return false;
+
+  if (!LookupTable.getPointer()) {
+    auto &ctx = getASTContext();
+    LookupTable.setPointer(new (ctx) MemberLookupTable(ctx));
+  }
+  auto *table = LookupTable.getPointer();
+
+  // Adds the members named 'name' from a lazily-loaded context. Members that
+  // were added to the context directly are always in its member list.
+  auto addNamedMembers = [&](const IterableDeclContext *IDC,
+                             const Decl *D) -> bool {
+    SmallVector<ValueDecl *, 4> members;
+    if (!IDC->getLoader()->loadNamedMembers(D, name.getBaseName(),
+                                            IDC->getLoaderContextData(),
+                                            members))
+      return false;
+    for (auto member : members)
+      table->addMember(member);
+    table->addMembers(IDC->getCurrentMembersWithoutLoading());
+    return true;
+  };
+
+  if (!addNamedMembers(this, this))
+    return false;
+
+  if (!ignoreNewExtensions) {
+    for (auto E : getExtensions()) {
+      if (!E->isLazy() || !addNamedMembers(E, E))
+        table->addMembers(E->getMembers());
+    }
+  }
+
+  return true;
+}
+
 ArrayRef<ValueDecl *> NominalTypeDecl::lookupDirect(DeclName name,
                                                     bool ignoreNewExtensions) {
+  // If none of this type's members have been loaded yet, try to load just
+  // the ones with this name.
+  if (isLazy() && !name.getBaseName().empty() &&
+      prepareLookupTableForName(name, ignoreNewExtensions)) {
+    auto known = LookupTable.getPointer()->find(name);
+    if (known == LookupTable.getPointer()->end())
+      return { };
+    return { known->second.begin(), known->second.size() };
+  }
+
   // Make sure we have the complete list of members (in this nominal and in all
   // extensions).
   if (!ignoreNewExtensions) {
@@ -0,0 +1,288 @@
+//===--- ReferenceDependencies.cpp - Swift dependency files ---------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// The binary encoding is laid out as follows. All integers are little-endian.
+//
+//   char     signature[4]          "\xC0SDP"
+//   uint16   versionMajor
+//   uint16   versionMinor
+//   uint32   numStrings
+//   uint32   numEntries
+//   uint32   stringDataSize
+//   uint32   stringOffsets[numStrings + 1]
+//   uint32   entries[numEntries]
+//   char     stringData[stringDataSize]
+//
+// String N is stringData[stringOffsets[N] ..< stringOffsets[N+1]]. Each entry
+// packs its section into the top four bits, a "non-cascading" flag into the
+// next bit, and the index of its string into the rest. The string of a
+// fingerprint entry is the provided name followed by '\0' and the fingerprint.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/ReferenceDependencies.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/YAMLParser.h"
+
+using namespace swift;
+using namespace swift::reference_dependencies;
+
+namespace {
+const char Signature[] = { '\xC0', 'S', 'D', 'P' };
+const uint16_t VersionMajor = 1;
+const uint16_t VersionMinor = 1;
+
+const unsigned HeaderSize = sizeof(Signature) + 2 * sizeof(uint16_t) +
+                            3 * sizeof(uint32_t);
+
+const unsigned SectionShift = 28;
+const uint32_t NonCascadingBit = 1u << 27;
+const uint32_t StringIndexMask = NonCascadingBit - 1;
+} // end anonymous namespace
+
+StringRef reference_dependencies::getSectionKey(Section section) {
+  switch (section) {
+  case Section::ProvidesTopLevel: return "provides-top-level";
+  case Section::ProvidesNominal: return "provides-nominal";
+  case Section::ProvidesMember: return "provides-member";
+  case Section::ProvidesDynamicLookup: return "provides-dynamic-lookup";
+  case Section::DependsTopLevel: return "depends-top-level";
+  case Section::DependsMember: return "depends-member";
+  case Section::DependsNominal: return "depends-nominal";
+  case Section::DependsDynamicLookup: return "depends-dynamic-lookup";
+  case Section::DependsExternal: return "depends-external";
+  case Section::InterfaceHash: return "interface-hash";
+  case Section::TopLevelFingerprints: return "top-level-fingerprints";
+  case Section::NominalFingerprints: return "nominal-fingerprints";
+  case Section::MemberFingerprints: return "member-fingerprints";
+  case Section::DynamicLookupFingerprints:
+    return "dynamic-lookup-fingerprints";
+  }
+  llvm_unreachable("unhandled section");
+}
+
+Writer::~Writer() = default;
+
+namespace {
+class YAMLWriter final : public Writer {
+  raw_ostream &Out;
+
+  void beginEntry(bool isCascading) {
+    Out << "- ";
+    if (!isCascading)
+      Out << "!private ";
+  }
+
+public:
+  explicit YAMLWriter(raw_ostream &out) : Out(out) {
+    Out << "### Swift dependencies file v0 ###\n";
+  }
+
+  void beginSection(Section section) override {
+    assert(section != Section::InterfaceHash && "use setInterfaceHash");
+    Out << getSectionKey(section) << ":\n";
+  }
+
+  void addName(StringRef name, bool isCascading) override {
+    beginEntry(isCascading);
+    Out << "\"" << llvm::yaml::escape(name) << "\"\n";
+  }
+
+  void addMember(StringRef baseName, StringRef memberName,
+                 bool isCascading) override {
+    beginEntry(isCascading);
+    Out << "[\"" << baseName << "\", \"";
+    if (!memberName.empty())
+      Out << llvm::yaml::escape(memberName);
+    Out << "\"]\n";
+  }
+
+  void addFingerprint(StringRef name, StringRef fingerprint) override {
+    Out << "- [\"" << llvm::yaml::escape(name) << "\", \"" << fingerprint
+        << "\"]\n";
+  }
+
+  void addMemberFingerprint(StringRef baseName, StringRef memberName,
+                            StringRef fingerprint) override {
+    Out << "- [\"" << baseName << "\", \"" << llvm::yaml::escape(memberName)
+        << "\", \"" << fingerprint << "\"]\n";
+  }
+
+  void setInterfaceHash(StringRef hash) override {
+    Out << getSectionKey(Section::InterfaceHash) << ": \"" << hash << "\"\n";
+  }
+};
+
+class BinaryWriter final : public Writer {
+  raw_ostream &Out;
+  Section Current = Section::ProvidesTopLevel;
+
+  llvm::StringMap<uint32_t> StringIndices;
+  SmallVector<uint32_t, 64> StringOffsets{0};
+  SmallString<1024> StringData;
+  std::vector<uint32_t> Entries;
+
+  uint32_t intern(StringRef str) {
+    uint32_t nextIndex = StringOffsets.size() - 1;
+    auto insertResult = StringIndices.insert({str, nextIndex});
+    if (insertResult.second) {
+      StringData += str;
+      StringOffsets.push_back(StringData.size());
+    }
+    return insertResult.first->getValue();
+  }
+
+  void addEntry(Section section, StringRef str, bool isCascading) {
+    uint32_t index = intern(str);
+    assert(index <= StringIndexMask && "too many names");
+    uint32_t entry = (uint32_t(section) << SectionShift) | index;
+    if (!isCascading)
+      entry |= NonCascadingBit;
+    Entries.push_back(entry);
+  }
+
+public:
+  explicit BinaryWriter(raw_ostream &out) : Out(out) {}
+
+  void beginSection(Section section) override {
+    assert(section != Section::InterfaceHash && "use setInterfaceHash");
+    Current = section;
+  }
+
+  void addName(StringRef name, bool isCascading) override {
+    addEntry(Current, name, isCascading);
+  }
+
+  void addMember(StringRef baseName, StringRef memberName,
+                 bool isCascading) override {
+    SmallString<64> joined{baseName};
+    joined.push_back('\0');
+    joined += memberName;
+    addEntry(Current, joined, isCascading);
+  }
+
+  void addFingerprint(StringRef name, StringRef fingerprint) override {
+    SmallString<64> joined{name};
+    joined.push_back('\0');
+    joined += fingerprint;
+    addEntry(Current, joined, /*isCascading=*/true);
+  }
+
+  void addMemberFingerprint(StringRef baseName, StringRef memberName,
+                            StringRef fingerprint) override {
+    SmallString<96> joined{baseName};
+    joined.push_back('\0');
+    joined += memberName;
+    joined.push_back('\0');
+    joined += fingerprint;
+    addEntry(Current, joined, /*isCascading=*/true);
+  }
+
+  void setInterfaceHash(StringRef hash) override {
+    addEntry(Section::InterfaceHash, hash, /*isCascading=*/true);
+  }
+
+  void finish() override {
+    llvm::support::endian::Writer<llvm::support::little> writer(Out);
+    Out.write(Signature, sizeof(Signature));
+    writer.write<uint16_t>(VersionMajor);
+    writer.write<uint16_t>(VersionMinor);
+    writer.write<uint32_t>(StringOffsets.size() - 1);
+    writer.write<uint32_t>(Entries.size());
+    writer.write<uint32_t>(StringData.size());
+    for (uint32_t offset : StringOffsets)
+      writer.write<uint32_t>(offset);
+    for (uint32_t entry : Entries)
+      writer.write<uint32_t>(entry);
+    Out << StringData;
+  }
+};
+} // end anonymous namespace
+
+std::unique_ptr<Writer>
+reference_dependencies::createYAMLWriter(raw_ostream &out) {
+  return std::unique_ptr<Writer>(new YAMLWriter(out));
+}
+
+std::unique_ptr<Writer>
+reference_dependencies::createBinaryWriter(raw_ostream &out) {
+  return std::unique_ptr<Writer>(new BinaryWriter(out));
+}
+
+bool reference_dependencies::isBinary(StringRef data) {
+  return data.startswith(StringRef(Signature, sizeof(Signature)));
+}
+
+bool reference_dependencies::readBinary(
+    StringRef data, llvm::function_ref<EntryCallbackTy> callback) {
+  using namespace llvm::support;
+
+  if (data.size() < HeaderSize || !isBinary(data))
+    return true;
+
+  const char *cursor = data.data() + sizeof(Signature);
+  auto read16 = [&cursor]() -> uint16_t {
+    return endian::readNext<uint16_t, little, unaligned>(cursor);
+  };
+  auto read32 = [&cursor]() -> uint32_t {
+    return endian::readNext<uint32_t, little, unaligned>(cursor);
+  };
+
+  if (read16() != VersionMajor)
+    return true;
+  (void)read16(); // versionMinor
+
+  uint64_t numStrings = read32();
+  uint64_t numEntries = read32();
+  uint64_t stringDataSize = read32();
+  if (HeaderSize + 4 * (numStrings + 1 + numEntries) + stringDataSize !=
+      data.size()) {
+    return true;
+  }
+
+  const char *stringOffsets = cursor;
+  const char *entries = stringOffsets + 4 * (numStrings + 1);
+  const char *stringData = entries + 4 * numEntries;
+
+  auto getString = [&](uint32_t index, StringRef &result) -> bool {
+    if (index >= numStrings)
+      return true;
+    const char *offsetPtr = stringOffsets + 4 * index;
+    uint32_t start = endian::readNext<uint32_t, little, unaligned>(offsetPtr);
+    uint32_t end = endian::readNext<uint32_t, little, unaligned>(offsetPtr);
+    if (start > end || end > stringDataSize)
+      return true;
+    result = StringRef(stringData + start, end - start);
+    return false;
+  };
+
+  cursor = entries;
+  for (uint64_t i = 0; i != numEntries; ++i) {
+    uint32_t entry = read32();
+    uint32_t rawSection = entry >> SectionShift;
+    if (rawSection > uint32_t(Section::Last_Section))
+      return true;
+
+    StringRef name;
+    if (getString(entry & StringIndexMask, name))
+      return true;
+    if (callback(Section(rawSection), name, !(entry & NonCascadingBit)))
+      return true;
+  }
+
+  return false;
+}
@@ -19,6 +19,8 @@
 
 #include "swift/Basic/TaskQueue.h"
 
+#include <algorithm>
+
 using namespace swift;
 using namespace swift::sys;
 
@@ -34,6 +36,37 @@ TaskQueue::TaskQueue(unsigned NumberOfParallelTasks)
 
 TaskQueue::~TaskQueue() = default;
 
+void TaskQueue::enqueueTask(std::unique_ptr<Task> T, uint64_t Cost) {
+  // When tasks run one at a time, the order doesn't change how long the
+  // whole queue takes, so keep it predictable.
+  if (getNumberOfParallelTasks() <= 1)
+    Cost = 0;
+
+  QueuedTasks.push_back({std::move(T), Cost, NextSequenceNumber++});
+  std::push_heap(QueuedTasks.begin(), QueuedTasks.end());
+}
+
+std::unique_ptr<Task> TaskQueue::dequeueTask() {
+  assert(!QueuedTasks.empty() && "no queued tasks");
+  std::pop_heap(QueuedTasks.begin(), QueuedTasks.end());
+  std::unique_ptr<Task> T = std::move(QueuedTasks.back().T);
+  QueuedTasks.pop_back();
+  return T;
+}
+
+bool TaskQueue::isAtParallelLimit(size_t NumExecutingTasks) const {
+  unsigned MaxNumberOfParallelTasks = getNumberOfParallelTasks();
+  if (MaxNumberOfParallelTasks == 0)
+    MaxNumberOfParallelTasks = 1;
+  if (NumExecutingTasks >= MaxNumberOfParallelTasks)
+    return true;
+
+  // Always allow one task to run, however little memory there is.
+  if (NumExecutingTasks > 0 && MinAvailableMemory > 0)
+    return getAvailableMemory() < MinAvailableMemory;
+  return false;
+}
+
 // DummyTaskQueue implementation
 
 DummyTaskQueue::DummyTaskQueue(unsigned NumberOfParallelTasks)
@@ -42,7 +75,8 @@ DummyTaskQueue::DummyTaskQueue(unsigned NumberOfParallelTasks)
 DummyTaskQueue::~DummyTaskQueue() = default;
 
 void DummyTaskQueue::addTask(const char *ExecPath, ArrayRef<const char *> Args,
-                             ArrayRef<const char *> Env, void *Context) {
+                             ArrayRef<const char *> Env, void *Context,
+                             uint64_t Cost) {
   QueuedTasks.emplace(
     std::unique_ptr<DummyTask>(new DummyTask(ExecPath, Args, Env, Context)));
 }
@@ -80,7 +114,8 @@ bool DummyTaskQueue::execute(TaskQueue::TaskBeganCallback Began,
 
     if (Finished) {
       std::string Output = "Output placeholder\n";
-        if (Finished(P.first, 0, Output, P.second->Context) ==
+        if (Finished(P.first, 0, Output, P.second->Context,
+                     TaskResourceUsage()) ==
             TaskFinishedResponse::StopExecution)
           SubtaskFailed = true;
     }
@@ -0,0 +1,269 @@
+//===--- BuildHistory.cpp - Timing of driver jobs across builds -----------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Driver/BuildHistory.h"
+
+#include "swift/Basic/JSONSerialization.h"
+#include "swift/Driver/Action.h"
+#include "swift/Driver/Job.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace swift;
+using namespace swift::driver;
+
+bool BuildHistory::read(StringRef Path) {
+  // Treat a missing file as "no previous build".
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return false;
+
+  namespace yaml = llvm::yaml;
+
+  llvm::SourceMgr SM;
+  yaml::Stream Stream(Buffer.get()->getMemBufferRef(), SM);
+
+  auto I = Stream.begin();
+  if (I == Stream.end() || !I->getRoot())
+    return true;
+
+  auto *TopLevelMap = dyn_cast<yaml::MappingNode>(I->getRoot());
+  if (!TopLevelMap)
+    return true;
+  SmallString<64> Scratch;
+
+  // FIXME: LLVM's YAML support does incremental parsing in such a way that
+  // for-range loops break.
+  for (auto i = TopLevelMap->begin(), e = TopLevelMap->end(); i != e; ++i) {
+    auto *Key = dyn_cast<yaml::ScalarNode>(i->getKey());
+    if (!Key)
+      return true;
+    if (Key->getValue(Scratch) != "job_history")
+      continue;
+
+    auto *InputMap = dyn_cast<yaml::MappingNode>(i->getValue());
+    if (!InputMap)
+      return true;
+
+    for (auto j = InputMap->begin(), je = InputMap->end(); j != je; ++j) {
+      auto *Input = dyn_cast<yaml::ScalarNode>(j->getKey());
+      if (!Input)
+        return true;
+      SmallString<64> InputScratch;
+      StringRef InputName = Input->getValue(InputScratch);
+
+      auto *Fields = dyn_cast<yaml::MappingNode>(j->getValue());
+      if (!Fields)
+        return true;
+
+      JobHistoryEntry Entry;
+      for (auto k = Fields->begin(), ke = Fields->end(); k != ke; ++k) {
+        auto *FieldKey = dyn_cast<yaml::ScalarNode>(k->getKey());
+        auto *FieldValue = dyn_cast<yaml::ScalarNode>(k->getValue());
+        if (!FieldKey || !FieldValue)
+          return true;
+
+        uint64_t *Field =
+            llvm::StringSwitch<uint64_t *>(FieldKey->getValue(Scratch))
+              .Case("wall_us", &Entry.WallTimeMicros)
+              .Case("cpu_us", &Entry.CPUTimeMicros)
+              .Case("max_rss", &Entry.MaxRSSBytes)
+              .Default(nullptr);
+        // Ignore fields written by newer compilers.
+        if (!Field)
+          continue;
+        if (FieldValue->getValue(Scratch).getAsInteger(10, *Field))
+          return true;
+      }
+
+      record(InputName, Entry);
+    }
+  }
+
+  return false;
+}
+
+void BuildHistory::write(raw_ostream &Out, ArrayRef<StringRef> Inputs) const {
+  bool WroteHeader = false;
+  for (StringRef Input : Inputs) {
+    const JobHistoryEntry *Entry = lookup(Input);
+    if (!Entry)
+      continue;
+
+    if (!WroteHeader) {
+      Out << "job_history:\n";
+      WroteHeader = true;
+    }
+    Out << "  \"" << llvm::yaml::escape(Input) << "\": {"
+        << "wall_us: " << Entry->WallTimeMicros << ", "
+        << "cpu_us: " << Entry->CPUTimeMicros << ", "
+        << "max_rss: " << Entry->MaxRSSBytes << "}\n";
+  }
+}
+
+namespace {
+  struct TraceEventArgs {
+    uint64_t CPUTimeMicros;
+    uint64_t MaxRSSBytes;
+    std::string WaitedOn;
+  };
+
+  /// A "complete" event, which has both a start time and a duration.
+  struct TraceEvent {
+    std::string Name;
+    std::string Category;
+    std::string Phase = "X";
+    uint64_t Timestamp;
+    uint64_t Duration;
+    uint32_t Pid = 0;
+    uint32_t Tid;
+    TraceEventArgs Args;
+  };
+
+  struct Trace {
+    std::vector<TraceEvent> Events;
+    std::string DisplayTimeUnit = "ms";
+  };
+}
+
+namespace swift {
+namespace json {
+  template<>
+  struct ObjectTraits<TraceEventArgs> {
+    static void mapping(Output &out, TraceEventArgs &value) {
+      out.mapRequired("cpu_us", value.CPUTimeMicros);
+      out.mapRequired("max_rss", value.MaxRSSBytes);
+      out.mapOptional("waited_on", value.WaitedOn, std::string());
+    }
+  };
+
+  template<>
+  struct ObjectTraits<TraceEvent> {
+    static void mapping(Output &out, TraceEvent &value) {
+      out.mapRequired("name", value.Name);
+      out.mapRequired("cat", value.Category);
+      out.mapRequired("ph", value.Phase);
+      out.mapRequired("ts", value.Timestamp);
+      out.mapRequired("dur", value.Duration);
+      out.mapRequired("pid", value.Pid);
+      out.mapRequired("tid", value.Tid);
+      out.mapRequired("args", value.Args);
+    }
+  };
+
+  template<>
+  struct ArrayTraits<std::vector<TraceEvent>> {
+    static size_t size(Output &out, std::vector<TraceEvent> &seq) {
+      return seq.size();
+    }
+
+    static TraceEvent &element(Output &out, std::vector<TraceEvent> &seq,
+                               size_t index) {
+      if (index >= seq.size())
+        seq.resize(index+1);
+      return seq[index];
+    }
+  };
+
+  template<>
+  struct ObjectTraits<Trace> {
+    static void mapping(Output &out, Trace &value) {
+      out.mapRequired("traceEvents", value.Events);
+      out.mapRequired("displayTimeUnit", value.DisplayTimeUnit);
+    }
+  };
+} // end namespace json
+} // end namespace swift
+
+void driver::writeTrace(raw_ostream &Out, ArrayRef<TaskTiming> Timings) {
+  llvm::DenseMap<const Job *, const TaskTiming *> ByJob;
+  for (const TaskTiming &Timing : Timings)
+    ByJob[Timing.Cmd] = &Timing;
+
+  Trace T;
+  for (const TaskTiming &Timing : Timings) {
+    if (!Timing.Finished)
+      continue;
+
+    TraceEvent Event;
+    Event.Name = Timing.Description;
+    Event.Category = Timing.Cmd->getSource().getClassName();
+    Event.Timestamp = Timing.StartMicros;
+    Event.Duration = Timing.EndMicros - Timing.StartMicros;
+    Event.Tid = Timing.Lane;
+    Event.Args.CPUTimeMicros = Timing.Usage.getCPUTimeMicros();
+    Event.Args.MaxRSSBytes = Timing.Usage.MaxRSSBytes;
+    if (const TaskTiming *WaitedOn = ByJob.lookup(Timing.WaitedOn))
+      Event.Args.WaitedOn = WaitedOn->Description;
+    T.Events.push_back(std::move(Event));
+  }
+
+  json::Output JOut(Out);
+  JOut << T;
+  Out << "\n";
+}
+
+void driver::printCriticalPath(raw_ostream &Out,
+                               ArrayRef<TaskTiming> Timings) {
+  llvm::DenseMap<const Job *, const TaskTiming *> ByJob;
+  const TaskTiming *Last = nullptr;
+  for (const TaskTiming &Timing : Timings) {
+    if (!Timing.Finished)
+      continue;
+    ByJob[Timing.Cmd] = &Timing;
+    if (!Last || Timing.EndMicros > Last->EndMicros)
+      Last = &Timing;
+  }
+  if (!Last)
+    return;
+
+  // Every task waited on one that finished before it started, so this always
+  // reaches a task that was ready at the start of the build.
+  SmallVector<const TaskTiming *, 8> Path;
+  for (const TaskTiming *Timing = Last; Timing;
+       Timing = ByJob.lookup(Timing->WaitedOn)) {
+    Path.push_back(Timing);
+  }
+  std::reverse(Path.begin(), Path.end());
+
+  auto seconds = [](uint64_t Micros) -> double { return Micros / 1e6; };
+
+  uint64_t Running = 0;
+  for (const TaskTiming *Timing : Path)
+    Running += Timing->EndMicros - Timing->StartMicros;
+
+  Out << "Critical path: " << Path.size()
+      << (Path.size() == 1 ? " task" : " tasks") << " running for "
+      << llvm::format("%.2f", seconds(Running)) << "s of "
+      << llvm::format("%.2f", seconds(Last->EndMicros)) << "s\n";
+  Out << "     start   running    queued\n";
+
+  uint64_t ReadyMicros = Path.front()->StartMicros;
+  for (const TaskTiming *Timing : Path) {
+    uint64_t Queued = Timing->StartMicros - std::min(ReadyMicros,
+                                                     Timing->StartMicros);
+    Out << llvm::format("  %7.2fs  %7.2fs  %7.2fs  ",
+                        seconds(Timing->StartMicros),
+                        seconds(Timing->EndMicros - Timing->StartMicros),
+                        seconds(Queued))
+        << Timing->Description << "\n";
+    ReadyMicros = Timing->EndMicros;
+  }
+}
@@ -24,8 +24,10 @@
 #include "swift/Driver/Driver.h"
 #include "swift/Driver/Job.h"
 #include "swift/Driver/ParseableOutput.h"
+#include "swift/Driver/ToolChain.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Option/Arg.h"
@@ -35,6 +37,8 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/YAMLParser.h"
 
+#include <algorithm>
+
 using namespace swift;
 using namespace swift::sys;
 using namespace swift::driver;
@@ -83,11 +87,38 @@ namespace {
     ///
     /// Only intended for source files.
     llvm::SmallDenseMap<const Job *, bool, 16> UnfinishedCommands;
+
+    /// In batch mode, the compile jobs that have been scheduled but not yet
+    /// combined into batches and handed to the TaskQueue.
+    SmallVector<const Job *, 16> PendingBatchableCommands;
+
+    /// In batch mode, the jobs created to run several compile jobs at once,
+    /// along with the jobs each of them stands for.
+    SmallVector<std::unique_ptr<const Job>, 4> BatchJobs;
+    llvm::SmallDenseMap<const Job *, SmallVector<const Job *, 4>, 4>
+        BatchConstituents;
+
+    /// When each task began and finished, in the order they began.
+    std::vector<TaskTiming> Timings;
+    llvm::SmallDenseMap<const Job *, size_t, 16> TimingIndices;
+
+    /// The task whose completion is being handled, if any. Tasks queued in
+    /// the meantime are recorded as having waited on it.
+    const Job *FinishingTask = nullptr;
+    llvm::SmallDenseMap<const Job *, const Job *, 16> WaitedOn;
+
+    /// The task currently occupying each lane of the trace, or null.
+    SmallVector<const Job *, 8> Lanes;
   };
 }
 
 Compilation::~Compilation() = default;
 
+void Compilation::enableBatchMode(const ToolChain &TC, const OutputInfo &OI) {
+  BatchModeToolChain = &TC;
+  BatchModeOutputInfo.reset(new OutputInfo(OI));
+}
+
 Job *Compilation::addJob(std::unique_ptr<Job> J) {
   Job *result = J.get();
   Jobs.emplace_back(std::move(J));
@@ -174,7 +205,8 @@ static void checkForOutOfDateInputs(DiagnosticEngine &diags,
 
 static void writeCompilationRecord(StringRef path, StringRef argsHash,
                                    llvm::sys::TimeValue buildTime,
-                                   const InputInfoMap &inputs) {
+                                   const InputInfoMap &inputs,
+                                   const BuildHistory &history) {
   std::error_code error;
   llvm::raw_fd_ostream out(path, error, llvm::sys::fs::F_None);
   if (out.has_error()) {
@@ -213,6 +245,11 @@ static void writeCompilationRecord(StringRef path, StringRef argsHash,
     writeTimeValue(out, entry.second.previousModTime);
     out << "\n";
   }
+
+  SmallVector<StringRef, 16> inputPaths;
+  for (auto &entry : inputs)
+    inputPaths.push_back(entry.first->getValue());
+  history.write(out, inputPaths);
 }
 
 static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
@@ -252,6 +289,77 @@ static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
   return true;
 }
 
+/// Works out how long each byte of source took to compile in earlier builds,
+/// so that inputs without a history can be weighed against those with one.
+/// Without any history, costs are simply sizes in bytes.
+static double estimateMicrosPerByte(ArrayRef<InputPair> Inputs,
+                                    const BuildHistory &History) {
+  uint64_t TotalMicros = 0;
+  uint64_t TotalBytes = 0;
+  for (auto &Input : Inputs) {
+    StringRef Path = Input.second->getValue();
+    const JobHistoryEntry *Entry = History.lookup(Path);
+    uint64_t Size;
+    if (!Entry || llvm::sys::fs::file_size(Path, Size))
+      continue;
+    TotalMicros += Entry->WallTimeMicros;
+    TotalBytes += Size;
+  }
+  if (TotalMicros == 0 || TotalBytes == 0)
+    return 1.0;
+  return double(TotalMicros) / TotalBytes;
+}
+
+/// Estimates how long compiling the source file at \p Path will take: as
+/// long as it took in the last build, or failing that, a time proportional
+/// to its size.
+static uint64_t estimateInputCost(StringRef Path, const BuildHistory &History,
+                                  double MicrosPerByte) {
+  if (const JobHistoryEntry *Entry = History.lookup(Path))
+    return Entry->WallTimeMicros;
+  uint64_t Size;
+  if (llvm::sys::fs::file_size(Path, Size))
+    return 0;
+  return Size * MicrosPerByte;
+}
+
+/// Estimates how long \p Cmd will take to run, so that the TaskQueue can
+/// start the longest jobs first. Compile jobs are weighed by the source files
+/// they compile; everything else is cheap in comparison.
+static uint64_t estimateJobCost(const Job *Cmd, const BuildHistory &History,
+                                double MicrosPerByte) {
+  if (!isa<CompileJobAction>(Cmd->getSource()))
+    return 0;
+
+  uint64_t Cost = 0;
+  for (const Action *A : Cmd->getSource().getInputs()) {
+    if (auto *Input = dyn_cast<InputAction>(A))
+      Cost += estimateInputCost(Input->getInputArg().getValue(), History,
+                                MicrosPerByte);
+  }
+  return Cost;
+}
+
+static uint64_t microsecondsSince(llvm::sys::TimeValue Start) {
+  llvm::sys::TimeValue Elapsed = llvm::sys::TimeValue::now() - Start;
+  if (Elapsed.seconds() < 0)
+    return 0;
+  return uint64_t(Elapsed.seconds()) * 1000000 + Elapsed.microseconds();
+}
+
+static bool writeTraceFile(DiagnosticEngine &Diags, StringRef Path,
+                           ArrayRef<TaskTiming> Timings) {
+  std::error_code EC;
+  llvm::raw_fd_ostream Out(Path, EC, llvm::sys::fs::F_None);
+  if (EC) {
+    Diags.diagnose(SourceLoc(), diag::error_opening_output, Path,
+                   EC.message());
+    return false;
+  }
+  writeTrace(Out, Timings);
+  return true;
+}
+
 int Compilation::performJobsImpl() {
   // Create a TaskQueue for execution.
   std::unique_ptr<TaskQueue> TQ;
@@ -259,9 +367,15 @@ int Compilation::performJobsImpl() {
     TQ.reset(new DummyTaskQueue(NumberOfParallelCommands));
   else
     TQ.reset(new TaskQueue(NumberOfParallelCommands));
+  TQ->setMinAvailableMemory(MinAvailableMemory);
 
   PerformJobsState State;
 
+  double MicrosPerByte = estimateMicrosPerByte(getInputFiles(), History);
+  auto estimateCost = [&](const Job *Cmd) -> uint64_t {
+    return estimateJobCost(Cmd, History, MicrosPerByte);
+  };
+
   using DependencyGraph = DependencyGraph<const Job *>;
   DependencyGraph DepGraph;
   SmallPtrSet<const Job *, 16> DeferredCommands;
@@ -286,6 +400,20 @@ int Compilation::performJobsImpl() {
     });
   };
 
+  auto addTaskForCommand = [&] (const Job *Cmd, uint64_t Cost) {
+    // FIXME: Failing here should not take down the whole process.
+    bool success = writeFilelistIfNecessary(Cmd, Diags);
+    assert(success && "failed to write filelist");
+    (void)success;
+
+    assert(Cmd->getExtraEnvironment().empty() &&
+           "not implemented for compilations with multiple jobs");
+    if (State.FinishingTask)
+      State.WaitedOn[Cmd] = State.FinishingTask;
+    TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
+                (void *)Cmd, Cost);
+  };
+
   // Set up scheduleCommandIfNecessaryAndPossible.
   // This will only schedule the given command if it has not been scheduled
   // and if all of its inputs are in FinishedCommands.
@@ -299,16 +427,157 @@ int Compilation::performJobsImpl() {
       return;
     }
 
-    // FIXME: Failing here should not take down the whole process.
-    bool success = writeFilelistIfNecessary(Cmd, Diags);
-    assert(success && "failed to write filelist");
-    (void)success;
-
-    assert(Cmd->getExtraEnvironment().empty() &&
-           "not implemented for compilations with multiple jobs");
     State.ScheduledCommands.insert(Cmd);
-    TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
-                (void *)Cmd);
+
+    // In batch mode, compile jobs wait until everything that can run at the
+    // same time is known; see addPendingBatchableCommands.
+    if (getBatchModeEnabled() && BatchModeToolChain->jobIsBatchable(Cmd)) {
+      State.PendingBatchableCommands.push_back(Cmd);
+      return;
+    }
+
+    addTaskForCommand(Cmd, estimateCost(Cmd));
+  };
+
+  // Divides the pending compile jobs into about one batch per parallel
+  // command, handing the biggest jobs out first to whichever batch has the
+  // least work so far, and queues each batch as a single frontend invocation.
+  auto addPendingBatchableCommands = [&] {
+    auto &Pending = State.PendingBatchableCommands;
+    if (Pending.empty())
+      return;
+
+    SmallVector<std::pair<uint64_t, const Job *>, 16> ByCost;
+    for (const Job *Cmd : Pending)
+      ByCost.push_back({estimateCost(Cmd), Cmd});
+    Pending.clear();
+    std::stable_sort(ByCost.begin(), ByCost.end(),
+                     [](const std::pair<uint64_t, const Job *> &LHS,
+                        const std::pair<uint64_t, const Job *> &RHS) {
+      return LHS.first > RHS.first;
+    });
+
+    struct Batch {
+      uint64_t Cost = 0;
+      SmallVector<const Job *, 16> Jobs;
+    };
+    size_t NumBatches = std::min<size_t>(
+      std::max(NumberOfParallelCommands, 1U), ByCost.size());
+    SmallVector<Batch, 8> Batches(NumBatches);
+    for (auto &Entry : ByCost) {
+      auto Lightest = std::min_element(Batches.begin(), Batches.end(),
+                                       [](const Batch &LHS, const Batch &RHS) {
+        if (LHS.Cost != RHS.Cost)
+          return LHS.Cost < RHS.Cost;
+        return LHS.Jobs.size() < RHS.Jobs.size();
+      });
+      Lightest->Cost += Entry.first;
+      Lightest->Jobs.push_back(Entry.second);
+    }
+
+    for (Batch &B : Batches) {
+      if (B.Jobs.size() == 1) {
+        addTaskForCommand(B.Jobs.front(), B.Cost);
+        continue;
+      }
+
+      std::unique_ptr<Job> BatchJob =
+        BatchModeToolChain->constructBatchJob(B.Jobs, *this,
+                                              *BatchModeOutputInfo);
+      const Job *BatchCmd = BatchJob.get();
+      State.BatchConstituents[BatchCmd].append(B.Jobs.begin(), B.Jobs.end());
+      State.BatchJobs.push_back(std::move(BatchJob));
+      addTaskForCommand(BatchCmd, B.Cost);
+    }
+  };
+
+  // Calls \p Fn on each job that a task stands for: the jobs in its batch,
+  // or just the task's own job outside of batch mode.
+  auto forEachConstituent = [&] (const Job *Cmd,
+                                 llvm::function_ref<void(const Job *)> Fn) {
+    auto Found = State.BatchConstituents.find(Cmd);
+    if (Found == State.BatchConstituents.end()) {
+      Fn(Cmd);
+      return;
+    }
+    for (const Job *Constituent : Found->second)
+      Fn(Constituent);
+  };
+
+  // Describes a task for the trace and the critical path report.
+  auto describeTask = [&] (const Job *Cmd) -> std::string {
+    std::string Description = Cmd->getSource().getClassName();
+    forEachConstituent(Cmd, [&](const Job *Constituent) {
+      for (const Action *A : Constituent->getSource().getInputs()) {
+        if (auto *Input = dyn_cast<InputAction>(A)) {
+          Description += ' ';
+          Description +=
+              llvm::sys::path::filename(Input->getInputArg().getValue());
+        }
+      }
+    });
+    return Description;
+  };
+
+  auto noteTaskBegan = [&] (const Job *Cmd) {
+    TaskTiming Timing;
+    Timing.Cmd = Cmd;
+    Timing.Description = describeTask(Cmd);
+    Timing.StartMicros = microsecondsSince(BuildStartTime);
+    Timing.WaitedOn = State.WaitedOn.lookup(Cmd);
+
+    auto FreeLane = std::find(State.Lanes.begin(), State.Lanes.end(),
+                              nullptr);
+    Timing.Lane = FreeLane - State.Lanes.begin();
+    if (FreeLane == State.Lanes.end())
+      State.Lanes.push_back(Cmd);
+    else
+      *FreeLane = Cmd;
+
+    State.TimingIndices[Cmd] = State.Timings.size();
+    State.Timings.push_back(std::move(Timing));
+  };
+
+  auto noteTaskFinished = [&] (const Job *Cmd,
+                               const TaskResourceUsage &Usage)
+      -> const TaskTiming & {
+    TaskTiming &Timing = State.Timings[State.TimingIndices.lookup(Cmd)];
+    Timing.EndMicros = microsecondsSince(BuildStartTime);
+    Timing.Finished = true;
+    Timing.Usage = Usage;
+    State.Lanes[Timing.Lane] = nullptr;
+    return Timing;
+  };
+
+  // Splits what a finished task cost between the source files it compiled,
+  // in proportion to what each was expected to cost, and remembers that for
+  // the next build.
+  auto recordHistory = [&] (const TaskTiming &Timing) {
+    SmallVector<std::pair<StringRef, uint64_t>, 4> Inputs;
+    uint64_t TotalWeight = 0;
+    forEachConstituent(Timing.Cmd, [&](const Job *Cmd) {
+      if (!isa<CompileJobAction>(Cmd->getSource()))
+        return;
+      for (const Action *A : Cmd->getSource().getInputs()) {
+        auto *Input = dyn_cast<InputAction>(A);
+        if (!Input)
+          continue;
+        StringRef Path = Input->getInputArg().getValue();
+        uint64_t Weight = std::max<uint64_t>(
+            estimateInputCost(Path, History, MicrosPerByte), 1);
+        Inputs.push_back({Path, Weight});
+        TotalWeight += Weight;
+      }
+    });
+
+    for (auto &Input : Inputs) {
+      double Share = double(Input.second) / TotalWeight;
+      JobHistoryEntry Entry;
+      Entry.WallTimeMicros = (Timing.EndMicros - Timing.StartMicros) * Share;
+      Entry.CPUTimeMicros = Timing.Usage.getCPUTimeMicros() * Share;
+      Entry.MaxRSSBytes = Timing.Usage.MaxRSSBytes;
+      History.record(Input.first, Entry);
+    }
   };
 
   // When a task finishes, we need to reevaluate the other commands that
@@ -425,15 +694,60 @@ int Compilation::performJobsImpl() {
   // Set up a callback which will be called immediately after a task has
   // started. This callback may be used to provide output indicating that the
   // task began.
-  auto taskBegan = [this] (ProcessId Pid, void *Context) {
+  auto taskBegan = [&] (ProcessId Pid, void *Context) {
     // TODO: properly handle task began.
     const Job *BeganCmd = (const Job *)Context;
+    noteTaskBegan(BeganCmd);
 
     // For verbose output, print out each command as it begins execution.
-    if (Level == OutputLevel::Verbose)
+    if (Level == OutputLevel::Verbose) {
       BeganCmd->printCommandLine(llvm::errs());
-    else if (Level == OutputLevel::Parseable)
-      parseable_output::emitBeganMessage(llvm::errs(), *BeganCmd, Pid);
+    } else if (Level == OutputLevel::Parseable) {
+      forEachConstituent(BeganCmd, [&](const Job *Cmd) {
+        parseable_output::emitBeganMessage(llvm::errs(), *Cmd, Pid);
+      });
+    }
+  };
+
+  // When a job finishes, we need to reevaluate the other commands that might
+  // have been blocked.
+  auto handleFinishedCommand = [&] (const Job *FinishedCmd) {
+    markFinished(FinishedCmd);
+
+    // In order to handle both old dependencies that have disappeared and new
+    // dependencies that have arisen, we need to reload the dependency file.
+    if (getIncrementalBuildEnabled()) {
+      const CommandOutput &Output = FinishedCmd->getOutput();
+      StringRef DependenciesFile =
+        Output.getAdditionalOutputForType(types::TY_SwiftDeps);
+      if (!DependenciesFile.empty()) {
+        SmallVector<const Job *, 16> Dependents;
+        bool wasCascading = DepGraph.isMarked(FinishedCmd);
+
+        switch (DepGraph.loadFromPath(FinishedCmd, DependenciesFile)) {
+        case DependencyGraphImpl::LoadResult::HadError:
+          disableIncrementalBuild();
+          for (const Job *Cmd : DeferredCommands)
+            scheduleCommandIfNecessaryAndPossible(Cmd);
+          DeferredCommands.clear();
+          Dependents.clear();
+          break;
+        case DependencyGraphImpl::LoadResult::UpToDate:
+          if (!wasCascading)
+            break;
+          SWIFT_FALLTHROUGH;
+        case DependencyGraphImpl::LoadResult::AffectsDownstream:
+          DepGraph.markTransitive(Dependents, FinishedCmd);
+          break;
+        }
+
+        for (const Job *Cmd : Dependents) {
+          DeferredCommands.erase(Cmd);
+          noteBuilding(Cmd, "because of dependencies discovered later");
+          scheduleCommandIfNecessaryAndPossible(Cmd);
+        }
+      }
+    }
   };
 
   // Set up a callback which will be called immediately after a task has
@@ -442,13 +756,20 @@ int Compilation::performJobsImpl() {
   // it should also schedule any additional commands which we now know need
   // to run.
   auto taskFinished = [&] (ProcessId Pid, int ReturnCode, StringRef Output,
-                           void *Context) -> TaskFinishedResponse {
+                           void *Context, const TaskResourceUsage &Usage)
+      -> TaskFinishedResponse {
     const Job *FinishedCmd = (const Job *)Context;
+    const TaskTiming &Timing = noteTaskFinished(FinishedCmd, Usage);
 
     if (Level == OutputLevel::Parseable) {
-      // Parseable output was requested.
-      parseable_output::emitFinishedMessage(llvm::errs(), *FinishedCmd, Pid,
-                                            ReturnCode, Output);
+      // Parseable output was requested. A batch's output can't be split up
+      // between its jobs, so it is all reported with the first one.
+      StringRef RemainingOutput = Output;
+      forEachConstituent(FinishedCmd, [&](const Job *Cmd) {
+        parseable_output::emitFinishedMessage(llvm::errs(), *Cmd, Pid,
+                                              ReturnCode, RemainingOutput);
+        RemainingOutput = StringRef();
+      });
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -477,56 +798,29 @@ int Compilation::performJobsImpl() {
           TaskFinishedResponse::StopExecution;
     }
 
-    // When a task finishes, we need to reevaluate the other commands that
-    // might have been blocked.
-    markFinished(FinishedCmd);
-
-    // In order to handle both old dependencies that have disappeared and new
-    // dependencies that have arisen, we need to reload the dependency file.
-    if (getIncrementalBuildEnabled()) {
-      const CommandOutput &Output = FinishedCmd->getOutput();
-      StringRef DependenciesFile =
-        Output.getAdditionalOutputForType(types::TY_SwiftDeps);
-      if (!DependenciesFile.empty()) {
-        SmallVector<const Job *, 16> Dependents;
-        bool wasCascading = DepGraph.isMarked(FinishedCmd);
-
-        switch (DepGraph.loadFromPath(FinishedCmd, DependenciesFile)) {
-        case DependencyGraphImpl::LoadResult::HadError:
-          disableIncrementalBuild();
-          for (const Job *Cmd : DeferredCommands)
-            scheduleCommandIfNecessaryAndPossible(Cmd);
-          DeferredCommands.clear();
-          Dependents.clear();
-          break;
-        case DependencyGraphImpl::LoadResult::UpToDate:
-          if (!wasCascading)
-            break;
-          SWIFT_FALLTHROUGH;
-        case DependencyGraphImpl::LoadResult::AffectsDownstream:
-          DepGraph.markTransitive(Dependents, FinishedCmd);
-          break;
-        }
-
-        for (const Job *Cmd : Dependents) {
-          DeferredCommands.erase(Cmd);
-          noteBuilding(Cmd, "because of dependencies discovered later");
-          scheduleCommandIfNecessaryAndPossible(Cmd);
-        }
-      }
-    }
+    recordHistory(Timing);
 
+    State.FinishingTask = FinishedCmd;
+    forEachConstituent(FinishedCmd, handleFinishedCommand);
+    addPendingBatchableCommands();
+    State.FinishingTask = nullptr;
     return TaskFinishedResponse::ContinueExecution;
   };
 
   auto taskSignalled = [&] (ProcessId Pid, StringRef ErrorMsg, StringRef Output,
-                            void *Context) -> TaskFinishedResponse {
+                            void *Context, const TaskResourceUsage &Usage)
+      -> TaskFinishedResponse {
     const Job *SignalledCmd = (const Job *)Context;
+    noteTaskFinished(SignalledCmd, Usage);
 
     if (Level == OutputLevel::Parseable) {
       // Parseable output was requested.
-      parseable_output::emitSignalledMessage(llvm::errs(), *SignalledCmd, Pid,
-                                             ErrorMsg, Output);
+      StringRef RemainingOutput = Output;
+      forEachConstituent(SignalledCmd, [&](const Job *Cmd) {
+        parseable_output::emitSignalledMessage(llvm::errs(), *Cmd, Pid,
+                                               ErrorMsg, RemainingOutput);
+        RemainingOutput = StringRef();
+      });
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -548,6 +842,8 @@ int Compilation::performJobsImpl() {
   };
 
   do {
+    addPendingBatchableCommands();
+
     // Ask the TaskQueue to execute.
     TQ->execute(taskBegan, taskFinished, taskSignalled);
 
@@ -564,7 +860,8 @@ int Compilation::performJobsImpl() {
     }
 
     // ...which may allow us to go on and do later tasks.
-  } while (Result == 0 && TQ->hasRemainingTasks());
+  } while (Result == 0 && (TQ->hasRemainingTasks() ||
+                            !State.PendingBatchableCommands.empty()));
 
   if (Result == 0) {
     assert(State.BlockingCommands.empty() &&
@@ -591,12 +888,17 @@ int Compilation::performJobsImpl() {
     }
   }
 
+  if (!TracePath.empty())
+    writeTraceFile(Diags, TracePath, State.Timings);
+  if (ShowCriticalPath)
+    printCriticalPath(llvm::outs(), State.Timings);
+
   if (!CompilationRecordPath.empty() && !SkipTaskExecution) {
     InputInfoMap InputInfo;
     populateInputInfoMap(InputInfo, State);
     checkForOutOfDateInputs(Diags, InputInfo);
     writeCompilationRecord(CompilationRecordPath, ArgsHash, BuildStartTime,
-                           InputInfo);
+                           InputInfo, History);
   }
 
   if (Result == 0)
@@ -666,6 +968,7 @@ int Compilation::performJobs() {
   if (Level < OutputLevel::Parseable &&
       (SaveTemps || TempFilePaths.empty()) &&
       CompilationRecordPath.empty() &&
+      TracePath.empty() && !ShowCriticalPath &&
       Jobs.size() == 1) {
     return performSingleCommand(Jobs.front().get());
   }
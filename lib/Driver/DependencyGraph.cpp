@@ -12,6 +12,8 @@
 
 #include "swift/Driver/DependencyGraph.h"
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Basic/ReferenceDependencies.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringSwitch.h"
@@ -47,16 +49,111 @@ DependencyGraphImpl::MarkTracerImpl::~MarkTracerImpl() = default;
 using LoadResult = DependencyGraphImpl::LoadResult;
 using DependencyKind = DependencyGraphImpl::DependencyKind;
 using DependencyCallbackTy = LoadResult(StringRef, DependencyKind, bool);
+using FingerprintCallbackTy = LoadResult(StringRef, DependencyKind, StringRef);
 using InterfaceHashCallbackTy = LoadResult(StringRef);
 
 static LoadResult
-parseDependencyFile(llvm::MemoryBuffer &buffer,
-                    llvm::function_ref<DependencyCallbackTy> providesCallback,
-                    llvm::function_ref<DependencyCallbackTy> dependsCallback,
-                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+parseBinaryDependencyFile(
+    llvm::MemoryBuffer &buffer,
+    llvm::function_ref<DependencyCallbackTy> providesCallback,
+    llvm::function_ref<DependencyCallbackTy> dependsCallback,
+    llvm::function_ref<FingerprintCallbackTy> fingerprintCallback,
+    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+  using reference_dependencies::Section;
+
+  LoadResult result = LoadResult::UpToDate;
+  bool hadError = reference_dependencies::readBinary(buffer.getBuffer(),
+      [&](Section section, StringRef name, bool isCascading) -> bool {
+    LoadResult update = LoadResult::HadError;
+    auto withFingerprint = [&](DependencyKind kind) -> LoadResult {
+      auto nameAndFingerprint = name.rsplit('\0');
+      if (nameAndFingerprint.second.empty())
+        return LoadResult::HadError;
+      return fingerprintCallback(nameAndFingerprint.first, kind,
+                                 nameAndFingerprint.second);
+    };
+    switch (section) {
+    case Section::ProvidesTopLevel:
+      update = providesCallback(name, DependencyKind::TopLevelName, true);
+      break;
+    case Section::ProvidesNominal:
+      update = providesCallback(name, DependencyKind::NominalType, true);
+      break;
+    case Section::ProvidesMember:
+      update = providesCallback(name, DependencyKind::NominalTypeMember, true);
+      break;
+    case Section::ProvidesDynamicLookup:
+      update = providesCallback(name, DependencyKind::DynamicLookupName, true);
+      break;
+    case Section::DependsTopLevel:
+      update = dependsCallback(name, DependencyKind::TopLevelName,
+                               isCascading);
+      break;
+    case Section::DependsMember:
+      update = dependsCallback(name, DependencyKind::NominalTypeMember,
+                               isCascading);
+      break;
+    case Section::DependsNominal:
+      update = dependsCallback(name, DependencyKind::NominalType,
+                               isCascading);
+      break;
+    case Section::DependsDynamicLookup:
+      update = dependsCallback(name, DependencyKind::DynamicLookupName,
+                               isCascading);
+      break;
+    case Section::DependsExternal:
+      update = dependsCallback(name, DependencyKind::ExternalFile,
+                               isCascading);
+      break;
+    case Section::InterfaceHash:
+      update = interfaceHashCallback(name);
+      break;
+    case Section::TopLevelFingerprints:
+      update = withFingerprint(DependencyKind::TopLevelName);
+      break;
+    case Section::NominalFingerprints:
+      update = withFingerprint(DependencyKind::NominalType);
+      break;
+    case Section::MemberFingerprints:
+      update = withFingerprint(DependencyKind::NominalTypeMember);
+      break;
+    case Section::DynamicLookupFingerprints:
+      update = withFingerprint(DependencyKind::DynamicLookupName);
+      break;
+    }
+
+    switch (update) {
+    case LoadResult::HadError:
+      return true;
+    case LoadResult::UpToDate:
+      break;
+    case LoadResult::AffectsDownstream:
+      result = LoadResult::AffectsDownstream;
+      break;
+    }
+    return false;
+  });
+
+  if (hadError)
+    return LoadResult::HadError;
+  return result;
+}
+
+static LoadResult
+parseDependencyFile(
+    llvm::MemoryBuffer &buffer,
+    llvm::function_ref<DependencyCallbackTy> providesCallback,
+    llvm::function_ref<DependencyCallbackTy> dependsCallback,
+    llvm::function_ref<FingerprintCallbackTy> fingerprintCallback,
+    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
   namespace yaml = llvm::yaml;
 
-  // FIXME: Switch to a format other than YAML.
+  if (reference_dependencies::isBinary(buffer.getBuffer())) {
+    return parseBinaryDependencyFile(buffer, providesCallback, dependsCallback,
+                                     fingerprintCallback,
+                                     interfaceHashCallback);
+  }
+
   llvm::SourceMgr SM;
   yaml::Stream stream(buffer.getMemBufferRef(), SM);
   auto I = stream.begin();
@@ -106,9 +203,10 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
       UPDATE_RESULT(interfaceHashCallback(valueString));
 
     } else {
-      enum class DependencyDirection : bool {
+      enum class DependencyDirection : uint8_t {
         Depends,
-        Provides
+        Provides,
+        Fingerprint
       };
       using KindPair = std::pair<DependencyKind, DependencyDirection>;
 
@@ -140,6 +238,18 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
         .Case("provides-dynamic-lookup",
               std::make_pair(DependencyKind::DynamicLookupName,
                              DependencyDirection::Provides))
+        .Case("top-level-fingerprints",
+              std::make_pair(DependencyKind::TopLevelName,
+                             DependencyDirection::Fingerprint))
+        .Case("nominal-fingerprints",
+              std::make_pair(DependencyKind::NominalType,
+                             DependencyDirection::Fingerprint))
+        .Case("member-fingerprints",
+              std::make_pair(DependencyKind::NominalTypeMember,
+                             DependencyDirection::Fingerprint))
+        .Case("dynamic-lookup-fingerprints",
+              std::make_pair(DependencyKind::DynamicLookupName,
+                             DependencyDirection::Fingerprint))
         .Default(std::make_pair(DependencyKind(),
                                 DependencyDirection::Depends));
       if (dirAndKind.first == DependencyKind())
@@ -149,7 +259,35 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
       if (!entries)
         return LoadResult::HadError;
 
-      if (dirAndKind.first == DependencyKind::NominalTypeMember) {
+      if (dirAndKind.second == DependencyDirection::Fingerprint) {
+        // Fingerprints come in the form ["name", "fingerprint"], or
+        // ["{MangledBaseName}", "memberName", "fingerprint"] for members.
+        bool isMember = dirAndKind.first == DependencyKind::NominalTypeMember;
+        for (yaml::Node &rawEntry : *entries) {
+          auto *entry = dyn_cast<yaml::SequenceNode>(&rawEntry);
+          if (!entry)
+            return LoadResult::HadError;
+
+          SmallVector<std::string, 3> parts;
+          for (yaml::Node &rawPart : *entry) {
+            auto *part = dyn_cast<yaml::ScalarNode>(&rawPart);
+            if (!part)
+              return LoadResult::HadError;
+            parts.push_back(part->getValue(scratch));
+          }
+          if (parts.size() != (isMember ? 3U : 2U))
+            return LoadResult::HadError;
+
+          SmallString<64> name{parts.front()};
+          if (isMember) {
+            name.push_back('\0');
+            name += parts[1];
+          }
+
+          UPDATE_RESULT(fingerprintCallback(name.str(), dirAndKind.first,
+                                            parts.back()));
+        }
+      } else if (dirAndKind.first == DependencyKind::NominalTypeMember) {
         // Handle member dependencies specially. Rather than being a single
         // string, they come in the form ["{MangledBaseName}", "memberName"].
         for (yaml::Node &rawEntry : *entries) {
@@ -207,7 +345,10 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
 }
 
 LoadResult DependencyGraphImpl::loadFromPath(const void *node, StringRef path) {
-  auto buffer = llvm::MemoryBuffer::getFile(path);
+  // Neither format needs a null terminator, which lets larger files be
+  // mapped rather than read.
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
   if (!buffer)
     return LoadResult::HadError;
   return loadFromBuffer(node, *buffer.get());
@@ -250,24 +391,42 @@ LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
     return LoadResult::UpToDate;
   };
 
-  auto providesCallback =
-      [this, node, &provides](StringRef name, DependencyKind kind,
+  // The "provides" entries are collected from scratch and only compared with
+  // the previous ones once the whole file has been read. Names are interned,
+  // so entries can be matched up by address.
+  std::vector<ProvidesEntryTy> loaded;
+  llvm::SmallDenseMap<const char *, size_t, 32> loadedIndices;
+  bool hasFingerprints = false;
+  bool interfaceChanged = false;
+
+  auto findOrAddLoaded = [&](StringRef name,
+                             DependencyKind kind) -> ProvidesEntryTy & {
+    StringRef interned = ProvidedNames.insert(name).first->getKey();
+    auto insertResult = loadedIndices.insert({interned.data(), loaded.size()});
+    if (insertResult.second)
+      loaded.push_back({interned, kind});
+    else
+      loaded[insertResult.first->second].kindMask |= kind;
+    return loaded[insertResult.first->second];
+  };
+
+  auto providesCallback = [&](StringRef name, DependencyKind kind,
                               bool isCascading) -> LoadResult {
     assert(isCascading);
-    auto iter = std::find_if(provides.begin(), provides.end(),
-                             [name](const ProvidesEntryTy &entry) -> bool {
-      return name == entry.name;
-    });
-
-    if (iter == provides.end())
-      provides.push_back({name, kind});
-    else
-      iter->kindMask |= kind;
+    findOrAddLoaded(name, kind);
+    return LoadResult::UpToDate;
+  };
 
+  auto fingerprintCallback = [&](StringRef name, DependencyKind kind,
+                                 StringRef fingerprint) -> LoadResult {
+    ProvidesEntryTy &entry = findOrAddLoaded(name, kind);
+    entry.fingerprint = llvm::hash_combine(entry.fingerprint, fingerprint);
+    entry.hasFingerprint = true;
+    hasFingerprints = true;
     return LoadResult::UpToDate;
   };
 
-  auto interfaceHashCallback = [this, node](StringRef hash) -> LoadResult {
+  auto interfaceHashCallback = [&](StringRef hash) -> LoadResult {
     auto insertResult = InterfaceHashes.insert(std::make_pair(node, hash));
 
     if (insertResult.second) {
@@ -279,14 +438,66 @@ LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
     auto iter = insertResult.first;
     if (hash != iter->second) {
       iter->second = hash;
+      interfaceChanged = true;
       return LoadResult::AffectsDownstream;
     }
 
     return LoadResult::UpToDate;
   };
 
-  return parseDependencyFile(buffer, providesCallback, dependsCallback,
-                             interfaceHashCallback);
+  bool isReload = Provides.count(node);
+  LoadResult result = parseDependencyFile(buffer, providesCallback,
+                                          dependsCallback, fingerprintCallback,
+                                          interfaceHashCallback);
+  if (result == LoadResult::HadError)
+    return result;
+
+  // Work out which entries changed since the last time this node was loaded.
+  // An entry with a fingerprint changed if the fingerprint did; one without
+  // changed if anything in the file's interface did.
+  auto &provides = Provides[node];
+  SmallVector<bool, 32> stillProvided(provides.size(), false);
+  llvm::SmallDenseMap<const char *, size_t, 32> previousIndices;
+  for (size_t i = 0, e = provides.size(); i != e; ++i)
+    previousIndices[provides[i].name.data()] = i;
+
+  for (ProvidesEntryTy &entry : loaded) {
+    if (!isReload)
+      continue;
+    auto previous = previousIndices.find(entry.name.data());
+    if (previous == previousIndices.end()) {
+      entry.changed = true;
+      continue;
+    }
+
+    const ProvidesEntryTy &old = provides[previous->second];
+    stillProvided[previous->second] = true;
+    if (old.isStale || old.kindMask.toRaw() != entry.kindMask.toRaw())
+      entry.changed = true;
+    else if (entry.hasFingerprint && old.hasFingerprint)
+      entry.changed = entry.fingerprint != old.fingerprint;
+    else
+      entry.changed = interfaceChanged;
+  }
+
+  // Entries that are no longer provided are kept, so that anything that
+  // depended on them is still found, but they only count as changed once.
+  for (size_t i = 0, e = provides.size(); i != e; ++i) {
+    if (stillProvided[i])
+      continue;
+    ProvidesEntryTy &old = provides[i];
+    old.changed = !old.isStale;
+    old.isStale = true;
+    loaded.push_back(old);
+  }
+
+  provides = std::move(loaded);
+  if (hasFingerprints)
+    FineGrainedNodes.insert(node);
+  else
+    FineGrainedNodes.erase(node);
+
+  return result;
 }
 
 void DependencyGraphImpl::markExternal(SmallVectorImpl<const void *> &visited,
@@ -327,7 +538,15 @@ DependencyGraphImpl::markTransitive(SmallVectorImpl<const void *> &visited,
     if (allProvided == Provides.end())
       return;
 
+    // A node with fingerprints only passes on what changed the last time it
+    // was reloaded. If it is marked without having been rebuilt, its
+    // dependents are found once it has been.
+    bool onlyChanged = FineGrainedNodes.count(next);
+
     for (const auto &provided : allProvided->second) {
+      if (onlyChanged && !provided.changed)
+        continue;
+
       auto allDependents = Dependencies.find(provided.name);
       if (allDependents == Dependencies.end())
         continue;
@@ -480,6 +480,15 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
     }
   }
 
+  unsigned MinAvailableMemoryMB = 0;
+  if (const Arg *A = ArgList->getLastArg(options::OPT_min_available_memory)) {
+    if (StringRef(A->getValue()).getAsInteger(10, MinAvailableMemoryMB)) {
+      Diags.diagnose(SourceLoc(), diag::error_invalid_arg_value,
+                     A->getAsString(*ArgList), A->getValue());
+      return nullptr;
+    }
+  }
+
   OutputLevel Level = OutputLevel::Normal;
   if (const Arg *A = ArgList->getLastArg(options::OPT_v,
                                          options::OPT_parseable_output)) {
@@ -513,6 +522,18 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
   if (ShowIncrementalBuildDecisions)
     C->setShowsIncrementalBuildDecisions();
 
+  if (const Arg *A = C->getArgs().getLastArg(options::OPT_driver_time_trace))
+    C->setTracePath(A->getValue());
+  if (C->getArgs().hasArg(options::OPT_driver_show_critical_path))
+    C->setShowCriticalPath();
+
+  if (MinAvailableMemoryMB)
+    C->setMinAvailableMemory(uint64_t(MinAvailableMemoryMB) << 20);
+
+  if (C->getArgs().hasArg(options::OPT_enable_batch_mode) &&
+      OI.CompilerMode == OutputInfo::Mode::StandardCompile)
+    C->enableBatchMode(*TC, OI);
+
   // This has to happen after building jobs, because otherwise we won't even
   // emit .swiftdeps files for the next build.
   if (rebuildEverything)
@@ -520,7 +541,14 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
 
   if (OFM) {
     if (auto *masterOutputMap = OFM->getOutputMapForSingleOutput()) {
-      C->setCompilationRecordPath(masterOutputMap->lookup(types::TY_SwiftDeps));
+      std::string buildRecordPath =
+          masterOutputMap->lookup(types::TY_SwiftDeps);
+      C->setCompilationRecordPath(buildRecordPath);
+
+      // The history only guides scheduling, so a malformed one is ignored.
+      BuildHistory history;
+      if (!buildRecordPath.empty() && !history.read(buildRecordPath))
+        C->setBuildHistory(std::move(history));
 
       auto buildEntry = outOfDateMap.find(nullptr);
       if (buildEntry != outOfDateMap.end())
@@ -1067,7 +1095,9 @@ void Driver::buildOutputInfo(const ToolChain &TC, const DerivedArgList &Args,
                         [&OI](sys::ProcessId PID,
                               int returnCode,
                               StringRef output,
-                              void *unused) -> sys::TaskFinishedResponse {
+                              void *unused,
+                              const sys::TaskResourceUsage &usage)
+                          -> sys::TaskFinishedResponse {
             if (returnCode == 0) {
               output = output.rtrim();
               auto lastLineStart = output.find_last_of("\n\r");
@@ -27,6 +27,8 @@
 #include "llvm/Support/Program.h"
 #include "llvm/ADT/STLExtras.h"
 
+#include <algorithm>
+
 using namespace swift;
 using namespace swift::driver;
 using namespace llvm::opt;
@@ -37,9 +39,10 @@ ToolChain::JobContext::JobContext(Compilation &C,
                                   ArrayRef<const Job *> Inputs,
                                   ArrayRef<const Action *> InputActions,
                                   const CommandOutput &Output,
-                                  const OutputInfo &OI)
+                                  const OutputInfo &OI,
+                                  ArrayRef<const CommandOutput *> BatchOutputs)
   : C(C), Inputs(Inputs), InputActions(InputActions), Output(Output),
-    OI(OI), Args(C.getArgs()) {}
+    OI(OI), BatchOutputs(BatchOutputs), Args(C.getArgs()) {}
 
 ArrayRef<InputPair> ToolChain::JobContext::getTopLevelInputFiles() const {
   return C.getInputFiles();
@@ -93,29 +96,106 @@ ToolChain::constructJob(const JobAction &JA,
     }
   }();
 
+  return llvm::make_unique<Job>(JA, std::move(inputs), std::move(output),
+                                findExecutable(invocationInfo.ExecutableName,
+                                               C),
+                                std::move(invocationInfo.Arguments),
+                                std::move(invocationInfo.ExtraEnvironment),
+                                std::move(invocationInfo.FilelistInfo));
+}
+
+const char *ToolChain::findExecutable(const char *executableName,
+                                      Compilation &C) const {
   // Special-case the Swift frontend.
-  const char *executablePath = nullptr;
-  if (StringRef(SWIFT_EXECUTABLE_NAME) == invocationInfo.ExecutableName) {
-    executablePath = getDriver().getSwiftProgramPath().c_str();
-  } else {
-    std::string relativePath =
-        findProgramRelativeToSwift(invocationInfo.ExecutableName);
-    if (!relativePath.empty()) {
-      executablePath = C.getArgs().MakeArgString(relativePath);
-    } else {
-      auto systemPath =
-          llvm::sys::findProgramByName(invocationInfo.ExecutableName);
-      if (systemPath) {
-        executablePath = C.getArgs().MakeArgString(systemPath.get());
-      } else {
-        // For debugging purposes.
-        executablePath = invocationInfo.ExecutableName;
-      }
-    }
+  if (StringRef(SWIFT_EXECUTABLE_NAME) == executableName)
+    return getDriver().getSwiftProgramPath().c_str();
+
+  std::string relativePath = findProgramRelativeToSwift(executableName);
+  if (!relativePath.empty())
+    return C.getArgs().MakeArgString(relativePath);
+
+  auto systemPath = llvm::sys::findProgramByName(executableName);
+  if (systemPath)
+    return C.getArgs().MakeArgString(systemPath.get());
+
+  // For debugging purposes.
+  return executableName;
+}
+
+bool ToolChain::jobIsBatchable(const Job *Cmd) const {
+  auto *CompileJob = dyn_cast<CompileJobAction>(&Cmd->getSource());
+  if (!CompileJob || CompileJob->size() != 1)
+    return false;
+
+  auto *Input = dyn_cast<InputAction>(*CompileJob->begin());
+  if (!Input || Input->getType() != types::TY_Swift)
+    return false;
+
+  // Only modes where each primary input produces exactly one main output can
+  // be batched; module-only and SIB compiles treat their output specially.
+  const CommandOutput &Output = Cmd->getOutput();
+  switch (Output.getPrimaryOutputType()) {
+  case types::TY_Object:
+  case types::TY_RawSIL:
+  case types::TY_SIL:
+  case types::TY_LLVM_IR:
+  case types::TY_LLVM_BC:
+  case types::TY_Assembly:
+    break;
+  default:
+    return false;
   }
+  if (Output.getPrimaryOutputFilenames().size() != 1)
+    return false;
 
-  return llvm::make_unique<Job>(JA, std::move(inputs), std::move(output),
-                                executablePath,
+  // The frontend writes fix-its for all of its inputs to a single file.
+  if (!Output.getAdditionalOutputForType(types::TY_Remapping).empty())
+    return false;
+
+  return Cmd->getExtraEnvironment().empty();
+}
+
+std::unique_ptr<Job>
+ToolChain::constructBatchJob(ArrayRef<const Job *> Jobs,
+                             Compilation &C,
+                             const OutputInfo &OI) const {
+  assert(Jobs.size() > 1 && "nothing to batch");
+
+  // The frontend pairs each primary input with its outputs by position, and
+  // sees the primary inputs in command-line order, so keep to that order.
+  auto getInputIndex = [](const Job *Cmd) -> unsigned {
+    auto *Input = cast<InputAction>(*Cmd->getSource().begin());
+    return Input->getInputArg().getIndex();
+  };
+  SmallVector<const Job *, 16> SortedJobs(Jobs.begin(), Jobs.end());
+  std::sort(SortedJobs.begin(), SortedJobs.end(),
+            [&](const Job *LHS, const Job *RHS) {
+    return getInputIndex(LHS) < getInputIndex(RHS);
+  });
+
+  types::ID OutputType = SortedJobs.front()->getOutput().getPrimaryOutputType();
+  auto BatchOutput = llvm::make_unique<CommandOutput>(OutputType);
+  ActionList InputActions;
+  SmallVector<const CommandOutput *, 16> Outputs;
+  for (const Job *Cmd : SortedJobs) {
+    assert(jobIsBatchable(Cmd) && "job cannot be batched");
+    const CommandOutput &Output = Cmd->getOutput();
+    assert(Output.getPrimaryOutputType() == OutputType &&
+           "batched jobs must produce the same kind of output");
+    InputActions.append(Cmd->getSource().begin(), Cmd->getSource().end());
+    Outputs.push_back(&Output);
+    BatchOutput->addPrimaryOutput(Output.getPrimaryOutputFilename(),
+                                  Output.getBaseInput(0));
+  }
+
+  const auto &JA = cast<CompileJobAction>(SortedJobs.front()->getSource());
+  JobContext context{C, {}, InputActions, *BatchOutput, OI, Outputs};
+  InvocationInfo invocationInfo = constructInvocation(JA, context);
+
+  return llvm::make_unique<Job>(JA, SmallVector<const Job *, 1>(),
+                                std::move(BatchOutput),
+                                findExecutable(invocationInfo.ExecutableName,
+                                               C),
                                 std::move(invocationInfo.Arguments),
                                 std::move(invocationInfo.ExtraEnvironment),
                                 std::move(invocationInfo.FilelistInfo));
@@ -25,6 +25,7 @@
 #include "swift/Config.h"
 #include "clang/Basic/Version.h"
 #include "clang/Driver/Util.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
@@ -115,6 +116,8 @@ static void addCommonFrontendArgs(const ToolChain &TC,
   inputArgs.AddLastArg(arguments, options::OPT_autolink_force_load);
   inputArgs.AddLastArg(arguments, options::OPT_color_diagnostics);
   inputArgs.AddLastArg(arguments, options::OPT_fixit_all);
+  inputArgs.AddLastArg(arguments,
+                       options::OPT_emit_yaml_reference_dependencies);
   inputArgs.AddLastArg(arguments, options::OPT_enable_app_extension);
   inputArgs.AddLastArg(arguments, options::OPT_enable_testing);
   inputArgs.AddLastArg(arguments, options::OPT_g_Group);
@@ -129,6 +132,7 @@ static void addCommonFrontendArgs(const ToolChain &TC,
   inputArgs.AddLastArg(arguments, options::OPT_suppress_warnings);
   inputArgs.AddLastArg(arguments, options::OPT_profile_generate);
   inputArgs.AddLastArg(arguments, options::OPT_profile_coverage_mapping);
+  inputArgs.AddLastArg(arguments, options::OPT_profile_use);
   inputArgs.AddLastArg(arguments, options::OPT_warnings_as_errors);
 
   // Pass on any build config options
@@ -244,30 +248,30 @@ ToolChain::constructInvocation(const CompileJobAction &job,
   switch (context.OI.CompilerMode) {
   case OutputInfo::Mode::StandardCompile:
   case OutputInfo::Mode::UpdateCode: {
-    assert(context.InputActions.size() == 1 &&
+    assert((context.InputActions.size() == 1 || context.isBatch()) &&
            "The Swift frontend expects exactly one input (the primary file)!");
 
-    auto *IA = cast<InputAction>(context.InputActions[0]);
-    const Arg &PrimaryInputArg = IA->getInputArg();
-
     if (context.Args.hasArg(options::OPT_driver_use_filelists) ||
         context.getTopLevelInputFiles().size() > TOO_MANY_FILES) {
       Arguments.push_back("-filelist");
       Arguments.push_back(context.getAllSourcesPath());
-      Arguments.push_back("-primary-file");
-      PrimaryInputArg.render(context.Args, Arguments);
+      for (const Action *A : context.InputActions) {
+        Arguments.push_back("-primary-file");
+        cast<InputAction>(A)->getInputArg().render(context.Args, Arguments);
+      }
     } else {
-      bool FoundPrimaryInput = false;
+      llvm::SmallDenseSet<unsigned, 4> PrimaryInputIndices;
+      for (const Action *A : context.InputActions)
+        PrimaryInputIndices.insert(
+          cast<InputAction>(A)->getInputArg().getIndex());
+
       for (auto inputPair : context.getTopLevelInputFiles()) {
         if (!types::isPartOfSwiftCompilation(inputPair.first))
           continue;
 
         // See if this input should be passed with -primary-file.
-        if (!FoundPrimaryInput &&
-            PrimaryInputArg.getIndex() == inputPair.second->getIndex()) {
+        if (PrimaryInputIndices.erase(inputPair.second->getIndex()))
           Arguments.push_back("-primary-file");
-          FoundPrimaryInput = true;
-        }
         Arguments.push_back(inputPair.second->getValue());
       }
     }
@@ -309,12 +313,29 @@ ToolChain::constructInvocation(const CompileJobAction &job,
   Arguments.push_back("-module-name");
   Arguments.push_back(context.Args.MakeArgString(context.OI.ModuleName));
 
-  const std::string &ModuleOutputPath =
-    context.Output.getAdditionalOutputForType(types::ID::TY_SwiftModuleFile);
-  if (!ModuleOutputPath.empty()) {
-    Arguments.push_back("-emit-module-path");
-    Arguments.push_back(ModuleOutputPath.c_str());
-  }
+  // A batch passes each supplementary output once per primary input, in the
+  // same order as the primary inputs.
+  SmallVector<const CommandOutput *, 1> Outputs;
+  if (context.isBatch())
+    Outputs.append(context.BatchOutputs.begin(), context.BatchOutputs.end());
+  else
+    Outputs.push_back(&context.Output);
+
+  auto addOutputsOfType = [&](const char *Flag, types::ID Type) {
+    for (const CommandOutput *Output : Outputs) {
+      const std::string &Path = Output->getAdditionalOutputForType(Type);
+      if (!Path.empty()) {
+        Arguments.push_back(Flag);
+        Arguments.push_back(Path.c_str());
+      }
+    }
+  };
+
+  addOutputsOfType("-emit-module-path", types::TY_SwiftModuleFile);
+
+  // For a single job, addCommonFrontendArgs() has already taken care of this.
+  if (context.isBatch())
+    addOutputsOfType("-emit-module-doc-path", types::TY_SwiftModuleDocFile);
 
   const std::string &ObjCHeaderOutputPath =
     context.Output.getAdditionalOutputForType(types::ID::TY_ObjCHeader);
@@ -327,26 +348,10 @@ ToolChain::constructInvocation(const CompileJobAction &job,
     Arguments.push_back(ObjCHeaderOutputPath.c_str());
   }
 
-  const std::string &SerializedDiagnosticsPath =
-    context.Output.getAdditionalOutputForType(types::TY_SerializedDiagnostics);
-  if (!SerializedDiagnosticsPath.empty()) {
-    Arguments.push_back("-serialize-diagnostics-path");
-    Arguments.push_back(SerializedDiagnosticsPath.c_str());
-  }
-
-  const std::string &DependenciesPath =
-    context.Output.getAdditionalOutputForType(types::TY_Dependencies);
-  if (!DependenciesPath.empty()) {
-    Arguments.push_back("-emit-dependencies-path");
-    Arguments.push_back(DependenciesPath.c_str());
-  }
-
-  const std::string &ReferenceDependenciesPath =
-    context.Output.getAdditionalOutputForType(types::TY_SwiftDeps);
-  if (!ReferenceDependenciesPath.empty()) {
-    Arguments.push_back("-emit-reference-dependencies-path");
-    Arguments.push_back(ReferenceDependenciesPath.c_str());
-  }
+  addOutputsOfType("-serialize-diagnostics-path",
+                   types::TY_SerializedDiagnostics);
+  addOutputsOfType("-emit-dependencies-path", types::TY_Dependencies);
+  addOutputsOfType("-emit-reference-dependencies-path", types::TY_SwiftDeps);
 
   const std::string &FixitsPath =
     context.Output.getAdditionalOutputForType(types::TY_Remapping);
@@ -771,7 +776,9 @@ static bool findXcodeClangPath(llvm::SmallVectorImpl<char> &path) {
                   [&path](sys::ProcessId PID,
                           int returnCode,
                           StringRef output,
-                          void *unused) -> sys::TaskFinishedResponse {
+                          void *unused,
+                          const sys::TaskResourceUsage &usage)
+                      -> sys::TaskFinishedResponse {
       if (returnCode == 0) {
         output = output.rtrim();
         path.append(output.begin(), output.end());
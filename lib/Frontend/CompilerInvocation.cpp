@@ -17,6 +17,7 @@
 #include "swift/Basic/Platform.h"
 #include "swift/Option/Options.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
@@ -111,32 +112,138 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
-static unsigned readFileList(std::vector<std::string> &inputFiles,
-                             const llvm::opt::Arg *filelistPath,
-                             const llvm::opt::Arg *primaryFileArg = nullptr) {
-  bool foundPrimaryFile = false;
-  unsigned primaryFileIndex = 0;
-  StringRef primaryFile;
-  if (primaryFileArg)
-    primaryFile = primaryFileArg->getValue();
+/// Reads the input files listed in \p filelistPath into \p inputFiles, and
+/// returns the position in \p inputFiles of each of \p primaryFiles.
+static std::vector<unsigned>
+readFileList(std::vector<std::string> &inputFiles,
+             const llvm::opt::Arg *filelistPath,
+             ArrayRef<std::string> primaryFiles = {}) {
+  enum : unsigned { NotFound = ~0U };
+  llvm::StringMap<unsigned> primaryFilePositions;
+  for (unsigned i = 0, e = primaryFiles.size(); i != e; ++i)
+    primaryFilePositions.insert({primaryFiles[i], i});
+  std::vector<unsigned> primaryFileIndices(primaryFiles.size(), NotFound);
 
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
       llvm::MemoryBuffer::getFile(filelistPath->getValue());
   assert(buffer && "can't read filelist; unrecoverable");
 
   for (StringRef line : make_range(llvm::line_iterator(*buffer.get()), {})) {
+    auto found = primaryFilePositions.find(line);
+    if (found != primaryFilePositions.end() &&
+        primaryFileIndices[found->second] == NotFound)
+      primaryFileIndices[found->second] = inputFiles.size();
     inputFiles.push_back(line);
-    if (foundPrimaryFile)
-      continue;
-    if (line == primaryFile)
-      foundPrimaryFile = true;
-    else
-      ++primaryFileIndex;
   }
 
-  if (primaryFileArg)
-    assert(foundPrimaryFile && "primary file not found in filelist");
-  return primaryFileIndex;
+  assert(std::find(primaryFileIndices.begin(), primaryFileIndices.end(),
+                   NotFound) == primaryFileIndices.end() &&
+         "primary file not found in filelist");
+  return primaryFileIndices;
+}
+
+/// Gives each primary input of a batch its own outputs, taken in order from
+/// the repeated output options, and selects the first entry.
+///
+/// \returns true on error
+static bool distributeBatchOutputs(FrontendOptions &Opts, ArgList &Args,
+                                   DiagnosticEngine &Diags) {
+  using namespace options;
+  using BatchEntry = FrontendOptions::BatchEntry;
+
+  switch (Opts.RequestedAction) {
+  case FrontendOptions::NoneAction:
+  case FrontendOptions::DumpParse:
+  case FrontendOptions::DumpInterfaceHash:
+  case FrontendOptions::DumpAST:
+  case FrontendOptions::PrintAST:
+  case FrontendOptions::DumpTypeRefinementContexts:
+  case FrontendOptions::Immediate:
+  case FrontendOptions::REPL:
+  case FrontendOptions::EmitModuleOnly:
+  case FrontendOptions::EmitSIBGen:
+  case FrontendOptions::EmitSIB:
+    Diags.diagnose(SourceLoc(), diag::error_batch_mode_unsupported, 0);
+    return true;
+  case FrontendOptions::Parse:
+  case FrontendOptions::EmitSILGen:
+  case FrontendOptions::EmitSIL:
+  case FrontendOptions::EmitIR:
+  case FrontendOptions::EmitBC:
+  case FrontendOptions::EmitAssembly:
+  case FrontendOptions::EmitObject:
+    break;
+  }
+
+  if (Opts.InputKind != InputFileKind::IFK_Swift &&
+      Opts.InputKind != InputFileKind::IFK_Swift_Library) {
+    Diags.diagnose(SourceLoc(), diag::error_batch_mode_unsupported, 1);
+    return true;
+  }
+
+  unsigned NumEntries = Opts.Batch.size();
+  if (Opts.RequestedAction != FrontendOptions::Parse) {
+    if (Opts.OutputFilenames.size() != NumEntries) {
+      Diags.diagnose(SourceLoc(), diag::error_batch_mode_output_count,
+                     StringRef("-o"), unsigned(Opts.OutputFilenames.size()),
+                     NumEntries);
+      return true;
+    }
+    for (unsigned i = 0; i != NumEntries; ++i)
+      Opts.Batch[i].OutputFilename = Opts.OutputFilenames[i];
+  }
+
+  auto distribute = [&](std::string BatchEntry::*Path,
+                        const std::string &SinglePath,
+                        OptSpecifier OptWithPath,
+                        StringRef Extension) -> bool {
+    if (SinglePath.empty())
+      return false;
+
+    std::vector<std::string> Paths = Args.getAllArgValues(OptWithPath);
+    if (Paths.empty()) {
+      // Only the flag was given, so derive a name for each entry the same way
+      // it would be derived for a single primary input.
+      for (BatchEntry &Entry : Opts.Batch) {
+        llvm::SmallString<128> Derived;
+        if (Entry.OutputFilename.empty())
+          Derived = llvm::sys::path::filename(
+            Opts.InputFilenames[Entry.Input.Index]);
+        else
+          Derived = Entry.OutputFilename;
+        llvm::sys::path::replace_extension(Derived, Extension);
+        Entry.*Path = Derived.str();
+      }
+      return false;
+    }
+
+    if (Paths.size() != NumEntries) {
+      Diags.diagnose(SourceLoc(), diag::error_batch_mode_output_count,
+                     Args.getLastArg(OptWithPath)->getSpelling(),
+                     unsigned(Paths.size()), NumEntries);
+      return true;
+    }
+    for (unsigned i = 0; i != NumEntries; ++i)
+      Opts.Batch[i].*Path = std::move(Paths[i]);
+    return false;
+  };
+
+  if (distribute(&BatchEntry::ModuleOutputPath, Opts.ModuleOutputPath,
+                 OPT_emit_module_path, SERIALIZED_MODULE_EXTENSION) ||
+      distribute(&BatchEntry::ModuleDocOutputPath, Opts.ModuleDocOutputPath,
+                 OPT_emit_module_doc_path, SERIALIZED_MODULE_DOC_EXTENSION) ||
+      distribute(&BatchEntry::SerializedDiagnosticsPath,
+                 Opts.SerializedDiagnosticsPath,
+                 OPT_serialize_diagnostics_path, "dia") ||
+      distribute(&BatchEntry::DependenciesFilePath, Opts.DependenciesFilePath,
+                 OPT_emit_dependencies_path, "d") ||
+      distribute(&BatchEntry::ReferenceDependenciesFilePath,
+                 Opts.ReferenceDependenciesFilePath,
+                 OPT_emit_reference_dependencies_path, "swiftdeps"))
+    return true;
+
+  Opts.selectBatchEntry(0);
+  return false;
 }
 
 static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
@@ -168,11 +275,28 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     Opts.GroupInfoPath = A->getValue();
   }
 
+  if (const Arg *A = Args.getLastArg(OPT_compile_server)) {
+    Opts.CompileServerPath = A->getValue();
+  }
+
+  if (const Arg *A = Args.getLastArg(OPT_compile_server_idle_timeout)) {
+    if (StringRef(A->getValue()).getAsInteger(10,
+                                              Opts.CompileServerIdleTimeout)) {
+      Diags.diagnose(SourceLoc(), diag::error_invalid_arg_value,
+                     A->getAsString(Args), A->getValue());
+      return true;
+    }
+  }
+
   Opts.EmitVerboseSIL |= Args.hasArg(OPT_emit_verbose_sil);
   Opts.EmitSortedSIL |= Args.hasArg(OPT_emit_sorted_sil);
 
   Opts.DelayedFunctionBodyParsing |= Args.hasArg(OPT_delayed_function_body_parsing);
+  Opts.SkipSecondaryFunctionBodies |=
+    Args.hasArg(OPT_skip_secondary_function_bodies);
   Opts.EnableTesting |= Args.hasArg(OPT_enable_testing);
+  Opts.EmitYAMLReferenceDependencies |=
+    Args.hasArg(OPT_emit_yaml_reference_dependencies);
   Opts.EnableResilience |= Args.hasArg(OPT_enable_resilience);
 
   Opts.PrintStats |= Args.hasArg(OPT_print_stats);
@@ -197,11 +321,10 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   }
 
   if (const Arg *A = Args.getLastArg(OPT_filelist)) {
-    const Arg *primaryFileArg = Args.getLastArg(OPT_primary_file);
-    auto primaryFileIndex = readFileList(Opts.InputFilenames, A,
-                                         primaryFileArg);
-    if (primaryFileArg)
-      Opts.PrimaryInput = SelectedInput(primaryFileIndex);
+    auto primaryFileIndices = readFileList(Opts.InputFilenames, A,
+                                       Args.getAllArgValues(OPT_primary_file));
+    for (unsigned primaryFileIndex : primaryFileIndices)
+      Opts.Batch.emplace_back(SelectedInput(primaryFileIndex));
     assert(!Args.hasArg(OPT_INPUT) && "mixing -filelist with inputs");
   } else {
     for (const Arg *A : make_range(Args.filtered_begin(OPT_INPUT,
@@ -210,7 +333,7 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
       if (A->getOption().matches(OPT_INPUT)) {
         Opts.InputFilenames.push_back(A->getValue());
       } else if (A->getOption().matches(OPT_primary_file)) {
-        Opts.PrimaryInput = SelectedInput(Opts.InputFilenames.size());
+        Opts.Batch.emplace_back(SelectedInput(Opts.InputFilenames.size()));
         Opts.InputFilenames.push_back(A->getValue());
       } else {
         llvm_unreachable("Unknown input-related argument!");
@@ -218,6 +341,13 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     }
   }
 
+  // Until the batch entries are selected one at a time, the first primary
+  // input stands in for all of them.
+  if (!Opts.Batch.empty())
+    Opts.PrimaryInput = Opts.Batch.front().Input;
+  if (!Opts.isBatchMode())
+    Opts.Batch.clear();
+
   Opts.ParseStdlib |= Args.hasArg(OPT_parse_stdlib);
 
   // Determine what the user has asked the frontend to do.
@@ -608,6 +738,9 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
                           SERIALIZED_MODULE_DOC_EXTENSION,
                           false);
 
+  if (Opts.isBatchMode() && distributeBatchOutputs(Opts, Args, Diags))
+    return true;
+
   if (!Opts.DependenciesFilePath.empty()) {
     switch (Opts.RequestedAction) {
     case FrontendOptions::NoneAction:
@@ -733,6 +866,15 @@ static bool ParseLangArgs(LangOptions &Opts, ArgList &Args,
   Opts.EnableExperimentalPropertyBehaviors |=
     Args.hasArg(OPT_enable_experimental_property_behaviors);
 
+  if (Args.hasArg(OPT_disable_named_lazy_member_loading))
+    Opts.NamedLazyMemberLoading = false;
+
+  if (Args.hasArg(OPT_disable_constraint_solver_memoization))
+    Opts.ConstraintSolverMemoization = false;
+
+  if (Args.hasArg(OPT_disable_operator_overload_pruning))
+    Opts.OperatorOverloadPruning = false;
+
   Opts.DisableAvailabilityChecking |=
       Args.hasArg(OPT_disable_availability_checking);
   
@@ -1067,8 +1209,12 @@ static bool ParseSILArgs(SILOptions &Opts, ArgList &Args,
 
   Opts.GenerateProfile |= Args.hasArg(OPT_profile_generate);
   Opts.EmitProfileCoverageMapping |= Args.hasArg(OPT_profile_coverage_mapping);
+  if (const Arg *A = Args.getLastArg(OPT_profile_use))
+    Opts.UseProfile = A->getValue();
   Opts.EnableGuaranteedClosureContexts |=
     Args.hasArg(OPT_enable_guaranteed_closure_contexts);
+  Opts.EnableImportedSpecializations |=
+    Args.hasArg(OPT_enable_imported_specializations);
 
   return false;
 }
@@ -33,6 +33,8 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 
+#include <algorithm>
+
 using namespace swift;
 
 void CompilerInstance::createSILModule(bool WholeModule) {
@@ -52,6 +54,47 @@ void CompilerInstance::setPrimarySourceFile(SourceFile *SF) {
   PrimarySourceFile->setReferencedNameTracker(NameTracker);
 }
 
+bool CompilerInstance::isPrimaryBuffer(unsigned BufferID) const {
+  if (BufferID == PrimaryBufferID)
+    return true;
+  return std::find(BatchPrimaryBufferIDs.begin(), BatchPrimaryBufferIDs.end(),
+                   BufferID) != BatchPrimaryBufferIDs.end();
+}
+
+bool CompilerInstance::isPrimarySourceFile(const SourceFile *SF) const {
+  if (SF == PrimarySourceFile)
+    return true;
+  return std::find(BatchPrimarySourceFiles.begin(),
+                   BatchPrimarySourceFiles.end(),
+                   SF) != BatchPrimarySourceFiles.end();
+}
+
+/// Sets up \p SF if it was selected for output, either as the primary input
+/// or as one of a batch of them.
+void CompilerInstance::recordPrimarySourceFile(SourceFile *SF) {
+  unsigned BufferID = SF->getBufferID().getValue();
+  if (BufferID == PrimaryBufferID)
+    setPrimarySourceFile(SF);
+
+  auto Found = std::find(BatchPrimaryBufferIDs.begin(),
+                         BatchPrimaryBufferIDs.end(), BufferID);
+  if (Found == BatchPrimaryBufferIDs.end())
+    return;
+
+  auto Index = Found - BatchPrimaryBufferIDs.begin();
+  BatchPrimarySourceFiles[Index] = SF;
+  if (Index != 0 && NameTracker) {
+    BatchNameTrackers.emplace_back(new ReferencedNameTracker());
+    SF->setReferencedNameTracker(BatchNameTrackers.back().get());
+  }
+}
+
+void CompilerInstance::selectBatchPrimarySourceFile(unsigned Index) {
+  assert(BatchPrimarySourceFiles[Index] && "primary input was not parsed");
+  PrimarySourceFile = BatchPrimarySourceFiles[Index];
+  PrimaryBufferID = BatchPrimaryBufferIDs[Index];
+}
+
 bool CompilerInstance::setup(const CompilerInvocation &Invok) {
   Invocation = Invok;
 
@@ -66,20 +109,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
     llvm::cl::ParseCommandLineOptions(Args.size()-1, Args.data());
   }
 
-  if (Invocation.getDiagnosticOptions().ShowDiagnosticsAfterFatalError) {
-    Diagnostics.setShowDiagnosticsAfterFatalError();
-  }
-  if (Invocation.getDiagnosticOptions().SuppressWarnings) {
-    Diagnostics.setSuppressWarnings(true);
-  }
-  if (Invocation.getDiagnosticOptions().WarningsAsErrors) {
-    Diagnostics.setWarningsAsErrors(true);
-  }
-
-  // If we are asked to emit a module documentation file, configure lexing and
-  // parsing to remember comments.
-  if (!Invocation.getFrontendOptions().ModuleDocOutputPath.empty())
-    Invocation.getLangOptions().AttachCommentsToDecls = true;
+  applyInvocationOptions();
 
   Context.reset(new ASTContext(Invocation.getLangOptions(),
                                Invocation.getSearchPathOptions(),
@@ -111,6 +141,36 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
 
   Context->addModuleLoader(std::move(clangImporter), /*isClang*/true);
 
+  return setupInputs();
+}
+
+bool CompilerInstance::setupReusingASTContext(const CompilerInvocation &Invok) {
+  assert(Context && "no ASTContext to reuse");
+  assert(!MainModule && BufferIDs.empty() && PartialModules.empty() &&
+         "instance has already been used for a compilation");
+  Invocation = Invok;
+  applyInvocationOptions();
+  return setupInputs();
+}
+
+void CompilerInstance::applyInvocationOptions() {
+  if (Invocation.getDiagnosticOptions().ShowDiagnosticsAfterFatalError) {
+    Diagnostics.setShowDiagnosticsAfterFatalError();
+  }
+  if (Invocation.getDiagnosticOptions().SuppressWarnings) {
+    Diagnostics.setSuppressWarnings(true);
+  }
+  if (Invocation.getDiagnosticOptions().WarningsAsErrors) {
+    Diagnostics.setWarningsAsErrors(true);
+  }
+
+  // If we are asked to emit a module documentation file, configure lexing and
+  // parsing to remember comments.
+  if (!Invocation.getFrontendOptions().ModuleDocOutputPath.empty())
+    Invocation.getLangOptions().AttachCommentsToDecls = true;
+}
+
+bool CompilerInstance::setupInputs() {
   assert(Lexer::isIdentifier(Invocation.getModuleName()));
 
   Optional<unsigned> CodeCompletionBufferID;
@@ -132,6 +192,19 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
 
   const Optional<SelectedInput> &PrimaryInput =
     Invocation.getFrontendOptions().PrimaryInput;
+  const auto &Batch = Invocation.getFrontendOptions().Batch;
+  BatchPrimaryBufferIDs.assign(Batch.size(), NO_SUCH_BUFFER);
+  BatchPrimarySourceFiles.assign(Batch.size(), nullptr);
+
+  auto notePrimaryBuffer = [&](SelectedInput::InputKind Kind, unsigned Index,
+                               unsigned BufferID) {
+    if (PrimaryInput && PrimaryInput->Kind == Kind &&
+        PrimaryInput->Index == Index)
+      PrimaryBufferID = BufferID;
+    for (unsigned i = 0, e = Batch.size(); i != e; ++i)
+      if (Batch[i].Input.Kind == Kind && Batch[i].Input.Index == Index)
+        BatchPrimaryBufferIDs[i] = BufferID;
+  };
 
   // Add the memory buffers first, these will be associated with a filename
   // and they can replace the contents of an input filename.
@@ -150,8 +223,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
       if (SILMode)
         MainBufferID = BufferID;
 
-      if (PrimaryInput && PrimaryInput->isBuffer() && PrimaryInput->Index == i)
-        PrimaryBufferID = BufferID;
+      notePrimaryBuffer(SelectedInput::InputKind::Buffer, i, BufferID);
     }
   }
 
@@ -166,9 +238,8 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
       if (SILMode || (MainMode && filename(File) == "main.swift"))
         MainBufferID = ExistingBufferID.getValue();
 
-      if (PrimaryInput && PrimaryInput->isFilename() &&
-          PrimaryInput->Index == i)
-        PrimaryBufferID = ExistingBufferID.getValue();
+      notePrimaryBuffer(SelectedInput::InputKind::Filename, i,
+                        ExistingBufferID.getValue());
 
       continue; // replaced by a memory buffer.
     }
@@ -187,7 +258,9 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
       llvm::sys::path::replace_extension(ModuleDocFilePath,
                                          SERIALIZED_MODULE_DOC_EXTENSION);
       FileOrError ModuleDocOrErr =
-        llvm::MemoryBuffer::getFileOrSTDIN(ModuleDocFilePath.str());
+        llvm::MemoryBuffer::getFileOrSTDIN(ModuleDocFilePath.str(),
+                                           /*FileSize=*/-1,
+                                           /*RequiresNullTerminator=*/false);
       if (!ModuleDocOrErr &&
           ModuleDocOrErr.getError() != std::errc::no_such_file_or_directory) {
         Diagnostics.diagnose(SourceLoc(), diag::error_open_input_file,
@@ -209,8 +282,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
     if (SILMode || (MainMode && filename(File) == "main.swift"))
       MainBufferID = BufferID;
 
-    if (PrimaryInput && PrimaryInput->isFilename() && PrimaryInput->Index == i)
-      PrimaryBufferID = BufferID;
+    notePrimaryBuffer(SelectedInput::InputKind::Filename, i, BufferID);
   }
 
   // Set the primary file to the code-completion point if one exists.
@@ -380,6 +452,21 @@ void CompilerInstance::performSema() {
     DelayedCB.reset(new AlwaysDelayedCallbacks);
   }
 
+  // Files that are not primary inputs are only needed for their declarations.
+  // Their function bodies are never type-checked or emitted, so don't build
+  // any AST for them.
+  std::unique_ptr<DelayedParsingCallbacks> SecondaryCB;
+  if (Invocation.getFrontendOptions().SkipSecondaryFunctionBodies &&
+      Kind != InputFileKind::IFK_SIL && PrimaryBufferID != NO_SUCH_BUFFER &&
+      !DelayedCB) {
+    SecondaryCB.reset(new AlwaysSkippedCallbacks);
+  }
+  auto getDelayedCallbacks = [&](unsigned BufferID) {
+    if (SecondaryCB && !isPrimaryBuffer(BufferID))
+      return SecondaryCB.get();
+    return DelayedCB.get();
+  };
+
   PersistentParserState PersistentState;
 
   // Make sure the main file is the first file in the module. This may only be
@@ -398,8 +485,8 @@ void CompilerInstance::performSema() {
     MainModule->addFile(*MainFile);
     addAdditionalInitialImports(MainFile);
 
-    if (MainBufferID == PrimaryBufferID)
-      setPrimarySourceFile(MainFile);
+    if (isPrimaryBuffer(MainBufferID))
+      recordPrimarySourceFile(MainFile);
   }
 
   bool hadLoadError = false;
@@ -424,15 +511,15 @@ void CompilerInstance::performSema() {
     MainModule->addFile(*NextInput);
     addAdditionalInitialImports(NextInput);
 
-    if (BufferID == PrimaryBufferID)
-      setPrimarySourceFile(NextInput);
+    if (isPrimaryBuffer(BufferID))
+      recordPrimarySourceFile(NextInput);
 
     bool Done;
     do {
       // Parser may stop at some erroneous constructions like #else, #endif
       // or '}' in some cases, continue parsing until we are done
       parseIntoSourceFile(*NextInput, BufferID, &Done, nullptr,
-                          &PersistentState, DelayedCB.get());
+                          &PersistentState, getDelayedCallbacks(BufferID));
     } while (!Done);
 
     performNameBinding(*NextInput);
@@ -464,7 +551,7 @@ void CompilerInstance::performSema() {
   // Parse the main file last.
   if (MainBufferID != NO_SUCH_BUFFER) {
     bool mainIsPrimary =
-      (PrimaryBufferID == NO_SUCH_BUFFER || MainBufferID == PrimaryBufferID);
+      (PrimaryBufferID == NO_SUCH_BUFFER || isPrimaryBuffer(MainBufferID));
 
     SourceFile &MainFile =
       MainModule->getMainSourceFile(Invocation.getSourceFileKind());
@@ -478,7 +565,8 @@ void CompilerInstance::performSema() {
       // with 'sil' definitions.
       parseIntoSourceFile(MainFile, MainFile.getBufferID().getValue(), &Done,
                           TheSILModule ? &SILContext : nullptr,
-                          &PersistentState, DelayedCB.get());
+                          &PersistentState,
+                          getDelayedCallbacks(MainBufferID));
       if (mainIsPrimary) {
         performTypeChecking(MainFile, PersistentState.getTopLevelContext(),
                             TypeCheckOptions, CurTUElem);
@@ -496,7 +584,7 @@ void CompilerInstance::performSema() {
   // Type-check each top-level input besides the main source file.
   for (auto File : MainModule->getFiles())
     if (auto SF = dyn_cast<SourceFile>(File))
-      if (PrimaryBufferID == NO_SUCH_BUFFER || SF == PrimarySourceFile)
+      if (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(SF))
         performTypeChecking(*SF, PersistentState.getTopLevelContext(),
                             TypeCheckOptions);
 
@@ -71,6 +71,20 @@ bool FrontendOptions::actionIsImmediate() const {
   llvm_unreachable("Unknown ActionType");
 }
 
+void FrontendOptions::selectBatchEntry(unsigned Index) {
+  const BatchEntry &Entry = Batch[Index];
+  PrimaryInput = Entry.Input;
+  if (Entry.OutputFilename.empty())
+    OutputFilenames.clear();
+  else
+    setSingleOutputFilename(Entry.OutputFilename);
+  ModuleOutputPath = Entry.ModuleOutputPath;
+  ModuleDocOutputPath = Entry.ModuleDocOutputPath;
+  SerializedDiagnosticsPath = Entry.SerializedDiagnosticsPath;
+  DependenciesFilePath = Entry.DependenciesFilePath;
+  ReferenceDependenciesFilePath = Entry.ReferenceDependenciesFilePath;
+}
+
 void FrontendOptions::forAllOutputPaths(
     std::function<void(const std::string &)> fn) const {
   if (RequestedAction != FrontendOptions::EmitModuleOnly) {
@@ -20,6 +20,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
@@ -2987,6 +2988,44 @@ void IRGenSILFunction::visitBranchInst(swift::BranchInst *i) {
   Builder.CreateBr(lbb.bb);
 }
 
+/// Returns the execution count of the edge from \p From to its successor
+/// \p To in the -profile-use profile, if it is known.
+static Optional<uint64_t> getEdgeCount(SILBasicBlock *From,
+                                       SILBasicBlock *To) {
+  // The count of a block with other predecessors includes their edges too.
+  if (To->getSinglePredecessor() != From)
+    return None;
+  return To->getExecutionCount();
+}
+
+/// Returns branch weights for \p i from the -profile-use profile, or null if
+/// the counts of its edges aren't known.
+static llvm::MDNode *getBranchWeights(IRGenModule &IGM,
+                                      swift::CondBranchInst *i) {
+  Optional<uint64_t> TrueCount = getEdgeCount(i->getParent(), i->getTrueBB());
+  Optional<uint64_t> FalseCount = getEdgeCount(i->getParent(),
+                                               i->getFalseBB());
+
+  // If only one edge is known, the other one gets the rest of the count of
+  // the branch's block.
+  if (auto Count = i->getParent()->getExecutionCount()) {
+    if (TrueCount && !FalseCount)
+      FalseCount = *Count > *TrueCount ? *Count - *TrueCount : 0;
+    else if (FalseCount && !TrueCount)
+      TrueCount = *Count > *FalseCount ? *Count - *FalseCount : 0;
+  }
+  if (!TrueCount || !FalseCount)
+    return nullptr;
+
+  // Branch weights are 32 bits. Scale the counts down if necessary, and add
+  // one so that an edge that was never taken isn't treated as unreachable.
+  uint64_t Max = std::max(*TrueCount, *FalseCount);
+  uint64_t Scale = Max < UINT32_MAX ? 1 : Max / UINT32_MAX + 1;
+  return llvm::MDBuilder(IGM.getLLVMContext())
+      .createBranchWeights(uint32_t(*TrueCount / Scale + 1),
+                           uint32_t(*FalseCount / Scale + 1));
+}
+
 void IRGenSILFunction::visitCondBranchInst(swift::CondBranchInst *i) {
   LoweredBB &trueBB = getLoweredBB(i->getTrueBB());
   LoweredBB &falseBB = getLoweredBB(i->getFalseBB());
@@ -2996,7 +3035,8 @@ void IRGenSILFunction::visitCondBranchInst(swift::CondBranchInst *i) {
   addIncomingSILArgumentsToPHINodes(*this, trueBB, i->getTrueArgs());
   addIncomingSILArgumentsToPHINodes(*this, falseBB, i->getFalseArgs());
 
-  Builder.CreateCondBr(condValue, trueBB.bb, falseBB.bb);
+  Builder.CreateCondBr(condValue, trueBB.bb, falseBB.bb,
+                       getBranchWeights(IGM, i));
 }
 
 void IRGenSILFunction::visitRetainValueInst(swift::RetainValueInst *i) {
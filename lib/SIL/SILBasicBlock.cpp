@@ -160,6 +160,8 @@ SILBasicBlock *SILBasicBlock::splitBasicBlock(iterator I) {
   // Move all of the specified instructions from the original basic block into
   // the new basic block.
   New->InstList.splice(New->end(), InstList, I, end());
+  // The rest of a block is executed as often as its beginning.
+  New->ExecutionCount = ExecutionCount;
   return New;
 }
 
@@ -97,6 +97,7 @@ SILModule::~SILModule() {
 }
 
 void *SILModule::allocate(unsigned Size, unsigned Align) const {
+  NumAllocatedBytes += Size;
   if (getASTContext().LangOpts.UseMalloc)
     return AlignedAlloc(Size, Align);
 
@@ -104,6 +105,7 @@ void *SILModule::allocate(unsigned Size, unsigned Align) const {
 }
 
 void *SILModule::allocateInst(unsigned Size, unsigned Align) const {
+  NumAllocatedBytes += Size;
   return AlignedAlloc(Size, Align);
 }
 
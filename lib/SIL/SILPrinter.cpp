@@ -530,6 +530,15 @@ public:
       for (auto Id : PredIDs)
         *this << ' ' << Id;
     }
+
+    if (auto Count = BB->getExecutionCount()) {
+      if (BB->pred_empty()) {
+        PrintState.OS.PadToColumn(50);
+        PrintState.OS << "// count: " << *Count;
+      } else {
+        PrintState.OS << " count: " << *Count;
+      }
+    }
     *this << '\n';
 
     for (const SILInstruction &I : *BB)
@@ -39,6 +39,9 @@ using namespace Lowering;
 SILGenModule::SILGenModule(SILModule &M, Module *SM, bool makeModuleFragile)
   : M(M), Types(M.Types), SwiftModule(SM), TopLevelSGF(nullptr),
     Profiler(nullptr), makeModuleFragile(makeModuleFragile) {
+  StringRef ProfilePath = M.getOptions().UseProfile;
+  if (!ProfilePath.empty())
+    ProfileUse = ProfileCounts::load(M.getASTContext(), ProfilePath);
 }
 
 SILGenModule::~SILGenModule() {
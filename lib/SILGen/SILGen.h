@@ -59,6 +59,9 @@ public:
   /// disabled.
   std::unique_ptr<SILGenProfiling> Profiler;
 
+  /// The execution counts from -profile-use, or null if no profile is used.
+  std::unique_ptr<ProfileCounts> ProfileUse;
+
   /// Mapping from SILDeclRefs to emitted SILFunctions.
   llvm::DenseMap<SILDeclRef, SILFunction*> emittedFunctions;
   /// Mapping from ProtocolConformances to emitted SILWitnessTables.
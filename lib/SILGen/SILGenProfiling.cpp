@@ -15,24 +15,63 @@
 #include "SILGenFunction.h"
 #include "swift/AST/ASTNode.h"
 #include "swift/AST/ASTWalker.h"
+#include "swift/AST/DiagnosticsFrontend.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Parse/Lexer.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/ProfileData/CoverageMapping.h"
 #include "llvm/ProfileData/CoverageMappingWriter.h"
+#include "llvm/ProfileData/InstrProfReader.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MD5.h"
 
 #include <forward_list>
 
 using namespace swift;
 using namespace Lowering;
 
+std::unique_ptr<ProfileCounts> ProfileCounts::load(ASTContext &Ctx,
+                                                   StringRef Path) {
+  auto ReaderOrErr = llvm::InstrProfReader::create(Path);
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    Ctx.Diags.diagnose(SourceLoc(), diag::error_read_profile, Path,
+                       EC.message());
+    return nullptr;
+  }
+
+  auto &Reader = *ReaderOrErr.get();
+  auto Result = llvm::make_unique<ProfileCounts>();
+  for (const llvm::InstrProfRecord &Record : Reader)
+    Result->Functions[Record.Name] = {Record.Hash, Record.Counts};
+
+  if (Reader.hasError()) {
+    Ctx.Diags.diagnose(SourceLoc(), diag::error_read_profile, Path,
+                       Reader.getError().message());
+    return nullptr;
+  }
+  return Result;
+}
+
+ArrayRef<uint64_t> ProfileCounts::getCounts(StringRef Name,
+                                            uint64_t Hash) const {
+  auto It = Functions.find(Name);
+  if (It == Functions.end() || It->second.Hash != Hash)
+    return {};
+  return It->second.Counts;
+}
+
+bool ProfileCounts::hasCounts(StringRef Name) const {
+  return Functions.count(Name);
+}
+
 ProfilerRAII::ProfilerRAII(SILGenModule &SGM, AbstractFunctionDecl *D)
     : SGM(SGM) {
   const auto &Opts = SGM.M.getOptions();
-  if (!Opts.GenerateProfile)
+  if (!Opts.GenerateProfile && !SGM.ProfileUse)
     return;
-  SGM.Profiler =
-      llvm::make_unique<SILGenProfiling>(SGM, Opts.EmitProfileCoverageMapping);
+  SGM.Profiler = llvm::make_unique<SILGenProfiling>(
+      SGM, Opts.GenerateProfile,
+      Opts.GenerateProfile && Opts.EmitProfileCoverageMapping);
   SGM.Profiler->assignRegionCounters(D);
 }
 
@@ -40,6 +79,25 @@ ProfilerRAII::~ProfilerRAII() { SGM.Profiler = nullptr; }
 
 namespace {
 
+/// The kinds of regions that get a counter, in the order in which they were
+/// added. The function hash is computed from them, so existing values must not
+/// change.
+enum class RegionKind : uint8_t {
+  FunctionBody = 1,
+  If,
+  Guard,
+  While,
+  RepeatWhile,
+  For,
+  ForEach,
+  Switch,
+  Case,
+  DoCatch,
+  Catch,
+  IfExpr,
+  Closure,
+};
+
 /// An ASTWalker that maps ASTNodes to profiling counters.
 struct MapRegionCounters : public ASTWalker {
   /// The next counter value to assign.
@@ -48,45 +106,63 @@ struct MapRegionCounters : public ASTWalker {
   /// The map of statements to counters.
   llvm::DenseMap<ASTNode, unsigned> &CounterMap;
 
+  /// The hash of the kinds of the regions, in the order they were mapped.
+  llvm::MD5 Hash;
+
   MapRegionCounters(llvm::DenseMap<ASTNode, unsigned> &CounterMap)
       : NextCounter(0), CounterMap(CounterMap) {}
 
+  void mapRegion(ASTNode Node, RegionKind Kind) {
+    CounterMap[Node] = NextCounter++;
+    uint8_t KindValue = static_cast<uint8_t>(Kind);
+    Hash.update(KindValue);
+  }
+
+  /// Returns a hash of the structure of the function, so that counts recorded
+  /// for a different version of it are not applied.
+  uint64_t getHash() {
+    llvm::MD5::MD5Result Result;
+    Hash.final(Result);
+    using namespace llvm::support;
+    return endian::read<uint64_t, little, unaligned>(Result);
+  }
+
   bool walkToDeclPre(Decl *D) override {
     if (auto *AFD = dyn_cast<AbstractFunctionDecl>(D))
-      CounterMap[AFD->getBody()] = NextCounter++;
+      mapRegion(AFD->getBody(), RegionKind::FunctionBody);
     return true;
   }
 
   std::pair<bool, Stmt *> walkToStmtPre(Stmt *S) override {
     if (auto *IS = dyn_cast<IfStmt>(S)) {
-      CounterMap[IS->getThenStmt()] = NextCounter++;
+      mapRegion(IS->getThenStmt(), RegionKind::If);
     } else if (auto *US = dyn_cast<GuardStmt>(S)) {
-      CounterMap[US->getBody()] = NextCounter++;
+      mapRegion(US->getBody(), RegionKind::Guard);
     } else if (auto *WS = dyn_cast<WhileStmt>(S)) {
-      CounterMap[WS->getBody()] = NextCounter++;
+      mapRegion(WS->getBody(), RegionKind::While);
     } else if (auto *RWS = dyn_cast<RepeatWhileStmt>(S)) {
-      CounterMap[RWS->getBody()] = NextCounter++;
+      mapRegion(RWS->getBody(), RegionKind::RepeatWhile);
     } else if (auto *FS = dyn_cast<ForStmt>(S)) {
-      CounterMap[FS->getBody()] = NextCounter++;
+      mapRegion(FS->getBody(), RegionKind::For);
     } else if (auto *FES = dyn_cast<ForEachStmt>(S)) {
-      CounterMap[FES->getBody()] = NextCounter++;
+      mapRegion(FES->getBody(), RegionKind::ForEach);
     } else if (auto *SS = dyn_cast<SwitchStmt>(S)) {
-      CounterMap[SS] = NextCounter++;
+      mapRegion(SS, RegionKind::Switch);
     } else if (auto *CS = dyn_cast<CaseStmt>(S)) {
-      CounterMap[CS] = NextCounter++;
+      mapRegion(CS, RegionKind::Case);
     } else if (auto *DCS = dyn_cast<DoCatchStmt>(S)) {
-      CounterMap[DCS] = NextCounter++;
+      mapRegion(DCS, RegionKind::DoCatch);
     } else if (auto *CS = dyn_cast<CatchStmt>(S)) {
-      CounterMap[CS->getBody()] = NextCounter++;
+      mapRegion(CS->getBody(), RegionKind::Catch);
     }
     return {true, S};
   }
 
   std::pair<bool, Expr *> walkToExprPre(Expr *E) override {
     if (auto *IE = dyn_cast<IfExpr>(E))
-      CounterMap[IE->getThenExpr()] = NextCounter++;
+      mapRegion(IE->getThenExpr(), RegionKind::IfExpr);
     else if (isa<AutoClosureExpr>(E) || isa<ClosureExpr>(E))
-      CounterMap[E] = NextCounter++;
+      mapRegion(E, RegionKind::Closure);
     return {true, E};
   }
 };
@@ -640,8 +716,19 @@ void SILGenProfiling::assignRegionCounters(AbstractFunctionDecl *Root) {
   walkForProfiling(Root, Mapper);
 
   NumRegionCounters = Mapper.NextCounter;
-  // TODO: Mapper needs to calculate a function hash as it goes.
-  FunctionHash = 0x0;
+  FunctionHash = Mapper.getHash();
+
+  if (SGM.ProfileUse) {
+    RegionCounts = SGM.ProfileUse->getCounts(CurrentFuncName, FunctionHash);
+    // Counts recorded for a different version of the function don't
+    // correspond to our counters.
+    if (RegionCounts.size() != NumRegionCounters)
+      RegionCounts = {};
+    if (RegionCounts.empty() && SGM.ProfileUse->hasCounts(CurrentFuncName))
+      SGM.M.getASTContext().Diags.diagnose(Root->getLoc(),
+                                           diag::warn_profile_out_of_date,
+                                           Root->getFullName());
+  }
 
   if (EmitCoverageMapping) {
     CoverageMapping Coverage(SGM.M.getASTContext().SourceMgr);
@@ -669,6 +756,13 @@ void SILGenProfiling::emitCounterIncrement(SILGenBuilder &Builder,ASTNode Node){
   assert(CounterIt != RegionCounterMap.end() &&
          "cannot increment non-existent counter");
 
+  if (!RegionCounts.empty() && Builder.hasValidInsertionPoint())
+    Builder.getInsertionBB()->setExecutionCount(
+        RegionCounts[CounterIt->second]);
+
+  if (!EmitCounterIncrements)
+    return;
+
   auto Int32Ty = SGM.Types.getLoweredType(BuiltinIntegerType::get(32, C));
   auto Int64Ty = SGM.Types.getLoweredType(BuiltinIntegerType::get(64, C));
 
@@ -14,18 +14,45 @@
 #define SWIFT_SILGEN_PROFILING_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "swift/AST/ASTNode.h"
 #include "swift/AST/Stmt.h"
 
 namespace swift {
 
 class AbstractFunctionDecl;
+class ASTContext;
 
 namespace Lowering {
 
 class SILGenModule;
 class SILGenBuilder;
 
+/// The execution counts read from the profile given with -profile-use.
+class ProfileCounts {
+  struct FunctionCounts {
+    uint64_t Hash;
+    std::vector<uint64_t> Counts;
+  };
+
+  /// The region counts of each function in the profile, by name.
+  llvm::StringMap<FunctionCounts> Functions;
+
+public:
+  /// Read the profile at \p Path. Returns null and emits a diagnostic if the
+  /// profile cannot be read.
+  static std::unique_ptr<ProfileCounts> load(ASTContext &Ctx, StringRef Path);
+
+  /// Return the region counts of the function \p Name, or an empty array if
+  /// the profile has no counts for it, or if they were recorded for a
+  /// function with a different hash.
+  ArrayRef<uint64_t> getCounts(StringRef Name, uint64_t Hash) const;
+
+  /// Return true if the profile has counts for the function \p Name, whatever
+  /// their hash.
+  bool hasCounts(StringRef Name) const;
+};
+
 /// RAII object to set up profiling for a function.
 struct ProfilerRAII {
   SILGenModule &SGM;
@@ -37,6 +64,7 @@ struct ProfilerRAII {
 class SILGenProfiling {
 private:
   SILGenModule &SGM;
+  bool EmitCounterIncrements;
   bool EmitCoverageMapping;
 
   // The current function's name and counter data.
@@ -45,19 +73,26 @@ private:
   uint64_t FunctionHash;
   llvm::DenseMap<ASTNode, unsigned> RegionCounterMap;
 
+  /// The counts of the current function's regions in the -profile-use
+  /// profile, indexed like the counters, or empty if they aren't known.
+  ArrayRef<uint64_t> RegionCounts;
+
   std::vector<std::tuple<std::string, uint64_t, std::string>> CoverageData;
 
 public:
-  SILGenProfiling(SILGenModule &SGM, bool EmitCoverageMapping)
-      : SGM(SGM), EmitCoverageMapping(EmitCoverageMapping),
-        NumRegionCounters(0), FunctionHash(0) {}
+  SILGenProfiling(SILGenModule &SGM, bool EmitCounterIncrements,
+                  bool EmitCoverageMapping)
+      : SGM(SGM), EmitCounterIncrements(EmitCounterIncrements),
+        EmitCoverageMapping(EmitCoverageMapping), NumRegionCounters(0),
+        FunctionHash(0) {}
 
   bool hasRegionCounters() const { return NumRegionCounters != 0; }
 
   /// Map counters to ASTNodes and set them up for profiling the given function.
   void assignRegionCounters(AbstractFunctionDecl *Root);
 
-  /// Emit SIL to increment the counter for \c Node.
+  /// Emit SIL to increment the counter for \c Node, and attach the count of
+  /// \c Node from the -profile-use profile to the current block.
   void emitCounterIncrement(SILGenBuilder &Builder, ASTNode Node);
 };
 
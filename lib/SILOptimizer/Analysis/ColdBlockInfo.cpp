@@ -107,10 +107,14 @@ ColdBlockInfo::BranchHint ColdBlockInfo::getBranchHint(SILValue Cond,
 }
 
 /// \return true if the CFG edge FromBB->ToBB is directly gated by a _slowPath
-/// branch hint.
+/// branch hint, or if ToBB was never executed in the profile.
 bool ColdBlockInfo::isSlowPath(const SILBasicBlock *FromBB,
                                const SILBasicBlock *ToBB,
                                int recursionDepth) {
+  // Execution counts from a profile take precedence over branch hints.
+  if (auto Count = ToBB->getExecutionCount())
+    return *Count == 0;
+
   auto *CBI = dyn_cast<CondBranchInst>(FromBB->getTerminator());
   if (!CBI)
     return false;
@@ -135,6 +139,15 @@ bool ColdBlockInfo::isCold(const SILBasicBlock *BB, int recursionDepth) {
   if (I != ColdBlockMap.end())
     return I->second;
 
+  // A block that was executed in the profile is not cold, even if it is
+  // dominated by a _slowPath branch hint.
+  if (auto Count = BB->getExecutionCount()) {
+    if (*Count != 0) {
+      ColdBlockMap[BB] = false;
+      return false;
+    }
+  }
+
   typedef llvm::DomTreeNodeBase<SILBasicBlock> DomTreeNode;
   DominanceInfo *DT = DA->get(const_cast<SILFunction*>(BB->getParent()));
   DomTreeNode *Node = DT->getNode(const_cast<SILBasicBlock*>(BB));
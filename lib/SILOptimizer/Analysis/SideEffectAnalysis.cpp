@@ -16,6 +16,9 @@
 #include "swift/SILOptimizer/Analysis/FunctionOrder.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SIL/SILArgument.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
 
 using namespace swift;
 
@@ -23,6 +26,16 @@ using FunctionEffects = SideEffectAnalysis::FunctionEffects;
 using Effects = SideEffectAnalysis::Effects;
 using MemoryBehavior = SILInstruction::MemoryBehavior;
 
+STATISTIC(NumUpdatesKeepingCallers,
+          "# of function updates which kept the side-effects of the callers");
+STATISTIC(NumUpdatesInvalidatingCallers,
+          "# of function updates which invalidated the callers");
+
+llvm::cl::opt<bool> VerifySideEffectUpdates(
+    "sil-verify-side-effect-updates", llvm::cl::init(false),
+    llvm::cl::desc("When verifying analyses, compare the side-effect analysis "
+                   "against a recomputation for the whole module"));
+
 MemoryBehavior
 FunctionEffects::getMemBehavior(RetainObserveKind ScanKind) const {
 
@@ -491,19 +504,113 @@ void SideEffectAnalysis::getEffects(FunctionEffects &ApplyEffects, FullApplySite
   }
 }
 
+/// Returns true if side-effects can change because of the changes described by
+/// \p K. Side-effects only depend on the instructions and calls of functions,
+/// and not on the control flow between them.
+static bool mayChangeSideEffects(SILAnalysis::InvalidationKind K) {
+  return K & (SILAnalysis::InvalidationKind::Instructions |
+              SILAnalysis::InvalidationKind::Calls |
+              SILAnalysis::InvalidationKind::Functions);
+}
+
 void SideEffectAnalysis::invalidate(InvalidationKind K) {
+  if (!mayChangeSideEffects(K))
+    return;
+  PendingUpdates.clear();
   Function2Info.clear();
   Allocator.DestroyAll();
   DEBUG(llvm::dbgs() << "invalidate all\n");
 }
 
 void SideEffectAnalysis::invalidate(SILFunction *F, InvalidationKind K) {
-  if (FunctionInfo *FInfo = Function2Info.lookup(F)) {
+  if (!mayChangeSideEffects(K))
+    return;
+  FunctionInfo *FInfo = Function2Info.lookup(F);
+  if (!FInfo)
+    return;
+
+  // If functions were created or deleted, the callees of other functions may
+  // have changed, too.
+  if (!FInfo->isValid() || (K & InvalidationKind::Functions)) {
     DEBUG(llvm::dbgs() << "  invalidate " << FInfo->F->getName() << '\n');
+    PendingUpdates.remove(FInfo);
     invalidateIncludingAllCallers(FInfo);
+    return;
+  }
+
+  // Only the body of F changed. Its callers only need to be invalidated if
+  // the side-effects of F get worse, which we find out when they are
+  // recomputed.
+  DEBUG(llvm::dbgs() << "  schedule update of " << FInfo->F->getName() <<
+        '\n');
+  PendingUpdates.insert(FInfo);
+}
+
+void SideEffectAnalysis::applyPendingUpdates() {
+  for (FunctionInfo *FInfo : PendingUpdates) {
+    // Invalidating another function may have invalidated this one.
+    if (!FInfo->isValid())
+      continue;
+
+    FunctionEffects PrevFE = FInfo->FE;
+    invalidateExcludingCallers(FInfo);
+    recompute(FInfo);
+
+    // The callers merged the previous side-effects. They are still correct
+    // if those include all the new ones.
+    if (PrevFE.mergeFrom(FInfo->FE)) {
+      DEBUG(llvm::dbgs() << "  side-effects of " << FInfo->F->getName() <<
+            " got worse, invalidate callers\n");
+      ++NumUpdatesInvalidatingCallers;
+      invalidateAllCallers(FInfo);
+    } else {
+      ++NumUpdatesKeepingCallers;
+    }
+  }
+  PendingUpdates.clear();
+}
+
+void SideEffectAnalysis::verify() const {
+  if (!VerifySideEffectUpdates)
+    return;
+
+  // Check what queries would see.
+  const_cast<SideEffectAnalysis *>(this)->applyPendingUpdates();
+
+  // Recompute the side-effects of all functions in bottom-up order, so that
+  // the recursion limit is only reached in cycles of the call-graph.
+  SideEffectAnalysis Recomputed(M);
+  Recomputed.BCA = BCA;
+  llvm::DenseSet<SILFunction *> InCycle;
+  swift::BottomUpFunctionOrder BottomUpOrder(*M, BCA);
+  for (auto SCC : BottomUpOrder.getSCCs()) {
+    for (SILFunction *F : SCC) {
+      if (SCC.size() > 1)
+        InCycle.insert(F);
+      Recomputed.getEffects(F);
+    }
+  }
+
+  // The side-effects we kept may be more conservative than the recomputed
+  // ones, e.g. if they were computed before an optimization removed a call,
+  // but they must not miss any. Functions in call-graph cycles are skipped,
+  // because their side-effects depend on where the recomputation started.
+  for (auto &Entry : Function2Info) {
+    FunctionInfo *FInfo = Entry.second;
+    if (!FInfo->isValid() || InCycle.count(FInfo->F))
+      continue;
+
+    FunctionEffects Merged = FInfo->FE;
+    const FunctionEffects &Expected = Recomputed.getEffects(FInfo->F);
+    if (Merged.mergeFrom(Expected)) {
+      llvm::errs() << "Side-effect analysis is not up to date for "
+                   << FInfo->F->getName() << "\nKept: " << FInfo->FE
+                   << "\nRecomputed: " << Expected << '\n';
+      abort();
+    }
   }
 }
 
 SILAnalysis *swift::createSideEffectAnalysis(SILModule *M) {
-  return new SideEffectAnalysis();
+  return new SideEffectAnalysis(M);
 }
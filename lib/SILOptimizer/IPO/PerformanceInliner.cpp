@@ -64,6 +64,15 @@ namespace {
   // Additional benefit for each loop level.
   const unsigned LoopBenefitFactor = 40;
 
+  // Additional benefit for a call site that the profile given with
+  // -profile-use shows to be hot, i.e. executed more often than its caller
+  // was entered, for each doubling of its execution count.
+  const unsigned HotCallSiteBenefitFactor = 40;
+
+  // The maximum number of doublings for which HotCallSiteBenefitFactor is
+  // added.
+  const unsigned MaxHotCallSiteLevels = 4;
+
   // Approximately up to this cost level a function can be inlined without
   // increasing the code size.
   const unsigned TrivialFunctionThreshold = 20;
@@ -653,6 +662,24 @@ static SILBasicBlock *getTakenBlock(TermInst *term,
   return nullptr;
 }
 
+/// Return the number of times the execution count of the block of \p AI
+/// doubles that of the entry of its function in the -profile-use profile, or
+/// zero if it doesn't or the counts aren't known.
+static unsigned getHotCallSiteLevel(FullApplySite AI) {
+  auto CallCount = AI.getParent()->getExecutionCount();
+  auto EntryCount = AI.getFunction()->front().getExecutionCount();
+  if (!CallCount || !EntryCount || *EntryCount == 0)
+    return 0;
+
+  unsigned Level = 0;
+  uint64_t Ratio = *CallCount / *EntryCount;
+  while (Ratio > 1 && Level < MaxHotCallSiteLevels) {
+    Ratio /= 2;
+    ++Level;
+  }
+  return Level;
+}
+
 /// Return true if inlining this call site is profitable.
 bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
                                               unsigned loopDepthOfAI,
@@ -677,6 +704,7 @@ bool SILPerformanceInliner::isProfitableToInline(FullApplySite AI,
   unsigned Benefit = InlineCostThreshold > 0 ? InlineCostThreshold :
                                                RemovedCallBenefit;
   Benefit += loopDepthOfAI * LoopBenefitFactor;
+  Benefit += getHotCallSiteLevel(AI) * HotCallSiteBenefitFactor;
   int testThreshold = TestThreshold;
 
   while (SILBasicBlock *block = domOrder.getNext()) {
@@ -324,6 +324,20 @@ updateSSA(SILLoop *Loop,
   }
 }
 
+/// Returns true if the profile given with -profile-use shows that no block of
+/// the loop was ever executed. Unrolling such a loop only grows the code.
+static bool isNeverExecuted(SILLoop *Loop) {
+  bool HasCount = false;
+  for (auto *BB : Loop->getBlocks()) {
+    if (auto Count = BB->getExecutionCount()) {
+      if (*Count != 0)
+        return false;
+      HasCount = true;
+    }
+  }
+  return HasCount;
+}
+
 /// Try to fully unroll the loop if we can determine the trip count and the trip
 /// count lis below a threshold.
 static bool tryToUnrollLoop(SILLoop *Loop) {
@@ -339,6 +353,9 @@ static bool tryToUnrollLoop(SILLoop *Loop) {
 
   auto *Header = Loop->getHeader();
 
+  if (isNeverExecuted(Loop))
+    return false;
+
   Optional<uint64_t> MaxTripCount =
       getMaxLoopTripCount(Loop, Preheader, Header, Latch);
   if (!MaxTripCount)
@@ -13,6 +13,7 @@
 #define DEBUG_TYPE "sil-passmanager"
 
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Basic/JSONSerialization.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
 #include "swift/SIL/SILFunction.h"
 #include "swift/SIL/SILModule.h"
@@ -23,8 +24,11 @@
 #include "swift/SILOptimizer/Analysis/FunctionOrder.h"
 #include "swift/SILOptimizer/Analysis/BasicCalleeAnalysis.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/GraphWriter.h"
 
@@ -85,6 +89,12 @@ llvm::cl::opt<bool> SILVerifyWithoutInvalidation(
     "sil-verify-without-invalidation", llvm::cl::init(false),
     llvm::cl::desc("Verify after passes even if the pass has not invalidated"));
 
+llvm::cl::opt<std::string> SILPassStatsFile(
+    "sil-pass-stats", llvm::cl::init(""),
+    llvm::cl::desc("Write the execution time, instruction count change and "
+                   "allocated bytes of each SIL pass on each function to this "
+                   "file as JSON"));
+
 static bool doPrintBefore(SILTransform *T, SILFunction *F) {
   if (!SILPrintOnlyFun.empty() && F && F->getName() != SILPrintOnlyFun)
     return false;
@@ -154,6 +164,159 @@ static void printModule(SILModule *Mod, bool EmitVerboseSIL) {
   }
 }
 
+namespace {
+/// The accumulated cost of running one pass on one function, or on the whole
+/// module for module passes.
+struct PassStats {
+  std::string Stage;
+  std::string Pass;
+  std::string Function;
+  uint32_t Runs = 0;
+  uint64_t TimeNanos = 0;
+  int64_t InstDelta = 0;
+  uint64_t AllocatedBytes = 0;
+};
+
+/// The statistics of all passes run by this process. They are written to the
+/// -sil-pass-stats file when the report is destroyed by llvm_shutdown, like
+/// the statistics printed by -print-stats.
+struct PassStatsReport {
+  std::string Path = SILPassStatsFile;
+  std::vector<PassStats> Passes;
+  llvm::StringMap<size_t> Indices;
+
+  PassStats &getEntry(StringRef Stage, StringRef Pass, StringRef Function) {
+    std::string Key = Stage.str();
+    Key += '\0';
+    Key += Pass;
+    Key += '\0';
+    Key += Function;
+    auto Inserted = Indices.insert({Key, Passes.size()});
+    if (Inserted.second) {
+      Passes.emplace_back();
+      Passes.back().Stage = Stage.str();
+      Passes.back().Pass = Pass.str();
+      Passes.back().Function = Function.str();
+    }
+    return Passes[Inserted.first->second];
+  }
+
+  ~PassStatsReport();
+};
+} // end anonymous namespace
+
+namespace swift {
+namespace json {
+  template<>
+  struct ObjectTraits<PassStats> {
+    static void mapping(Output &out, PassStats &value) {
+      out.mapRequired("stage", value.Stage);
+      out.mapRequired("pass", value.Pass);
+      out.mapOptional("function", value.Function, std::string());
+      out.mapRequired("runs", value.Runs);
+      out.mapRequired("time_ns", value.TimeNanos);
+      out.mapRequired("inst_delta", value.InstDelta);
+      out.mapRequired("allocated_bytes", value.AllocatedBytes);
+    }
+  };
+
+  template<>
+  struct ArrayTraits<std::vector<PassStats>> {
+    static size_t size(Output &out, std::vector<PassStats> &seq) {
+      return seq.size();
+    }
+
+    static PassStats &element(Output &out, std::vector<PassStats> &seq,
+                              size_t index) {
+      if (index >= seq.size())
+        seq.resize(index+1);
+      return seq[index];
+    }
+  };
+
+  template<>
+  struct ObjectTraits<PassStatsReport> {
+    static void mapping(Output &out, PassStatsReport &value) {
+      out.mapRequired("passes", value.Passes);
+    }
+  };
+} // end namespace json
+} // end namespace swift
+
+PassStatsReport::~PassStatsReport() {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+  if (EC) {
+    llvm::errs() << "error: unable to write SIL pass statistics to '" << Path
+                 << "': " << EC.message() << '\n';
+    return;
+  }
+  json::Output JOut(OS);
+  JOut << *this;
+  OS << "\n";
+}
+
+static llvm::ManagedStatic<PassStatsReport> PassStatsForProcess;
+
+static int64_t countInstructions(SILFunction &F) {
+  int64_t Count = 0;
+  for (auto &BB : F)
+    Count += BB.size();
+  return Count;
+}
+
+static int64_t countInstructions(SILModule &M) {
+  int64_t Count = 0;
+  for (auto &F : M)
+    Count += countInstructions(F);
+  return Count;
+}
+
+namespace {
+/// Measures a single run of a pass for -sil-pass-stats. If the option isn't
+/// set this does nothing.
+class PassStatsRecorder {
+  StringRef Stage;
+  SILTransform *T;
+  SILModule *M;
+  SILFunction *F;
+  int64_t InstsBefore = 0;
+  uint64_t BytesBefore = 0;
+  llvm::sys::TimeValue StartTime;
+
+public:
+  /// Starts measuring \p T on \p F, or on the whole module \p M if \p F is
+  /// null.
+  PassStatsRecorder(StringRef Stage, SILTransform *T, SILModule *M,
+                    SILFunction *F)
+      : Stage(Stage), T(T), M(M), F(F), StartTime(0, 0) {
+    if (SILPassStatsFile.empty())
+      return;
+    InstsBefore = F ? countInstructions(*F) : countInstructions(*M);
+    BytesBefore = M->getNumAllocatedBytes();
+    StartTime = llvm::sys::TimeValue::now();
+  }
+
+  /// Adds the cost of the run to the report.
+  void finish() {
+    if (SILPassStatsFile.empty())
+      return;
+    llvm::sys::TimeValue Duration = llvm::sys::TimeValue::now() - StartTime;
+    int64_t InstsAfter = F ? countInstructions(*F) : countInstructions(*M);
+
+    PassStats &Entry = PassStatsForProcess->getEntry(
+        Stage, T->getName(), F ? F->getName() : StringRef());
+    ++Entry.Runs;
+    Entry.TimeNanos +=
+        uint64_t(Duration.seconds()) *
+            llvm::sys::TimeValue::NANOSECONDS_PER_SECOND +
+        Duration.nanoseconds();
+    Entry.InstDelta += InstsAfter - InstsBefore;
+    Entry.AllocatedBytes += M->getNumAllocatedBytes() - BytesBefore;
+  }
+};
+} // end anonymous namespace
+
 SILPassManager::SILPassManager(SILModule *M, llvm::StringRef Stage) :
   Mod(M), StageName(Stage) {
   
@@ -227,11 +390,13 @@ void SILPassManager::runPassesOnFunction(PassList FuncTransforms,
       F->dump(Options.EmitVerboseSIL);
     }
 
+    PassStatsRecorder Stats(StageName, SFT, Mod, F);
     llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
     Mod->registerDeleteNotificationHandler(SFT);
     SFT->run();
     assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
     Mod->removeDeleteNotificationHandler(SFT);
+    Stats.finish();
 
     // Did running the transform result in new functions being added
     // to the top of our worklist?
@@ -367,12 +532,14 @@ void SILPassManager::runModulePass(SILModuleTransform *SMT) {
     printModule(Mod, Options.EmitVerboseSIL);
   }
 
+  PassStatsRecorder Stats(StageName, SMT, Mod, nullptr);
   llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
   Mod->registerDeleteNotificationHandler(SMT);
   SMT->run();
   Mod->removeDeleteNotificationHandler(SMT);
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
+  Stats.finish();
 
   if (SILPrintPassTime) {
     auto Delta = llvm::sys::TimeValue::now().nanoseconds() -
@@ -391,6 +391,41 @@ SILFunction *swift::getExistingSpecialization(SILModule &M,
   return Specialization;
 }
 
+/// Try to link a specialization that was created and optimized when an
+/// imported module was compiled, and serialized into that module.
+///
+/// The mangled name identifies both the original function and the
+/// substitutions, so a specialization with the same name is the same
+/// specialization.
+///
+/// \returns true if a function named \p FunctionName could be linked. In this
+/// case \p Specialization is set to it, or to null if it cannot be used for
+/// this call.
+static bool linkImportedSpecialization(SILModule &M, StringRef FunctionName,
+                                       const ReabstractionInfo &ReInfo,
+                                       SILFunction *&Specialization) {
+  Specialization = nullptr;
+  if (!M.getOptions().EnableImportedSpecializations)
+    return false;
+  if (!M.linkFunction(FunctionName, SILOptions::LinkingMode::LinkNormal))
+    return false;
+
+  SILFunction *F = M.lookUpFunction(FunctionName);
+  assert(F && "Linked function is not in the module");
+  // The imported module may have been compiled with a different version of
+  // the original function.
+  if (F->getLoweredFunctionType() != ReInfo.getSpecializedType()) {
+    DEBUG(llvm::dbgs() << "    Imported specialization has a different type: "
+                       << FunctionName << '\n');
+    return true;
+  }
+
+  DEBUG(llvm::dbgs() << "    Linked imported specialization: "
+                     << FunctionName << '\n');
+  Specialization = F;
+  return true;
+}
+
 /// Create a re-abstraction thunk for a partial_apply.
 /// This is needed in case we converted some parameters/results of the
 /// specialized function from indirect to direct but the result function of the
@@ -573,17 +608,25 @@ void swift::trySpecializeApplyOfGeneric(ApplySite Apply,
     if (M.getOptions().Optimization <= SILOptions::SILOptMode::None)
       return;
 
-    DEBUG(
-      if (M.getOptions().Optimization <= SILOptions::SILOptMode::Debug) {
-        llvm::dbgs() << "Creating a specialization: " << ClonedName << "\n"; });
+    // An imported module may already contain an optimized version of this
+    // specialization. If it has an unexpected type, it still occupies the
+    // name, so we cannot create our own.
+    if (linkImportedSpecialization(M, ClonedName, ReInfo, SpecializedF)) {
+      if (!SpecializedF)
+        return;
+    } else {
+      DEBUG(
+        if (M.getOptions().Optimization <= SILOptions::SILOptMode::Debug) {
+          llvm::dbgs() << "Creating a specialization: " << ClonedName << "\n"; });
 
-    // Create a new function.
-    SpecializedF = GenericCloner::cloneFunction(F, ReInfo, ContextSubs,
-                                                   ClonedName, Apply);
+      // Create a new function.
+      SpecializedF = GenericCloner::cloneFunction(F, ReInfo, ContextSubs,
+                                                     ClonedName, Apply);
 
-    // Check if this specialization should be cached.
-    cacheSpecialization(M, SpecializedF);
-    NewFunctions.push_back(SpecializedF);
+      // Check if this specialization should be cached.
+      cacheSpecialization(M, SpecializedF);
+      NewFunctions.push_back(SpecializedF);
+    }
   }
   DeadApplies.push_back(Apply.getInstruction());
   if (replacePartialApplyWithoutReabstraction) {
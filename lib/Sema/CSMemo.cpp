@@ -0,0 +1,433 @@
+//===--- CSMemo.cpp - Memoized Overload Choices ---------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the memoization of overload choices across
+// expressions of the same shape, such as the elements of a table of literals
+// or chains of operators applied to literals. Each such expression generates
+// the same constraints with the same overload sets, so the choices that
+// solved the first one are tried first for the rest.
+//
+// A memoized choice is only a starting point: it must name one of the terms
+// of the overload set it is made for, and the system is still solved with
+// it. If it doesn't lead to a solution, the system is solved from scratch.
+//
+//===----------------------------------------------------------------------===//
+#include "ConstraintSystem.h"
+#include "ConstraintGraph.h"
+#include "swift/AST/ASTWalker.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace swift;
+using namespace constraints;
+
+namespace {
+  /// Writes the shape of an expression into a memoization key, numbering
+  /// its subexpressions in the order they are written.
+  class MemoKeyWriter : public ASTWalker {
+    llvm::raw_ostream &OS;
+    llvm::DenseMap<Expr *, unsigned> &Indices;
+
+    /// Writes what \p E contributes to the constraints generated for it,
+    /// beyond its kind and its children.
+    ///
+    /// \returns false if that can't be written, or could depend on more than
+    /// the expression itself.
+    bool writeExpr(Expr *E) {
+      switch (E->getKind()) {
+      case ExprKind::NilLiteral:
+      case ExprKind::IntegerLiteral:
+      case ExprKind::FloatLiteral:
+      case ExprKind::BooleanLiteral:
+      case ExprKind::InterpolatedStringLiteral:
+      case ExprKind::DiscardAssignment:
+      case ExprKind::Paren:
+      case ExprKind::Try:
+      case ExprKind::ForceTry:
+      case ExprKind::OptionalTry:
+      case ExprKind::Array:
+      case ExprKind::Dictionary:
+      case ExprKind::Call:
+      case ExprKind::PrefixUnary:
+      case ExprKind::PostfixUnary:
+      case ExprKind::Binary:
+      case ExprKind::InOut:
+      case ExprKind::BindOptional:
+      case ExprKind::OptionalEvaluation:
+      case ExprKind::ForceValue:
+      case ExprKind::If:
+      case ExprKind::Assign:
+        return true;
+
+      case ExprKind::StringLiteral: {
+        auto literal = cast<StringLiteralExpr>(E);
+        OS << ' ' << literal->isSingleUnicodeScalar()
+           << literal->isSingleExtendedGraphemeCluster();
+        return true;
+      }
+
+      case ExprKind::MagicIdentifierLiteral:
+        OS << ' ' << unsigned(cast<MagicIdentifierLiteralExpr>(E)->getKind());
+        return true;
+
+      case ExprKind::DeclRef: {
+        auto declRef = cast<DeclRefExpr>(E);
+        if (declRef->isSpecialized())
+          return false;
+        writePointer(declRef->getDecl());
+        OS << ' ' << unsigned(declRef->getAccessSemantics());
+        return true;
+      }
+
+      case ExprKind::OverloadedDeclRef: {
+        auto overloaded = cast<OverloadedDeclRefExpr>(E);
+        if (overloaded->isSpecialized())
+          return false;
+        for (auto decl : overloaded->getDecls())
+          writePointer(decl);
+        return true;
+      }
+
+      case ExprKind::UnresolvedDot:
+        writePointer(cast<UnresolvedDotExpr>(E)->getName().getOpaqueValue());
+        return true;
+
+      case ExprKind::UnresolvedMember:
+        writePointer(
+          cast<UnresolvedMemberExpr>(E)->getName().getOpaqueValue());
+        return true;
+
+      case ExprKind::Subscript:
+        return !cast<SubscriptExpr>(E)->hasDecl();
+
+      case ExprKind::Tuple: {
+        auto tuple = cast<TupleExpr>(E);
+        OS << ' ' << tuple->hasTrailingClosure();
+        if (tuple->hasElementNames())
+          for (auto name : tuple->getElementNames())
+            writePointer(name.get());
+        return true;
+      }
+
+      case ExprKind::Type:
+        return writeType(cast<TypeExpr>(E)->getTypeLoc().getType());
+
+      case ExprKind::ForcedCheckedCast:
+      case ExprKind::ConditionalCheckedCast:
+      case ExprKind::Is:
+      case ExprKind::Coerce: {
+        auto castExpr = cast<ExplicitCastExpr>(E);
+        return writeType(castExpr->getCastTypeLoc().getType());
+      }
+
+      default:
+        return false;
+      }
+    }
+
+    void writePointer(const void *pointer) {
+      OS << ' ' << pointer;
+    }
+
+    bool writeType(Type type) {
+      if (!type)
+        return false;
+      writePointer(type.getPointer());
+      return true;
+    }
+
+  public:
+    bool Memoizable = true;
+
+    MemoKeyWriter(llvm::raw_ostream &OS,
+                  llvm::DenseMap<Expr *, unsigned> &Indices)
+      : OS(OS), Indices(Indices) { }
+
+    std::pair<bool, Expr *> walkToExprPre(Expr *E) override {
+      Indices.insert({E, Indices.size()});
+      OS << '(' << unsigned(E->getKind()) << ' ' << E->isImplicit();
+      if (!writeExpr(E)) {
+        Memoizable = false;
+        return { false, nullptr };
+      }
+      return { true, E };
+    }
+
+    Expr *walkToExprPost(Expr *E) override {
+      OS << ')';
+      return E;
+    }
+
+    std::pair<bool, Stmt *> walkToStmtPre(Stmt *S) override {
+      Memoizable = false;
+      return { false, nullptr };
+    }
+
+    std::pair<bool, Pattern *> walkToPatternPre(Pattern *P) override {
+      Memoizable = false;
+      return { false, nullptr };
+    }
+
+    bool walkToDeclPre(Decl *D) override {
+      Memoizable = false;
+      return false;
+    }
+  };
+} // end anonymous namespace
+
+void ConstraintSystem::computeMemoKey(
+       Expr *expr, Type convertType,
+       FreeTypeVariableBinding allowFreeTypeVariables,
+       StringRef listenerKey) {
+  clearMemoKey();
+
+  llvm::raw_string_ostream OS(MemoKey);
+
+  // The context determines what the names in the expression can refer to,
+  // and how the types in it are opened.
+  OS << static_cast<const void *>(convertType.getPointer()) << ' '
+     << static_cast<const void *>(getContextualType().getPointer()) << ' '
+     << unsigned(getContextualTypePurpose()) << ' '
+     << unsigned(allowFreeTypeVariables) << ' '
+     << unsigned(Options.toRaw()) << ' '
+     << static_cast<const void *>(DC->getParentSourceFile()) << ' '
+     << static_cast<const void *>(DC->getInnermostTypeContext()) << ' '
+     << static_cast<const void *>(DC->getGenericParamsOfContext()) << ' '
+     << listenerKey << ';';
+
+  MemoKeyWriter writer(OS, MemoAnchorIndices);
+  expr->walk(writer);
+  OS.flush();
+
+  if (!writer.Memoizable)
+    clearMemoKey();
+}
+
+/// Appends the path of \p locator to \p path, with each element's kind
+/// followed by its values.
+///
+/// \returns true if an element of the path refers to a declaration, which
+/// need not be the same for expressions of the same shape.
+static bool encodeLocatorPath(ConstraintLocator *locator,
+                              SmallVectorImpl<unsigned> &path) {
+  for (auto elt : locator->getPath()) {
+    auto kind = elt.getKind();
+    switch (kind) {
+    case ConstraintLocator::Archetype:
+    case ConstraintLocator::AssociatedType:
+    case ConstraintLocator::Witness:
+      return true;
+
+    default:
+      break;
+    }
+
+    path.push_back(kind);
+    unsigned numValues = ConstraintLocator::numNumericValuesInPathElement(kind);
+    if (numValues > 0)
+      path.push_back(elt.getValue());
+    if (numValues > 1)
+      path.push_back(elt.getValue2());
+  }
+  return false;
+}
+
+using MemoizedOverloadChoice = TypeChecker::MemoizedOverloadChoice;
+
+/// Finds the memoized choice for the overload set at \p locator.
+static const MemoizedOverloadChoice *
+lookupMemoizedChoice(ArrayRef<MemoizedOverloadChoice> memo,
+                     const llvm::DenseMap<Expr *, unsigned> &anchorIndices,
+                     ConstraintLocator *locator) {
+  if (!locator || !locator->getAnchor())
+    return nullptr;
+
+  auto anchorIndex = anchorIndices.find(locator->getAnchor());
+  if (anchorIndex == anchorIndices.end())
+    return nullptr;
+
+  SmallVector<unsigned, 4> path;
+  if (encodeLocatorPath(locator, path))
+    return nullptr;
+
+  auto first = std::lower_bound(memo.begin(), memo.end(), anchorIndex->second,
+                                [](const MemoizedOverloadChoice &choice,
+                                   unsigned index) {
+    return choice.AnchorIndex < index;
+  });
+  for (auto choice = first;
+       choice != memo.end() && choice->AnchorIndex == anchorIndex->second;
+       ++choice) {
+    if (llvm::makeArrayRef(choice->Path) == llvm::makeArrayRef(path))
+      return &*choice;
+  }
+  return nullptr;
+}
+
+/// Finds the term of \p disjunction, or of a disjunction nested in it, that
+/// makes the memoized choice.
+static Constraint *findMemoizedTerm(Constraint *disjunction,
+                                    const MemoizedOverloadChoice &choice) {
+  for (auto term : disjunction->getNestedConstraints()) {
+    if (term->getKind() == ConstraintKind::Disjunction) {
+      if (term->shouldRememberChoice())
+        continue;
+      if (auto found = findMemoizedTerm(term, choice))
+        return found;
+      continue;
+    }
+
+    if (term->getKind() != ConstraintKind::BindOverload)
+      continue;
+
+    auto overload = term->getOverloadChoice();
+    if (unsigned(overload.getKind()) == choice.Kind &&
+        overload.isDecl() && overload.getDecl() == choice.Decl)
+      return term;
+  }
+  return nullptr;
+}
+
+bool ConstraintSystem::solveWithMemoizedChoices(
+       SmallVectorImpl<Solution> &solutions,
+       FreeTypeVariableBinding allowFreeTypeVariables) {
+  // The memoized choices are made in place of the solver's first steps,
+  // which start with every constraint inactive.
+  if (failedConstraint || !ActiveConstraints.empty())
+    return true;
+
+  ++solverState->NumMemoLookups;
+  auto known = TC.SolverMemo.find(MemoKey);
+  if (known == TC.SolverMemo.end())
+    return true;
+  ArrayRef<MemoizedOverloadChoice> memo = known->getValue();
+
+  // Pair each overload set that a choice was memoized for with its term
+  // that makes the same choice here.
+  SmallVector<std::pair<Constraint *, Constraint *>, 8> picked;
+  for (auto &constraint : InactiveConstraints) {
+    if (constraint.getKind() != ConstraintKind::Disjunction ||
+        constraint.shouldRememberChoice())
+      continue;
+
+    auto choice = lookupMemoizedChoice(memo, MemoAnchorIndices,
+                                       constraint.getLocator());
+    if (!choice)
+      continue;
+
+    auto term = findMemoizedTerm(&constraint, *choice);
+    if (!term) {
+      ++solverState->NumMemoRejected;
+      return true;
+    }
+    picked.push_back({&constraint, term});
+  }
+
+  if (picked.empty()) {
+    ++solverState->NumMemoRejected;
+    return true;
+  }
+
+  if (TC.getLangOpts().DebugConstraintSolver) {
+    auto &log = getASTContext().TypeCheckerDebug->getStream();
+    log << "---Memoized overload choices---\n";
+    for (auto &entry : picked) {
+      entry.second->print(log, &TC.Context.SourceMgr);
+      log << '\n';
+    }
+  }
+
+  // Take the overload sets out of the system, as solveSimplified does when
+  // it tries one of their terms.
+  SmallVector<ConstraintList::iterator, 8> afterDisjunctions;
+  for (auto &entry : picked) {
+    afterDisjunctions.push_back(InactiveConstraints.erase(entry.first));
+    CG.removeConstraint(entry.first);
+  }
+
+  bool failed;
+  {
+    SolverScope scope(*this);
+    for (auto &entry : picked) {
+      auto term = entry.second;
+      switch (simplifyConstraint(*term)) {
+      case SolutionKind::Error:
+        if (!failedConstraint)
+          failedConstraint = term;
+        solverState->retiredConstraints.push_back(term);
+        break;
+
+      case SolutionKind::Solved:
+        solverState->retiredConstraints.push_back(term);
+        break;
+
+      case SolutionKind::Unsolved:
+        InactiveConstraints.push_back(term);
+        CG.addConstraint(term);
+        break;
+      }
+
+      solverState->generatedConstraints.push_back(term);
+    }
+
+    failed = solveRec(solutions, allowFreeTypeVariables);
+  }
+
+  // Put the overload sets back in their places.
+  for (unsigned i = picked.size(); i != 0; --i) {
+    InactiveConstraints.insert(afterDisjunctions[i - 1], picked[i - 1].first);
+    CG.addConstraint(picked[i - 1].first);
+  }
+
+  if (failed) {
+    ++solverState->NumMemoRejected;
+    return true;
+  }
+
+  ++solverState->NumMemoHits;
+  return false;
+}
+
+void ConstraintSystem::memoizeChoices(const Solution &solution) {
+  if (!solution.Fixes.empty())
+    return;
+
+  std::vector<MemoizedOverloadChoice> memo;
+  for (auto &entry : solution.overloadChoices) {
+    auto locator = entry.first;
+    auto &choice = entry.second.choice;
+    if (!choice.isDecl() || !locator->getAnchor())
+      continue;
+
+    auto anchorIndex = MemoAnchorIndices.find(locator->getAnchor());
+    if (anchorIndex == MemoAnchorIndices.end())
+      continue;
+
+    MemoizedOverloadChoice memoized;
+    if (encodeLocatorPath(locator, memoized.Path))
+      continue;
+    memoized.AnchorIndex = anchorIndex->second;
+    memoized.Decl = choice.getDecl();
+    memoized.Kind = unsigned(choice.getKind());
+    memo.push_back(std::move(memoized));
+  }
+
+  if (memo.empty())
+    return;
+
+  std::stable_sort(memo.begin(), memo.end(),
+                   [](const MemoizedOverloadChoice &lhs,
+                      const MemoizedOverloadChoice &rhs) {
+    return lhs.AnchorIndex < rhs.AnchorIndex;
+  });
+  TC.SolverMemo[MemoKey] = std::move(memo);
+}
@@ -1239,8 +1239,13 @@ bool ConstraintSystem::solve(SmallVectorImpl<Solution> &solutions,
   SolverState state(*this);
   this->solverState = &state;
 
-  // Solve the system.
-  solveRec(solutions, allowFreeTypeVariables);
+  // Solve the system, starting with the overload choices that solved an
+  // earlier expression of the same shape, if there was one.
+  bool solvedWithMemo = !MemoKey.empty() &&
+                        !solveWithMemoizedChoices(solutions,
+                                                  allowFreeTypeVariables);
+  if (!solvedWithMemo)
+    solveRec(solutions, allowFreeTypeVariables);
 
   // If there is more than one viable system, attempt to pick the best
   // solution.
@@ -1253,6 +1258,9 @@ bool ConstraintSystem::solve(SmallVectorImpl<Solution> &solutions,
     }
   }
 
+  if (!MemoKey.empty() && !solvedWithMemo && solutions.size() == 1)
+    memoizeChoices(solutions[0]);
+
   // Remove the solver state.
   this->solverState = nullptr;
   
@@ -1506,6 +1514,142 @@ bool ConstraintSystem::solveRec(SmallVectorImpl<Solution> &solutions,
   return !anySolutions;
 }
 
+/// Determine whether an argument of a type other than the nominal type
+/// \p nominal can never be passed for a parameter of that type.
+static bool acceptsOnlyItsOwnType(ASTContext &ctx, NominalTypeDecl *nominal) {
+  // Classes accept subclasses, and protocols accept conforming types.
+  if (!isa<StructDecl>(nominal) && !isa<EnumDecl>(nominal))
+    return false;
+
+  // Optionals and pointers accept the types that convert to them.
+  return nominal != ctx.getOptionalDecl() &&
+         nominal != ctx.getImplicitlyUnwrappedOptionalDecl() &&
+         nominal != ctx.getUnsafePointerDecl() &&
+         nominal != ctx.getUnsafeMutablePointerDecl() &&
+         nominal != ctx.getAutoreleasingUnsafeMutablePointerDecl();
+}
+
+/// Retrieve the nominal type that each argument of the operator \p decl
+/// must have, or null for an argument that may have more than one type.
+///
+/// \returns an empty array if the operator's parameters can't be indexed.
+static ArrayRef<NominalTypeDecl *>
+getOperatorArgumentShape(TypeChecker &tc, FuncDecl *decl) {
+  auto known = tc.OperatorArgumentShapes.find(decl);
+  if (known != tc.OperatorArgumentShapes.end())
+    return known->second;
+
+  auto &shape = tc.OperatorArgumentShapes[decl];
+  if (!decl->hasType())
+    return shape;
+  auto fnType = decl->getType()->getAs<AnyFunctionType>();
+  if (!fnType)
+    return shape;
+
+  SmallVector<Type, 2> paramTypes;
+  if (auto tuple = fnType->getInput()->getAs<TupleType>()) {
+    for (auto &elt : tuple->getElements()) {
+      if (elt.isVararg() || elt.hasDefaultArg())
+        return shape;
+      paramTypes.push_back(elt.getType());
+    }
+  } else {
+    paramTypes.push_back(fnType->getInput());
+  }
+
+  for (auto paramType : paramTypes) {
+    auto nominal = paramType->getInOutObjectType()->getAnyNominal();
+    if (nominal && !acceptsOnlyItsOwnType(tc.Context, nominal))
+      nominal = nullptr;
+    shape.push_back(nominal);
+  }
+  return shape;
+}
+
+/// Retrieve the first overload in \p disjunction or in a disjunction
+/// nested within it.
+static Constraint *getFirstOverload(Constraint *disjunction) {
+  for (auto term : disjunction->getNestedConstraints()) {
+    if (term->getKind() == ConstraintKind::BindOverload)
+      return term;
+    if (term->getKind() == ConstraintKind::Disjunction)
+      if (auto overload = getFirstOverload(term))
+        return overload;
+  }
+  return nullptr;
+}
+
+/// If \p disjunction is an overload set of operators, collect the types
+/// known so far of the arguments the operator is applied to.
+static void getKnownOperatorArguments(ConstraintSystem &cs,
+                                      Constraint *disjunction,
+                                      SmallVectorImpl<Type> &argTypes) {
+  auto overload = getFirstOverload(disjunction);
+  if (!overload ||
+      overload->getOverloadChoice().getKind() != OverloadChoiceKind::Decl ||
+      !overload->getOverloadChoice().getDecl()->isOperator())
+    return;
+
+  auto fnTypeVar = overload->getFirstType()->getAs<TypeVariableType>();
+  if (!fnTypeVar)
+    return;
+  fnTypeVar = cs.getRepresentative(fnTypeVar);
+
+  // Find the application of the operator.
+  SmallVector<Constraint *, 8> constraints;
+  cs.getConstraintGraph().gatherConstraints(fnTypeVar, constraints);
+  for (auto constraint : constraints) {
+    if (constraint->getKind() != ConstraintKind::ApplicableFunction)
+      continue;
+    auto appliedTypeVar =
+      constraint->getSecondType()->getAs<TypeVariableType>();
+    if (!appliedTypeVar || cs.getRepresentative(appliedTypeVar) != fnTypeVar)
+      continue;
+
+    auto fnType = constraint->getFirstType()->castTo<FunctionType>();
+    auto input = cs.simplifyType(fnType->getInput());
+    if (auto tuple = input->getAs<TupleType>()) {
+      for (auto &elt : tuple->getElements())
+        argTypes.push_back(elt.getType());
+    } else {
+      argTypes.push_back(input);
+    }
+    return;
+  }
+}
+
+/// Determine whether \p constraint binds an operator that cannot accept
+/// arguments of the types known so far.
+static bool cannotAcceptArguments(ConstraintSystem &cs,
+                                  Constraint *constraint,
+                                  ArrayRef<Type> argTypes) {
+  if (constraint->getKind() != ConstraintKind::BindOverload)
+    return false;
+
+  auto choice = constraint->getOverloadChoice();
+  if (choice.getKind() != OverloadChoiceKind::Decl)
+    return false;
+  auto func = dyn_cast<FuncDecl>(choice.getDecl());
+  if (!func || !func->isOperator())
+    return false;
+
+  auto shape = getOperatorArgumentShape(cs.getTypeChecker(), func);
+  if (shape.size() != argTypes.size())
+    return false;
+
+  for (auto i : indices(shape)) {
+    if (!shape[i])
+      continue;
+    // An implicitly unwrapped optional converts to its object type.
+    auto argType = argTypes[i]->getRValueType()->getInOutObjectType();
+    auto argNominal = argType->getAnyNominal();
+    if (argNominal && argNominal != shape[i] &&
+        argNominal != cs.getASTContext().getImplicitlyUnwrappedOptionalDecl())
+      return true;
+  }
+  return false;
+}
+
 /// Whether we should short-circuit a disjunction that already has a
 /// solution when we encounter the given constraint.
 static bool shortCircuitDisjunctionAt(Constraint *constraint,
@@ -1672,6 +1816,13 @@ bool ConstraintSystem::solveSimplified(
   auto afterDisjunction = InactiveConstraints.erase(disjunction);
   CG.removeConstraint(disjunction);
 
+  // If this is an overload set of operators, find out what is already known
+  // of the types of their arguments. When attempting fixes, every operator
+  // is kept so that the best fix can be found.
+  SmallVector<Type, 2> argTypes;
+  if (!shouldAttemptFixes() && TC.getLangOpts().OperatorOverloadPruning)
+    getKnownOperatorArguments(*this, disjunction, argTypes);
+
   // Try each of the constraints within the disjunction.
   Constraint *firstSolvedConstraint = nullptr;
   ++solverState->NumDisjunctions;
@@ -1679,6 +1830,13 @@ bool ConstraintSystem::solveSimplified(
   for (auto index : indices(constraints)) {
     auto constraint = constraints[index];
 
+    // Skip operators that cannot accept those arguments.
+    if (!argTypes.empty() &&
+        cannotAcceptArguments(*this, constraint, argTypes)) {
+      ++solverState->NumDisjunctionTermsPruned;
+      continue;
+    }
+
     // We already have a solution; check whether we should
     // short-circuit the disjunction.
     if (firstSolvedConstraint &&
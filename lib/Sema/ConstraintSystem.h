@@ -977,6 +977,16 @@ private:
   SmallVector<std::pair<ConstraintLocator *, ArchetypeType *>, 4>
     OpenedExistentialTypes;
 
+  /// The shape of the expression being solved and of its context, under
+  /// which the overload choices that solve it are memoized in the type
+  /// checker. Empty if the expression is not memoized.
+  std::string MemoKey;
+
+  /// The position of each subexpression in the walk that computed
+  /// \c MemoKey, which identifies the anchors of locators across
+  /// expressions of the same shape.
+  llvm::DenseMap<Expr *, unsigned> MemoAnchorIndices;
+
   /// \brief Describes the current solver state.
   struct SolverState {
     SolverState(ConstraintSystem &cs);
@@ -1940,7 +1950,41 @@ private:
   /// \returns true if an error occurred, false otherwise.
   bool solveSimplified(SmallVectorImpl<Solution> &solutions,
                        FreeTypeVariableBinding allowFreeTypeVariables);
+
+  /// \brief Solve the system of constraints by first trying the overload
+  /// choices memoized under \c MemoKey.
+  ///
+  /// Each memoized choice is checked against the terms of the overload set
+  /// it is now made for. If any is not among them, or the choices don't
+  /// lead to a solution, nothing is changed.
+  ///
+  /// \returns true if the memoized choices didn't produce a solution.
+  bool solveWithMemoizedChoices(SmallVectorImpl<Solution> &solutions,
+                                FreeTypeVariableBinding allowFreeTypeVariables);
+
+  /// \brief Memoize the overload choices of \p solution under \c MemoKey.
+  void memoizeChoices(const Solution &solution);
+
  public:
+  /// \brief Describe the shape of \p expr and of the context it is solved
+  /// in, so that the overload choices that solve it can be tried first for
+  /// any later expression of the same shape.
+  ///
+  /// Expressions whose solution could depend on more than their shape, such
+  /// as those containing closures, are not memoized.
+  ///
+  /// \param listenerKey Describes the constraints added for \p expr by the
+  /// listener that is type-checking it, if any.
+  void computeMemoKey(Expr *expr, Type convertType,
+                      FreeTypeVariableBinding allowFreeTypeVariables,
+                      StringRef listenerKey);
+
+  /// \brief Stop memoizing the solution of the expression.
+  void clearMemoKey() {
+    MemoKey.clear();
+    MemoAnchorIndices.clear();
+  }
+
   /// \brief Solve the system of constraints.
   ///
   /// \param solutions The set of solutions to this system of constraints.
@@ -1117,6 +1117,10 @@ Expr *ExprTypeCheckListener::appliedSolution(Solution &solution, Expr *expr) {
   return expr;
 }
 
+bool ExprTypeCheckListener::describeConstraints(raw_ostream &OS) {
+  return false;
+}
+
 bool TypeChecker::
 solveForExpression(Expr *&expr, DeclContext *dc, Type convertType,
                    FreeTypeVariableBinding allowFreeTypeVariables,
@@ -1135,6 +1139,15 @@ solveForExpression(Expr *&expr, DeclContext *dc, Type convertType,
     return true;
   }
 
+  // Solve this expression like earlier ones of the same shape, as long as
+  // the listener can describe the constraints it adds.
+  if (getLangOpts().ConstraintSolverMemoization) {
+    std::string listenerKey;
+    llvm::raw_string_ostream OS(listenerKey);
+    if (!listener || listener->describeConstraints(OS))
+      cs.computeMemoKey(expr, convertType, allowFreeTypeVariables, OS.str());
+  }
+
   // If there is a type that we're expected to convert to, add the conversion
   // constraint.
   if (convertType) {
@@ -1167,8 +1180,11 @@ solveForExpression(Expr *&expr, DeclContext *dc, Type convertType,
     cs.print(log);
   }
 
-  // Attempt to solve the constraint system.
-  if (cs.solve(viable, allowFreeTypeVariables) ||
+  // Attempt to solve the constraint system. If it has to be salvaged, the
+  // solutions it finds then aren't the ones for this shape.
+  bool failed = cs.solve(viable, allowFreeTypeVariables);
+  cs.clearMemoKey();
+  if (failed ||
       (viable.size() != 1 &&
        !options.contains(TypeCheckExprFlags::AllowUnresolvedTypeVariables))) {
     if (options.contains(TypeCheckExprFlags::SuppressDiagnostics))
@@ -1624,6 +1640,30 @@ bool TypeChecker::typeCheckBinding(Pattern *&pattern, Expr *&initializer,
       initializer = expr;
       return expr;
     }
+
+    virtual bool describeConstraints(raw_ostream &OS) {
+      Pattern *inner = pattern;
+      while (true) {
+        if (auto paren = dyn_cast<ParenPattern>(inner))
+          inner = paren->getSubPattern();
+        else if (auto var = dyn_cast<VarPattern>(inner))
+          inner = var->getSubPattern();
+        else
+          break;
+      }
+
+      // A typed pattern constrains the initializer to its type, and a single
+      // untyped variable to a new type variable.
+      if (auto typed = dyn_cast<TypedPattern>(inner)) {
+        OS << static_cast<const void *>(typed->getType().getPointer());
+        return true;
+      }
+      if (isa<NamedPattern>(inner) || isa<AnyPattern>(inner)) {
+        OS << unsigned(inner->getKind());
+        return true;
+      }
+      return false;
+    }
   };
 
   assert(initializer && "type-checking an uninitialized binding?");
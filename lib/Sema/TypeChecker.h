@@ -30,6 +30,7 @@
 #include "swift/Basic/OptionSet.h"
 #include "swift/Config.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringMap.h"
 #include <functional>
 
 namespace swift {
@@ -297,6 +298,14 @@ public:
   /// failure.
   virtual Expr *appliedSolution(constraints::Solution &solution,
                                 Expr *expr);
+
+  /// Describes the constraints that builtConstraints adds, so that the
+  /// overload choices that solve the expression can be memoized along with
+  /// its shape.
+  ///
+  /// \returns false if the constraints can't be described, in which case
+  /// the expression is solved from scratch.
+  virtual bool describeConstraints(raw_ostream &OS);
 };
 
 /// Flags that describe the context of type checking a pattern or
@@ -499,6 +508,33 @@ public:
   /// computed.
   llvm::DenseMap<AnyFunctionRef, std::vector<Expr*>> LocalCFunctionPointers;
 
+  /// For each operator the constraint solver has considered, the nominal
+  /// type that each of its arguments must have, or null where an argument
+  /// of more than one type may be passed.
+  llvm::DenseMap<FuncDecl *, SmallVector<NominalTypeDecl *, 2>>
+    OperatorArgumentShapes;
+
+  /// An overload choice that was part of the solution of an expression.
+  struct MemoizedOverloadChoice {
+    /// The position of the overload set's anchor in the walk that computed
+    /// the expression's memoization key.
+    unsigned AnchorIndex;
+
+    /// The path of the overload set's locator, with each element's kind
+    /// followed by its values.
+    SmallVector<unsigned, 4> Path;
+
+    /// The declaration that was chosen, and how.
+    ValueDecl *Decl;
+    unsigned Kind;
+  };
+
+  /// The overload choices that solved earlier expressions, keyed by the
+  /// shape of the expression and its context, and ordered by anchor.
+  ///
+  /// \see constraints::ConstraintSystem::computeMemoKey
+  llvm::StringMap<std::vector<MemoizedOverloadChoice>> SolverMemo;
+
 private:
   Type IntLiteralType;
   Type FloatLiteralType;
@@ -19,11 +19,20 @@
 #include "swift/ClangImporter/ClangImporter.h"
 #include "swift/Parse/Parser.h"
 #include "swift/Serialization/BCReadingExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace swift;
 using namespace swift::serialization;
 
+#define DEBUG_TYPE "Serialization"
+
+STATISTIC(NumDeclsLoaded, "# of decls deserialized");
+STATISTIC(NumMemberListsLoaded,
+          "# of nominals/extensions whose members were loaded");
+STATISTIC(NumNamedMembersLoaded,
+          "# of members loaded by name without loading their siblings");
+
 namespace {
   struct IDAndKind {
     const Decl *D;
@@ -1791,6 +1800,7 @@ Decl *ModuleFile::getDecl(DeclID DID, Optional<DeclContext *> ForcedContext) {
   if (declOrOffset.isComplete())
     return declOrOffset;
 
+  ++NumDeclsLoaded;
   BCOffsetRAII restoreOffset(DeclTypeCursor);
   DeclTypeCursor.JumpToBit(declOrOffset);
   auto entry = DeclTypeCursor.advance();
@@ -2275,6 +2285,7 @@ Decl *ModuleFile::getDecl(DeclID DID, Optional<DeclContext *> ForcedContext) {
     handleInherited(theStruct, rawInheritedIDs);
 
     theStruct->setMemberLoader(this, DeclTypeCursor.GetCurrentBitNo());
+    LazyMemberContextIDs[theStruct] = DID;
     skipRecord(DeclTypeCursor, decls_block::MEMBERS);
     theStruct->setConformanceLoader(
       this,
@@ -2727,6 +2738,7 @@ Decl *ModuleFile::getDecl(DeclID DID, Optional<DeclContext *> ForcedContext) {
     proto->computeType();
 
     proto->setMemberLoader(this, DeclTypeCursor.GetCurrentBitNo());
+    LazyMemberContextIDs[proto] = DID;
     proto->setCircularityCheck(CircularityCheck::Checked);
     break;
   }
@@ -2863,6 +2875,7 @@ Decl *ModuleFile::getDecl(DeclID DID, Optional<DeclContext *> ForcedContext) {
     handleInherited(theClass, rawInheritedIDs);
 
     theClass->setMemberLoader(this, DeclTypeCursor.GetCurrentBitNo());
+    LazyMemberContextIDs[theClass] = DID;
     theClass->setHasDestructor();
     skipRecord(DeclTypeCursor, decls_block::MEMBERS);
     theClass->setConformanceLoader(
@@ -2930,6 +2943,7 @@ Decl *ModuleFile::getDecl(DeclID DID, Optional<DeclContext *> ForcedContext) {
     handleInherited(theEnum, rawInheritedIDs);
 
     theEnum->setMemberLoader(this, DeclTypeCursor.GetCurrentBitNo());
+    LazyMemberContextIDs[theEnum] = DID;
     skipRecord(DeclTypeCursor, decls_block::MEMBERS);
     theEnum->setConformanceLoader(
       this,
@@ -3125,6 +3139,7 @@ Decl *ModuleFile::getDecl(DeclID DID, Optional<DeclContext *> ForcedContext) {
     }
 
     extension->setMemberLoader(this, DeclTypeCursor.GetCurrentBitNo());
+    LazyMemberContextIDs[extension] = DID;
     skipRecord(DeclTypeCursor, decls_block::MEMBERS);
     extension->setConformanceLoader(
       this,
@@ -4025,6 +4040,7 @@ Type ModuleFile::getType(TypeID TID) {
 
 void ModuleFile::loadAllMembers(Decl *D, uint64_t contextData) {
   PrettyStackTraceDecl trace("loading members for", D);
+  ++NumMemberListsLoaded;
 
   BCOffsetRAII restoreOffset(DeclTypeCursor);
   DeclTypeCursor.JumpToBit(contextData);
@@ -4043,6 +4059,29 @@ void ModuleFile::loadAllMembers(Decl *D, uint64_t contextData) {
     IDC->addMember(member);
 }
 
+bool ModuleFile::loadNamedMembers(const Decl *D, Identifier N,
+                                  uint64_t contextData,
+                                  SmallVectorImpl<ValueDecl *> &members) {
+  if (!DeclMemberNames)
+    return false;
+
+  auto contextID = LazyMemberContextIDs.lookup(D);
+  if (!contextID)
+    return false;
+
+  PrettyStackTraceDecl trace("loading members by name for", D);
+
+  auto iter = DeclMemberNames->find({contextID, N.str()});
+  if (iter == DeclMemberNames->end())
+    return true;
+
+  for (DeclID memberID : *iter) {
+    members.push_back(cast<ValueDecl>(getDecl(memberID)));
+    ++NumNamedMembersLoaded;
+  }
+  return true;
+}
+
 void
 ModuleFile::loadAllConformances(const Decl *D, uint64_t contextData,
                           SmallVectorImpl<ProtocolConformance*> &conformances) {
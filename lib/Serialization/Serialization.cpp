@@ -146,6 +146,47 @@ namespace {
   using LocalTypeHashTableGenerator =
     llvm::OnDiskChainedHashTableGenerator<LocalDeclTableInfo>;
 
+  /// Used to serialize the on-disk member name hash table.
+  class DeclMemberNamesTableInfo {
+  public:
+    using key_type = Serializer::DeclMemberNamesKey;
+    using key_type_ref = const key_type &;
+    using data_type = SmallVector<DeclID, 2>;
+    using data_type_ref = const data_type &;
+    using hash_value_type = uint32_t;
+    using offset_type = unsigned;
+
+    hash_value_type ComputeHash(key_type_ref key) {
+      assert(!key.second.empty());
+      return llvm::HashString(key.second.str(), key.first);
+    }
+
+    std::pair<unsigned, unsigned> EmitKeyDataLength(raw_ostream &out,
+                                                    key_type_ref key,
+                                                    data_type_ref data) {
+      uint32_t keyLength = sizeof(uint32_t) + key.second.str().size();
+      uint32_t dataLength = sizeof(uint32_t) * data.size();
+      endian::Writer<little> writer(out);
+      writer.write<uint16_t>(keyLength);
+      writer.write<uint16_t>(dataLength);
+      return { keyLength, dataLength };
+    }
+
+    void EmitKey(raw_ostream &out, key_type_ref key, unsigned len) {
+      endian::Writer<little> writer(out);
+      writer.write<uint32_t>(key.first);
+      out << key.second.str();
+    }
+
+    void EmitData(raw_ostream &out, key_type_ref key, data_type_ref data,
+                  unsigned len) {
+      static_assert(declIDFitsIn32Bits(), "DeclID too large");
+      endian::Writer<little> writer(out);
+      for (auto memberID : data)
+        writer.write<uint32_t>(memberID);
+    }
+  };
+
 } // end anonymous namespace
 
 namespace llvm {
@@ -470,6 +511,7 @@ void Serializer::writeBlockInfoBlock() {
   BLOCK_RECORD(index_block, DECL_CONTEXT_OFFSETS);
   BLOCK_RECORD(index_block, LOCAL_TYPE_DECLS);
   BLOCK_RECORD(index_block, NORMAL_CONFORMANCE_OFFSETS);
+  BLOCK_RECORD(index_block, DECL_MEMBER_NAMES);
 
   BLOCK(SIL_BLOCK);
   BLOCK_RECORD(sil_block, SIL_FUNCTION);
@@ -1261,7 +1303,8 @@ static bool shouldSerializeMember(Decl *D) {
   }
 }
 
-void Serializer::writeMembers(DeclRange members, bool isClass) {
+void Serializer::writeMembers(DeclID parentID, DeclRange members,
+                              bool isClass) {
   using namespace decls_block;
 
   unsigned abbrCode = DeclTypeAbbrCodes[MembersLayout::Code];
@@ -1273,6 +1316,13 @@ void Serializer::writeMembers(DeclRange members, bool isClass) {
     DeclID memberID = addDeclRef(member);
     memberIDs.push_back(memberID);
 
+    if (auto VD = dyn_cast<ValueDecl>(member)) {
+      if (VD->hasName()) {
+        auto &list = DeclMemberNames[{parentID, VD->getName()}];
+        list.push_back(memberID);
+      }
+    }
+
     if (isClass) {
       if (auto VD = dyn_cast<ValueDecl>(member)) {
         if (VD->canBeAccessedByDynamicLookup()) {
@@ -2074,7 +2124,8 @@ void Serializer::writeDecl(const Decl *D) {
 
     writeGenericParams(extension->getGenericParams(), DeclTypeAbbrCodes);
     writeRequirements(extension->getGenericRequirements());
-    writeMembers(extension->getMembers(), isClassExtension);
+    writeMembers(addDeclRef(extension), extension->getMembers(),
+                 isClassExtension);
     writeConformances(conformances, DeclTypeAbbrCodes);
 
     break;
@@ -2252,7 +2303,7 @@ void Serializer::writeDecl(const Decl *D) {
 
     writeGenericParams(theStruct->getGenericParams(), DeclTypeAbbrCodes);
     writeRequirements(theStruct->getGenericRequirements());
-    writeMembers(theStruct->getMembers(), false);
+    writeMembers(addDeclRef(theStruct), theStruct->getMembers(), false);
     writeConformances(conformances, DeclTypeAbbrCodes);
     break;
   }
@@ -2286,7 +2337,7 @@ void Serializer::writeDecl(const Decl *D) {
 
     writeGenericParams(theEnum->getGenericParams(), DeclTypeAbbrCodes);
     writeRequirements(theEnum->getGenericRequirements());
-    writeMembers(theEnum->getMembers(), false);
+    writeMembers(addDeclRef(theEnum), theEnum->getMembers(), false);
     writeConformances(conformances, DeclTypeAbbrCodes);
     break;
   }
@@ -2323,7 +2374,7 @@ void Serializer::writeDecl(const Decl *D) {
 
     writeGenericParams(theClass->getGenericParams(), DeclTypeAbbrCodes);
     writeRequirements(theClass->getGenericRequirements());
-    writeMembers(theClass->getMembers(), true);
+    writeMembers(addDeclRef(theClass), theClass->getMembers(), true);
     writeConformances(conformances, DeclTypeAbbrCodes);
     break;
   }
@@ -2359,7 +2410,7 @@ void Serializer::writeDecl(const Decl *D) {
 
     writeGenericParams(proto->getGenericParams(), DeclTypeAbbrCodes);
     writeRequirements(proto->getGenericRequirements());
-    writeMembers(proto->getMembers(), true);
+    writeMembers(addDeclRef(proto), proto->getMembers(), true);
     break;
   }
 
@@ -3413,6 +3464,29 @@ static void writeLocalDeclTable(const index_block::DeclListLayout &DeclList,
   DeclList.emit(scratch, kind, tableOffset, hashTableBlob);
 }
 
+static void
+writeDeclMemberNamesTable(const index_block::DeclMemberNamesLayout &out,
+                          const Serializer::DeclMemberNamesTable &table) {
+  if (table.empty())
+    return;
+
+  SmallVector<uint64_t, 8> scratch;
+  llvm::SmallString<4096> hashTableBlob;
+  uint32_t tableOffset;
+  {
+    llvm::OnDiskChainedHashTableGenerator<DeclMemberNamesTableInfo> generator;
+    for (auto &entry : table)
+      generator.insert(entry.first, entry.second);
+
+    llvm::raw_svector_ostream blobStream(hashTableBlob);
+    // Make sure that no bucket is at offset 0
+    endian::Writer<little>(blobStream).write<uint32_t>(0);
+    tableOffset = generator.Emit(blobStream);
+  }
+
+  out.emit(scratch, tableOffset, hashTableBlob);
+}
+
 namespace {
 
 struct DeclCommentTableData {
@@ -3980,6 +4054,9 @@ void Serializer::writeAST(ModuleOrSourceFile DC) {
     index_block::ObjCMethodTableLayout ObjCMethodTable(Out);
     writeObjCMethodTable(ObjCMethodTable, objcMethods);
 
+    index_block::DeclMemberNamesLayout DeclMemberNamesTable(Out);
+    writeDeclMemberNamesTable(DeclMemberNamesTable, DeclMemberNames);
+
     if (entryPointClassID.hasValue()) {
       index_block::EntryPointLayout EntryPoint(Out);
       EntryPoint.emit(ScratchRecord, entryPointClassID.getValue());
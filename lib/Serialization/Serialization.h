@@ -117,6 +117,14 @@ public:
   /// with.
   const Decl *getGenericContext(const GenericParamList *paramList);
 
+  /// A nominal type or extension, and the base name of some of its members.
+  using DeclMemberNamesKey = std::pair<unsigned, Identifier>;
+
+  /// The in-memory representation of what will eventually be an on-disk hash
+  /// table of the members of each nominal type and extension, by base name.
+  using DeclMemberNamesTable =
+      llvm::MapVector<DeclMemberNamesKey, SmallVector<DeclID, 2>>;
+
   using ObjCMethodTableData = SmallVector<std::tuple<TypeID, bool, DeclID>, 4>;
 
   // In-memory representation of what will eventually be an on-disk
@@ -129,6 +137,10 @@ private:
   /// This is used for id-style lookup.
   DeclTable ClassMembersByName;
 
+  /// A map from each nominal type or extension and a base name to the
+  /// members of the context with that name.
+  DeclMemberNamesTable DeclMemberNames;
+
   /// The queue of types and decls that need to be serialized.
   ///
   /// This is a queue and not simply a vector because serializing one
@@ -254,10 +266,11 @@ private:
 
   /// Writes an array of members for a decl context.
   ///
+  /// \param parentID The ID of the nominal type or extension
   /// \param members The decls within the context
   /// \param isClass True if the context could be a class context (class,
   ///        class extension, or protocol).
-  void writeMembers(DeclRange members, bool isClass);
+  void writeMembers(DeclID parentID, DeclRange members, bool isClass);
 
   /// Check if a decl is cross-referenced.
   bool isDeclXRef(const Decl *D) const;
@@ -18,6 +18,7 @@
 #include "swift/Basic/STLExtras.h"
 #include "swift/Basic/SourceManager.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Debug.h"
@@ -25,10 +26,40 @@
 
 using namespace swift;
 
+#define DEBUG_TYPE "Serialization"
+
+STATISTIC(NumModuleFileBytesMapped,
+          "# of bytes of module and documentation files mapped into memory");
+STATISTIC(NumModuleFileBytesRead,
+          "# of bytes of module and documentation files read into memory");
+
 namespace {
 typedef std::pair<Identifier, SourceLoc> AccessPathElem;
 } // end unnamed namespace
 
+/// Opens a module or module documentation file.
+///
+/// Module files are only ever read through a bitstream cursor, which doesn't
+/// need a null terminator. Files above mmap's size threshold were already
+/// mapped, except when their size is an exact multiple of the page size: then
+/// the mapping can't provide the terminator, and the file used to be read into
+/// a private copy instead. Not asking for a terminator lets those files be
+/// mapped, too.
+static llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+openModuleFile(StringRef Path) {
+  auto BufferOrErr = llvm::MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                                 /*RequiresNullTerminator=*/
+                                                   false);
+  if (BufferOrErr) {
+    const llvm::MemoryBuffer &Buffer = *BufferOrErr.get();
+    if (Buffer.getBufferKind() == llvm::MemoryBuffer::MemoryBuffer_MMap)
+      NumModuleFileBytesMapped += Buffer.getBufferSize();
+    else
+      NumModuleFileBytesRead += Buffer.getBufferSize();
+  }
+  return BufferOrErr;
+}
+
 // Defined out-of-line so that we can see ~ModuleFile.
 SerializedModuleLoader::SerializedModuleLoader(ASTContext &ctx,
                                                DependencyTracker *tracker)
@@ -46,7 +77,7 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    openModuleFile(StringRef(Scratch.data(), Scratch.size()));
   if (!ModuleOrErr)
     return ModuleOrErr.getError();
 
@@ -55,7 +86,7 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleDocFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleDocOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    openModuleFile(StringRef(Scratch.data(), Scratch.size()));
   if (!ModuleDocOrErr &&
       ModuleDocOrErr.getError() != std::errc::no_such_file_or_directory) {
     return ModuleDocOrErr.getError();
@@ -274,8 +274,10 @@ class WeakRefCount {
   uint32_t refCount;
 
   enum : uint32_t {
-    // There isn't really a flag here.
-    RC_UNUSED_FLAG = 1,
+    // Set once a weak reference side table entry has been created for the
+    // object. Only used when the runtime is built with
+    // SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE.
+    RC_SIDE_TABLE_FLAG = 1,
 
     RC_FLAGS_COUNT = 1,
     RC_FLAGS_MASK = 1,
@@ -352,6 +354,16 @@ class WeakRefCount {
   uint32_t getCount() const {
     return __atomic_load_n(&refCount, __ATOMIC_RELAXED) >> RC_FLAGS_COUNT;
   }
+
+  // Mark the object as having a weak reference side table entry.
+  void setHasSideTable() {
+    __atomic_fetch_or(&refCount, RC_SIDE_TABLE_FLAG, __ATOMIC_RELAXED);
+  }
+
+  // Return true if the object has a weak reference side table entry.
+  bool hasSideTable() const {
+    return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_SIDE_TABLE_FLAG;
+  }
 };
 
 static_assert(swift::IsTriviallyConstructible<StrongRefCount>::value,
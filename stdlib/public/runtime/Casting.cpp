@@ -18,11 +18,12 @@
 #include "swift/Basic/Demangle.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Config.h"
 #include "swift/Runtime/Enum.h"
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
-#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "swift/Runtime/Debug.h"
 #include "ErrorObject.h"
@@ -31,7 +32,9 @@
 #include "../SwiftShims/RuntimeShims.h"
 #include "stddef.h"
 
+#include <atomic>
 #include <cstring>
+#include <functional>
 #include <mutex>
 #include <type_traits>
 
@@ -340,48 +343,65 @@ std::string swift::nameForMetadata(const Metadata *type,
   return result;
 }
 
+namespace {
+  /// An entry in the type name cache. The NUL-terminated name is stored as
+  /// trailing storage, so the pointer handed out by swift_getTypeName stays
+  /// valid for the lifetime of the process.
+  struct TypeNameCacheEntry {
+    using Key = llvm::PointerIntPair<const Metadata *, 1, bool>;
+
+    Key TypeAndQualified;
+    size_t Length;
+
+    TypeNameCacheEntry(Key key, const std::string &name)
+      : TypeAndQualified(key), Length(name.size()) {
+      memcpy(getNameBuffer(), name.data(), Length);
+      getNameBuffer()[Length] = 0;
+    }
+
+    char *getNameBuffer() { return reinterpret_cast<char *>(this + 1); }
+
+    long getKeyIntValueForDump() const {
+      return reinterpret_cast<long>(TypeAndQualified.getOpaqueValue());
+    }
+
+    int compareWithKey(Key key) const {
+      auto a = reinterpret_cast<uintptr_t>(key.getOpaqueValue());
+      auto b = reinterpret_cast<uintptr_t>(TypeAndQualified.getOpaqueValue());
+      return a == b ? 0 : (a < b ? -1 : 1);
+    }
+
+    static size_t getKeyHash(Key key) {
+      auto value = reinterpret_cast<uintptr_t>(key.getOpaqueValue());
+      return llvm::hash_value(value);
+    }
+
+    static size_t getExtraAllocationSize(Key key, const std::string &name) {
+      return name.size() + 1;
+    }
+  };
+}
+
+static Lazy<ConcurrentMap<TypeNameCacheEntry>> TypeNameCache;
+
 SWIFT_RUNTIME_EXPORT
 extern "C"
 TwoWordPair<const char *, uintptr_t>::Return
 swift_getTypeName(const Metadata *type, bool qualified) {
   using Pair = TwoWordPair<const char *, uintptr_t>;
-  using Key = llvm::PointerIntPair<const Metadata *, 1, bool>;
-  
-  static pthread_rwlock_t TypeNameCacheLock = PTHREAD_RWLOCK_INITIALIZER;
-  static Lazy<llvm::DenseMap<Key, std::pair<const char *, size_t>>>
-    TypeNameCache;
-  
-  Key key(type, qualified);
+  TypeNameCacheEntry::Key key(type, qualified);
   auto &cache = TypeNameCache.get();
-  
-  pthread_rwlock_rdlock(&TypeNameCacheLock);
-  auto found = cache.find(key);
-  if (found != cache.end()) {
-    auto result = found->second;
-    pthread_rwlock_unlock(&TypeNameCacheLock);
-    return Pair{result.first, result.second};
-  }
-  
-  pthread_rwlock_unlock(&TypeNameCacheLock);
-  pthread_rwlock_wrlock(&TypeNameCacheLock);
-  // Someone may have beaten us to the write lock.
-  found = cache.find(key);
-  if (found != cache.end()) {
-    auto result = found->second;
-    pthread_rwlock_unlock(&TypeNameCacheLock);
-    return Pair{result.first, result.second};
-  }
-  
-  // Build the metadata name.
+
+  // Lookups don't take any locks.
+  if (auto found = cache.find(key))
+    return Pair{found->getNameBuffer(), found->Length};
+
+  // Build the name outside of the map's lock. If another thread inserts the
+  // same key first, our copy is discarded and everyone gets the same
+  // pointer.
   auto name = nameForMetadata(type, qualified);
-  // Copy it to memory we can reference forever.
-  auto size = name.size();
-  auto result = (char*)malloc(size + 1);
-  memcpy(result, name.data(), size);
-  result[size] = 0;
-  cache.insert({key, {result, size}});
-  pthread_rwlock_unlock(&TypeNameCacheLock);
-  return Pair{result, size};
+  auto entry = cache.getOrInsert(key, name).first;
+  return Pair{entry->getNameBuffer(), entry->Length};
 }
 
 /// Report a dynamic cast failure.
@@ -2043,6 +2063,204 @@ checkDynamicCastFromOptional(OpaqueValue *dest,
   return {false, payloadType};
 }
 
+namespace {
+  /// A remembered outcome of casting a value of one concrete type to
+  /// another type. Only casts whose outcome depends on the types alone are
+  /// recorded; see isDynamicCastCacheable.
+  ///
+  /// Successful casts are only recorded for opaque existential targets, in
+  /// which case the witness tables that were found are stored as trailing
+  /// storage. Other successful casts are cheap to redo and aren't recorded.
+  ///
+  /// A failed cast may succeed once more conformances are registered, e.g.
+  /// by a library loaded with dlopen. So a failure is only replayed while the
+  /// number of registered conformance sections is the one it was last checked
+  /// against. Failures to opaque existentials reserve room for the witness
+  /// tables, so that the entry can become a success if the cast later does.
+  struct DynamicCastCacheEntry {
+    struct Key {
+      const Metadata *SourceType;
+      const Metadata *TargetType;
+    };
+
+    enum State : uint8_t {
+      Fails,
+      /// A thread is storing the witness tables of a cast that now succeeds.
+      BecomingSuccessful,
+      Succeeds,
+    };
+
+    Key Types;
+    std::atomic<uint8_t> CastState;
+    unsigned NumWitnessTables;
+    std::atomic<unsigned> FailureGeneration;
+
+    DynamicCastCacheEntry(Key key, bool succeeds,
+                          const WitnessTable * const *witnessTables,
+                          unsigned numWitnessTables,
+                          unsigned failureGeneration)
+      : Types(key), CastState(succeeds ? Succeeds : Fails),
+        NumWitnessTables(numWitnessTables),
+        FailureGeneration(failureGeneration) {
+      if (witnessTables)
+        memcpy(getWitnessTables(), witnessTables,
+               numWitnessTables * sizeof(const WitnessTable *));
+    }
+
+    const WitnessTable **getWitnessTables() {
+      return reinterpret_cast<const WitnessTable **>(this + 1);
+    }
+
+    bool succeeds() const {
+      return CastState.load(std::memory_order_acquire) == Succeeds;
+    }
+
+    /// Turn a failure into a success with the given witness tables, unless
+    /// another thread is already doing so.
+    void makeSuccessful(const WitnessTable * const *witnessTables) {
+      uint8_t expected = Fails;
+      if (!CastState.compare_exchange_strong(expected, BecomingSuccessful,
+                                             std::memory_order_acquire))
+        return;
+      memcpy(getWitnessTables(), witnessTables,
+             NumWitnessTables * sizeof(const WitnessTable *));
+      CastState.store(Succeeds, std::memory_order_release);
+    }
+
+    long getKeyIntValueForDump() const {
+      return reinterpret_cast<long>(Types.SourceType);
+    }
+
+    int compareWithKey(Key key) const {
+      if (key.SourceType != Types.SourceType)
+        return std::less<const Metadata *>()(key.SourceType, Types.SourceType)
+                 ? -1 : 1;
+      if (key.TargetType != Types.TargetType)
+        return std::less<const Metadata *>()(key.TargetType, Types.TargetType)
+                 ? -1 : 1;
+      return 0;
+    }
+
+    static size_t getKeyHash(Key key) {
+      return llvm::hash_combine(key.SourceType, key.TargetType);
+    }
+
+    static size_t getExtraAllocationSize(Key key, bool succeeds,
+                                         const WitnessTable * const *tables,
+                                         unsigned numWitnessTables,
+                                         unsigned failureGeneration) {
+      return numWitnessTables * sizeof(const WitnessTable *);
+    }
+  };
+}
+
+static Lazy<ConcurrentMap<DynamicCastCacheEntry>> DynamicCastCache;
+
+/// Can the outcome of casting a value of type srcType to targetType be
+/// remembered? That's the case when the source is a concrete value type:
+/// the cast then depends on conformances and type identity alone, never on
+/// the value. Casts involving classes or existential sources look at the
+/// dynamic type of the value, so they aren't cached; casting an existential
+/// recurses with the dynamic type, which can hit the cache.
+///
+/// The cast flags don't participate. They only decide what happens to the
+/// source value and whether failure traps, which is applied again whenever
+/// a cached outcome is replayed.
+static bool isDynamicCastCacheable(const Metadata *srcType,
+                                   const Metadata *targetType) {
+  switch (srcType->getKind()) {
+  case MetadataKind::Struct:
+  case MetadataKind::Enum:
+  case MetadataKind::Tuple:
+    break;
+  default:
+    return false;
+  }
+
+#if SWIFT_OBJC_INTEROP
+  // Bridging a value to Objective-C produces an object whose class may
+  // depend on the value, so only cache targets that can't involve bridging.
+  switch (targetType->getKind()) {
+  case MetadataKind::Struct:
+  case MetadataKind::Enum:
+  case MetadataKind::Tuple:
+    return true;
+  case MetadataKind::Existential:
+    return cast<ExistentialTypeMetadata>(targetType)->getRepresentation()
+             != ExistentialTypeRepresentation::Class;
+  default:
+    return false;
+  }
+#else
+  return true;
+#endif
+}
+
+/// \returns \p targetType if it is an opaque existential, the only kind of
+/// target whose successful casts are recorded.
+static const ExistentialTypeMetadata *
+getRecordableExistential(const Metadata *targetType) {
+  auto existentialType = dyn_cast<ExistentialTypeMetadata>(targetType);
+  if (!existentialType ||
+      existentialType->getRepresentation()
+        != ExistentialTypeRepresentation::Opaque)
+    return nullptr;
+  return existentialType;
+}
+
+/// Remember the outcome of a cast that isDynamicCastCacheable accepted.
+/// \p generation is the number of conformance sections read before the cast.
+static void recordDynamicCast(OpaqueValue *dest, const Metadata *srcType,
+                              const Metadata *targetType, bool succeeded,
+                              unsigned generation) {
+  DynamicCastCacheEntry::Key key{srcType, targetType};
+  auto existentialType = getRecordableExistential(targetType);
+  unsigned numWitnessTables =
+    existentialType ? existentialType->Flags.getNumWitnessTables() : 0;
+
+  if (!succeeded) {
+    DynamicCastCache.get().getOrInsert(key, false, nullptr, numWitnessTables,
+                                       generation);
+    return;
+  }
+
+  if (!existentialType)
+    return;
+
+  auto destExistential = reinterpret_cast<OpaqueExistentialContainer*>(dest);
+  DynamicCastCache.get().getOrInsert(key, true,
+                                     destExistential->getWitnessTables(),
+                                     numWitnessTables, 0u);
+}
+
+/// Replay a cached cast outcome.
+static bool replayDynamicCast(DynamicCastCacheEntry *entry,
+                              OpaqueValue *dest, OpaqueValue *src,
+                              const Metadata *srcType,
+                              const Metadata *targetType,
+                              DynamicCastFlags flags) {
+  if (!entry->succeeds())
+    return _fail(src, srcType, targetType, flags);
+
+  // This is the opaque existential case of _dynamicCastToExistential with
+  // the conformance checks already done.
+  auto destExistential = reinterpret_cast<OpaqueExistentialContainer*>(dest);
+  memcpy(destExistential->getWitnessTables(), entry->getWitnessTables(),
+         entry->NumWitnessTables * sizeof(const WitnessTable *));
+  destExistential->Type = srcType;
+  if (flags & DynamicCastFlags::TakeOnSuccess)
+    srcType->vw_initializeBufferWithTake(&destExistential->Buffer, src);
+  else
+    srcType->vw_initializeBufferWithCopy(&destExistential->Buffer, src);
+  return true;
+}
+
+static bool _dynamicCastUncached(OpaqueValue *dest,
+                                 OpaqueValue *src,
+                                 const Metadata *srcType,
+                                 const Metadata *targetType,
+                                 DynamicCastFlags flags);
+
 /// Perform a dynamic cast to an arbitrary type.
 bool swift::swift_dynamicCast(OpaqueValue *dest,
                               OpaqueValue *src,
@@ -2055,6 +2273,45 @@ bool swift::swift_dynamicCast(OpaqueValue *dest,
   if (!srcType)
     return unwrapResult.success;
 
+  if (!isDynamicCastCacheable(srcType, targetType))
+    return _dynamicCastUncached(dest, src, srcType, targetType, flags);
+
+  // Read the number of sections before casting, so that a failure which
+  // raced with newly registered conformances is conservatively stale.
+  unsigned generation = _getConformanceSectionCount();
+
+  DynamicCastCacheEntry::Key key{srcType, targetType};
+  if (auto entry = DynamicCastCache.get().find(key)) {
+    if (entry->succeeds() ||
+        entry->FailureGeneration.load(std::memory_order_relaxed) == generation)
+      return replayDynamicCast(entry, dest, src, srcType, targetType, flags);
+
+    // Conformances have been registered since the cast failed. If it fails
+    // again, it can be replayed until more are registered. If it succeeds
+    // now, the entry becomes a success where successes are recorded.
+    bool result = _dynamicCastUncached(dest, src, srcType, targetType, flags);
+    if (!result) {
+      entry->FailureGeneration.store(generation, std::memory_order_relaxed);
+    } else if (getRecordableExistential(targetType)) {
+      auto destExistential =
+        reinterpret_cast<OpaqueExistentialContainer*>(dest);
+      entry->makeSuccessful(destExistential->getWitnessTables());
+    }
+    return result;
+  }
+
+  bool result = _dynamicCastUncached(dest, src, srcType, targetType, flags);
+  recordDynamicCast(dest, srcType, targetType, result, generation);
+  return result;
+}
+
+/// Perform a dynamic cast to an arbitrary type, once any Optional source
+/// has been unwrapped.
+static bool _dynamicCastUncached(OpaqueValue *dest,
+                                 OpaqueValue *src,
+                                 const Metadata *srcType,
+                                 const Metadata *targetType,
+                                 DynamicCastFlags flags) {
   switch (targetType->getKind()) {
   // Handle wrapping an Optional target.
   case MetadataKind::Optional: {
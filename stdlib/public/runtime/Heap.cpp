@@ -19,16 +19,172 @@
 #include "Private.h"
 #include "swift/Runtime/Debug.h"
 #include <stdlib.h>
+#if SWIFT_RUNTIME_ENABLE_SIZE_CLASS_ALLOCATOR
+#include <pthread.h>
+#endif
 
 using namespace swift;
 
-void *swift::swift_slowAlloc(size_t size, size_t alignMask) {
-  // FIXME: use posix_memalign if alignMask is larger than the system guarantee.
-  void *p = malloc(size);
+/// The alignment that malloc guarantees on every platform we support.
+static const size_t MallocAlignMask = 2 * sizeof(void*) - 1;
+
+/// Allocate directly from the system allocator, honoring \p alignMask.
+static void *mallocAligned(size_t size, size_t alignMask) {
+  void *p;
+  if (alignMask <= MallocAlignMask) {
+    p = malloc(size);
+  } else {
+    size_t alignment = alignMask + 1;
+    if (alignment < sizeof(void*))
+      alignment = sizeof(void*);
+    if (posix_memalign(&p, alignment, size) != 0)
+      p = nullptr;
+  }
   if (!p) swift::crash("Could not allocate memory.");
   return p;
 }
 
+#if SWIFT_RUNTIME_ENABLE_SIZE_CLASS_ALLOCATOR
+
+// A thread-caching front end for small allocations.
+//
+// Small blocks are rounded up to a multiple of SizeClassGranule bytes and
+// still come from malloc, so any block can always be handed back to free()
+// and malloc_size() keeps working on it. Freed blocks are pushed onto a
+// per-thread, per-size-class free list and reused by the next allocation of
+// that class on the same thread without going through malloc at all. Each
+// list is bounded, so memory freed on a different thread than it was
+// allocated on can't pile up; overflow goes straight back to free().
+//
+// The size class on deallocation is computed from the size that the caller
+// passes in. That size may be smaller than the allocated size (for example,
+// a class instance with tail-allocated elements is freed with its instance
+// size), which only means the block lands in a smaller class than it could
+// have; it must never be larger. Blocks passed to swift_slowDealloc must
+// have come from swift_slowAlloc.
+
+namespace {
+
+enum : size_t {
+  SizeClassGranule = 16,
+  NumSizeClasses = 16,
+  MaxSizeClassSize = SizeClassGranule * NumSizeClasses,
+  MaxCachedBlocksPerClass = 256,
+};
+
+struct ThreadAllocCache {
+  struct FreeBlock {
+    FreeBlock *Next;
+  };
+
+  FreeBlock *FreeLists[NumSizeClasses];
+  unsigned FreeCounts[NumSizeClasses];
+
+  void *pop(size_t sizeClass) {
+    FreeBlock *block = FreeLists[sizeClass];
+    if (!block)
+      return nullptr;
+    FreeLists[sizeClass] = block->Next;
+    --FreeCounts[sizeClass];
+    return block;
+  }
+
+  bool push(size_t sizeClass, void *ptr) {
+    if (FreeCounts[sizeClass] >= MaxCachedBlocksPerClass)
+      return false;
+    auto block = static_cast<FreeBlock *>(ptr);
+    block->Next = FreeLists[sizeClass];
+    FreeLists[sizeClass] = block;
+    ++FreeCounts[sizeClass];
+    return true;
+  }
+
+  void releaseAll() {
+    for (size_t i = 0; i < NumSizeClasses; ++i) {
+      while (void *block = pop(i))
+        free(block);
+    }
+  }
+};
+
+} // end anonymous namespace
+
+/// The calling thread's cache, or null if it hasn't been created yet.
+/// Set to DeadThreadCache once the thread has started tearing down its
+/// thread-specific data; allocations from then on bypass the cache.
+static LLVM_THREAD_LOCAL ThreadAllocCache *CurrentThreadCache;
+static ThreadAllocCache * const DeadThreadCache =
+  reinterpret_cast<ThreadAllocCache *>(uintptr_t(1));
+
+static pthread_key_t ThreadCacheKey;
+static pthread_once_t ThreadCacheKeyOnce = PTHREAD_ONCE_INIT;
+
+static void destroyThreadCache(void *value) {
+  auto cache = static_cast<ThreadAllocCache *>(value);
+  CurrentThreadCache = DeadThreadCache;
+  cache->releaseAll();
+  free(cache);
+}
+
+static void createThreadCacheKey() {
+  pthread_key_create(&ThreadCacheKey, destroyThreadCache);
+}
+
+static ThreadAllocCache *getThreadCache() {
+  ThreadAllocCache *cache = CurrentThreadCache;
+  if (LLVM_LIKELY(cache != nullptr))
+    return cache == DeadThreadCache ? nullptr : cache;
+
+  pthread_once(&ThreadCacheKeyOnce, createThreadCacheKey);
+  cache = static_cast<ThreadAllocCache *>(
+            calloc(1, sizeof(ThreadAllocCache)));
+  if (!cache)
+    return nullptr;
+  // Register the cache so that it is drained when the thread exits.
+  pthread_setspecific(ThreadCacheKey, cache);
+  CurrentThreadCache = cache;
+  return cache;
+}
+
+static inline size_t getSizeClass(size_t size) {
+  return size ? (size - 1) / SizeClassGranule : 0;
+}
+
+static inline size_t getSizeClassSize(size_t sizeClass) {
+  return (sizeClass + 1) * SizeClassGranule;
+}
+
+void *swift::swift_slowAlloc(size_t size, size_t alignMask) {
+  if (size <= MaxSizeClassSize) {
+    size_t sizeClass = getSizeClass(size);
+    if (alignMask <= MallocAlignMask)
+      if (auto cache = getThreadCache())
+        if (void *p = cache->pop(sizeClass))
+          return p;
+    // Always round small blocks up to their size class, even over-aligned
+    // ones, so that every small block is big enough to be recycled.
+    return mallocAligned(getSizeClassSize(sizeClass), alignMask);
+  }
+  return mallocAligned(size, alignMask);
+}
+
 void swift::swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask) {
+  if (bytes <= MaxSizeClassSize && alignMask <= MallocAlignMask) {
+    if (auto cache = getThreadCache())
+      if (cache->push(getSizeClass(bytes), ptr))
+        return;
+  }
   free(ptr);
 }
+
+#else
+
+void *swift::swift_slowAlloc(size_t size, size_t alignMask) {
+  return mallocAligned(size, alignMask);
+}
+
+void swift::swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask) {
+  free(ptr);
+}
+
+#endif
@@ -30,6 +30,12 @@
 #include <cstdio>
 #include <cstdlib>
 #include <unistd.h>
+#if SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE
+#include "llvm/ADT/DenseMap.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#endif
 #include "../SwiftShims/RuntimeShims.h"
 #if SWIFT_OBJC_INTEROP
 # include <objc/NSObject.h>
@@ -493,6 +499,10 @@ static inline void memset_pattern8(void *b, const void *pattern8, size_t len) {
 }
 #endif
 
+#if SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE
+static void detachWeakSideTable(HeapObject *object);
+#endif
+
 void swift::swift_deallocObject(HeapObject *object, size_t allocatedSize,
                                 size_t allocatedAlignMask) {
   assert(isAlignmentMask(allocatedAlignMask));
@@ -506,6 +516,12 @@ void swift::swift_deallocObject(HeapObject *object, size_t allocatedSize,
   // If we are tracking leaks, stop tracking this object.
   SWIFT_LEAKS_STOP_TRACKING_OBJECT(object);
 
+#if SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE
+  // Weak references now see a cleared side table entry, so they no longer
+  // need the object's memory.
+  detachWeakSideTable(object);
+#endif
+
   // Drop the initial weak retain of the object.
   //
   // If the outstanding weak retain count is 1 (i.e. only the initial
@@ -578,6 +594,244 @@ void swift::swift_deallocObject(HeapObject *object, size_t allocatedSize,
   }
 }
 
+#if SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE
+
+// Weak references through side table entries.
+//
+// In the default scheme a weak reference points straight at the object and
+// holds an unowned retain on it, so the object's memory stays allocated
+// after deinit until every weak reference has been loaded or destroyed.
+//
+// Here a weak reference instead points at a small WeakSideTableEntry shared
+// by all weak references to the same object. The entry holds the object
+// pointer until the object is deallocated, at which point the entry is
+// cleared and the object's memory is freed immediately; only the entry
+// outlives the object, until the last weak reference to it goes away.
+//
+// The entry for an object is found through a striped hash table keyed by
+// object address, which is only consulted when a weak reference is formed
+// and when an object that has an entry is deallocated. The weak refcount's
+// side table flag records whether an object has an entry, so deallocating
+// any other object never touches the table.
+
+#if SWIFT_OBJC_INTEROP
+#error "weak side tables are not supported with Objective-C interop"
+#endif
+
+namespace {
+
+class WeakSideTableEntry {
+  /// The object, or null once it has been deallocated. The low bit is a
+  /// lock that keeps the object from being deallocated while a weak load
+  /// is trying to retain it.
+  std::atomic<uintptr_t> Object;
+
+  /// One reference for every weak reference pointing at the entry, plus one
+  /// for the object itself while it is alive.
+  std::atomic<uint32_t> RefCount;
+
+  enum : uintptr_t { LockBit = 1 };
+
+  uintptr_t lock() {
+    uintptr_t value = Object.load(std::memory_order_relaxed);
+    while (true) {
+      if (value & LockBit) {
+        std::this_thread::yield();
+        value = Object.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (Object.compare_exchange_weak(value, value | LockBit,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed))
+        return value;
+    }
+  }
+
+  void unlock(uintptr_t value) {
+    Object.store(value, std::memory_order_release);
+  }
+
+public:
+  explicit WeakSideTableEntry(HeapObject *object)
+    : Object(reinterpret_cast<uintptr_t>(object)), RefCount(1) {}
+
+  void retain() {
+    RefCount.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void release() {
+    if (RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+
+  /// Has the object been deallocated?
+  bool isDead() const {
+    return Object.load(std::memory_order_relaxed) == 0;
+  }
+
+  /// Retain the object, unless it has been deallocated or is deallocating.
+  HeapObject *tryRetainObject() {
+    if (isDead())
+      return nullptr;
+    uintptr_t value = lock();
+    HeapObject *result = nullptr;
+    if (value)
+      result = swift_tryRetain(reinterpret_cast<HeapObject *>(value));
+    unlock(value);
+    return result;
+  }
+
+  /// Forget the object. Called when the object is deallocated; waits for
+  /// any concurrent tryRetainObject to finish with it.
+  void clearObject() {
+    lock();
+    unlock(0);
+  }
+};
+
+class WeakSideTable {
+  enum : unsigned { NumStripes = 64 };
+
+  struct Stripe {
+    std::mutex Lock;
+    llvm::DenseMap<HeapObject *, WeakSideTableEntry *> Entries;
+  };
+
+  Stripe Stripes[NumStripes];
+
+  Stripe &getStripe(HeapObject *object) {
+    return Stripes[(uintptr_t(object) >> 4) % NumStripes];
+  }
+
+public:
+  /// Find or create the entry for \p object and retain it on behalf of a
+  /// new weak reference.
+  WeakSideTableEntry *retainEntryFor(HeapObject *object) {
+    auto &stripe = getStripe(object);
+    std::lock_guard<std::mutex> guard(stripe.Lock);
+    auto &entry = stripe.Entries[object];
+    if (!entry) {
+      entry = new WeakSideTableEntry(object);
+      object->weakRefCount.setHasSideTable();
+    }
+    entry->retain();
+    return entry;
+  }
+
+  /// Detach \p object from its entry as it is deallocated.
+  void detach(HeapObject *object) {
+    WeakSideTableEntry *entry;
+    {
+      auto &stripe = getStripe(object);
+      std::lock_guard<std::mutex> guard(stripe.Lock);
+      auto found = stripe.Entries.find(object);
+      assert(found != stripe.Entries.end() && "side table flag without entry");
+      entry = found->second;
+      stripe.Entries.erase(found);
+    }
+    entry->clearObject();
+    entry->release();
+  }
+};
+
+} // end anonymous namespace
+
+static Lazy<WeakSideTable> WeakSideTables;
+
+static WeakSideTableEntry *getSideTableEntry(WeakReference *ref) {
+  return reinterpret_cast<WeakSideTableEntry *>(ref->Value);
+}
+
+static void setSideTableEntry(WeakReference *ref, WeakSideTableEntry *entry) {
+  ref->Value = reinterpret_cast<HeapObject *>(entry);
+}
+
+static WeakSideTableEntry *retainSideTableEntryFor(HeapObject *value) {
+  if (!value) return nullptr;
+  return WeakSideTables->retainEntryFor(value);
+}
+
+static void releaseSideTableEntry(WeakSideTableEntry *entry) {
+  if (entry) entry->release();
+}
+
+/// Called by swift_deallocObject.
+static void detachWeakSideTable(HeapObject *object) {
+  if (object->weakRefCount.hasSideTable())
+    WeakSideTables.unsafeGetAlreadyInitialized().detach(object);
+}
+
+void swift::swift_weakInit(WeakReference *ref, HeapObject *value) {
+  setSideTableEntry(ref, retainSideTableEntryFor(value));
+}
+
+void swift::swift_weakAssign(WeakReference *ref, HeapObject *newValue) {
+  auto newEntry = retainSideTableEntryFor(newValue);
+  auto oldEntry = getSideTableEntry(ref);
+  setSideTableEntry(ref, newEntry);
+  releaseSideTableEntry(oldEntry);
+}
+
+HeapObject *swift::swift_weakLoadStrong(WeakReference *ref) {
+  auto entry = getSideTableEntry(ref);
+  if (entry == nullptr) return nullptr;
+  if (auto object = entry->tryRetainObject())
+    return object;
+  // The object is gone; drop our reference to the entry.
+  if (entry->isDead()) {
+    setSideTableEntry(ref, nullptr);
+    entry->release();
+  }
+  return nullptr;
+}
+
+HeapObject *swift::swift_weakTakeStrong(WeakReference *ref) {
+  auto result = swift_weakLoadStrong(ref);
+  swift_weakDestroy(ref);
+  return result;
+}
+
+void swift::swift_weakDestroy(WeakReference *ref) {
+  auto tmp = getSideTableEntry(ref);
+  setSideTableEntry(ref, nullptr);
+  releaseSideTableEntry(tmp);
+}
+
+void swift::swift_weakCopyInit(WeakReference *dest, WeakReference *src) {
+  auto entry = getSideTableEntry(src);
+  if (entry == nullptr) {
+    setSideTableEntry(dest, nullptr);
+  } else if (entry->isDead()) {
+    setSideTableEntry(src, nullptr);
+    setSideTableEntry(dest, nullptr);
+    entry->release();
+  } else {
+    setSideTableEntry(dest, entry);
+    entry->retain();
+  }
+}
+
+void swift::swift_weakTakeInit(WeakReference *dest, WeakReference *src) {
+  auto entry = getSideTableEntry(src);
+  setSideTableEntry(dest, entry);
+  if (entry != nullptr && entry->isDead()) {
+    setSideTableEntry(dest, nullptr);
+    entry->release();
+  }
+}
+
+void swift::swift_weakCopyAssign(WeakReference *dest, WeakReference *src) {
+  releaseSideTableEntry(getSideTableEntry(dest));
+  swift_weakCopyInit(dest, src);
+}
+
+void swift::swift_weakTakeAssign(WeakReference *dest, WeakReference *src) {
+  releaseSideTableEntry(getSideTableEntry(dest));
+  swift_weakTakeInit(dest, src);
+}
+
+#else
+
 void swift::swift_weakInit(WeakReference *ref, HeapObject *value) {
   ref->Value = value;
   swift_unownedRetain(value);
@@ -650,6 +904,8 @@ void swift::swift_weakTakeAssign(WeakReference *dest, WeakReference *src) {
   swift_weakTakeInit(dest, src);
 }
 
+#endif // SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE
+
 void swift::_swift_abortRetainUnowned(const void *object) {
   (void)object;
   swift::crash("attempted to retain deallocated object");
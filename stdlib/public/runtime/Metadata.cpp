@@ -45,7 +45,9 @@
 #include <objc/runtime.h>
 #endif
 
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
 
 #if defined(__APPLE__) && defined(VM_MEMORY_SWIFT_METADATA)
 #define VM_TAG_FOR_SWIFT_METADATA VM_MAKE_TAG(VM_MEMORY_SWIFT_METADATA)
@@ -56,42 +58,125 @@
 using namespace swift;
 using namespace metadataimpl;
 
-void *MetadataAllocator::alloc(size_t size) {
+namespace {
+  /// The unused tail of the slab a thread is currently allocating from.
+  struct MetadataArena {
+    char *Next;
+    char *End;
+  };
+}
+
+/// Each thread bumps through its own slab. Keeping the arenas per-thread
+/// means instantiations on different threads never share a cursor, and
+/// since a slab is first touched by the thread that uses it, its pages
+/// are placed on that thread's node on NUMA systems.
+static LLVM_THREAD_LOCAL MetadataArena CurrentMetadataArena;
+
+static std::atomic<size_t> MetadataBytesAllocated;
+static std::atomic<size_t> MetadataBytesReserved;
+static std::atomic<size_t> MetadataNumSlabs;
+
+/// The list of statistics records for every cache kind created so far.
+static std::atomic<MetadataCacheStatistics *> MetadataCacheStatisticsList;
+
+static uintptr_t getPageSizeMask() {
 #if defined(__APPLE__)
-  const uintptr_t pagesizeMask = vm_page_mask;
+  return vm_page_mask;
 #else
   static const uintptr_t pagesizeMask = sysconf(_SC_PAGESIZE) - 1;
+  return pagesizeMask;
 #endif
+}
+
+/// The number of bytes mapped at a time to refill a thread's arena.
+static size_t getMetadataSlabSize() {
+  return SWIFT_LAZY_CONSTANT(([]() -> size_t {
+    const uintptr_t pagesizeMask = getPageSizeMask();
+    size_t slabSize = 64 * 1024;
+    if (const char *env = getenv("SWIFT_METADATA_SLAB_SIZE")) {
+      unsigned long long value = strtoull(env, nullptr, 0);
+      if (value > 0 && value <= (1ULL << 30))
+        slabSize = (size_t) value;
+    }
+    return (slabSize + pagesizeMask) & ~pagesizeMask;
+  }()));
+}
+
+static char *mapMetadataMemory(size_t size) {
+  auto mem = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE,
+                  VM_TAG_FOR_SWIFT_METADATA, 0);
+  if (mem == MAP_FAILED)
+    crash("unable to allocate memory for metadata cache");
+  MetadataBytesReserved.fetch_add(size, std::memory_order_relaxed);
+  MetadataNumSlabs.fetch_add(1, std::memory_order_relaxed);
+  return (char*) mem;
+}
+
+void *MetadataAllocator::alloc(size_t size) {
+  const uintptr_t pagesizeMask = getPageSizeMask();
+
+  // Keep every allocation pointer-aligned.
+  size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+  if (size == 0)
+    size = sizeof(void*);
+
+  MetadataBytesAllocated.fetch_add(size, std::memory_order_relaxed);
+  if (Statistics)
+    Statistics->NumBytes.fetch_add(size, std::memory_order_relaxed);
+
   // If the requested size is a page or larger, map page(s) for it
   // specifically.
-  if (LLVM_UNLIKELY(size > pagesizeMask)) {
-    auto mem = mmap(nullptr, (size + pagesizeMask) & ~pagesizeMask,
-                    PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE,
-                    VM_TAG_FOR_SWIFT_METADATA, 0);
-    if (mem == MAP_FAILED)
-      crash("unable to allocate memory for metadata cache");
-    return mem;
-  }
-  
-  char *end = next + size;
-  
-  // Allocate a new page if we need one.
-  if (LLVM_UNLIKELY(((uintptr_t)next & ~pagesizeMask)
-                      != (((uintptr_t)end & ~pagesizeMask)))){
-    next = (char*)
-      mmap(nullptr, pagesizeMask+1, PROT_READ|PROT_WRITE,
-           MAP_ANON|MAP_PRIVATE, VM_TAG_FOR_SWIFT_METADATA, 0);
+  if (LLVM_UNLIKELY(size > pagesizeMask))
+    return mapMetadataMemory((size + pagesizeMask) & ~pagesizeMask);
 
-    if (next == MAP_FAILED)
-      crash("unable to allocate memory for metadata cache");
-    end = next + size;
+  // Refill the arena if the allocation doesn't fit in what's left of it.
+  // Whatever remains of the old slab is abandoned; metadata is never freed.
+  MetadataArena &arena = CurrentMetadataArena;
+  if (LLVM_UNLIKELY(size_t(arena.End - arena.Next) < size)) {
+    size_t slabSize = getMetadataSlabSize();
+    arena.Next = mapMetadataMemory(slabSize);
+    arena.End = arena.Next + slabSize;
   }
-  
-  char *addr = next;
-  next = end;
+
+  char *addr = arena.Next;
+  arena.Next += size;
   return addr;
 }
 
+void swift::_registerMetadataCacheStatistics(MetadataCacheStatistics *stats,
+                                             const char *name) {
+  if (stats->Registered.exchange(true, std::memory_order_relaxed))
+    return;
+
+  stats->Name = name;
+  auto head = MetadataCacheStatisticsList.load(std::memory_order_relaxed);
+  do {
+    stats->Next = head;
+  } while (!MetadataCacheStatisticsList.compare_exchange_weak(
+             head, stats, std::memory_order_release,
+             std::memory_order_relaxed));
+}
+
+void
+swift::swift_getMetadataAllocationStatistics(MetadataAllocationStatistics *stats) {
+  stats->BytesAllocated =
+    MetadataBytesAllocated.load(std::memory_order_relaxed);
+  stats->BytesReserved = MetadataBytesReserved.load(std::memory_order_relaxed);
+  stats->NumSlabs = MetadataNumSlabs.load(std::memory_order_relaxed);
+}
+
+void swift::swift_enumerateMetadataCacheStatistics(
+    void (*callback)(void *context, const char *name, size_t numEntries,
+                     size_t numBytes),
+    void *context) {
+  for (auto stats = MetadataCacheStatisticsList.load(std::memory_order_acquire);
+       stats; stats = stats->Next) {
+    callback(context, stats->Name,
+             stats->NumEntries.load(std::memory_order_relaxed),
+             stats->NumBytes.load(std::memory_order_relaxed));
+  }
+}
+
 namespace {
   struct GenericCacheEntry;
 
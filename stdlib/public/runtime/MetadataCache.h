@@ -26,6 +26,22 @@
 
 namespace swift {
 
+/// Link a cache kind's statistics record into the list reported by
+/// swift_enumerateMetadataCacheStatistics. Only the first call for a given
+/// record has any effect.
+void _registerMetadataCacheStatistics(MetadataCacheStatistics *stats,
+                                      const char *name);
+
+/// The statistics record shared by every metadata cache whose entries have
+/// type \p ValueTy.
+template <class ValueTy>
+struct MetadataCacheStatisticsFor {
+  static MetadataCacheStatistics Statistics;
+};
+
+template <class ValueTy>
+MetadataCacheStatistics MetadataCacheStatisticsFor<ValueTy>::Statistics;
+
 // A wrapper around a pointer to a metadata cache entry that provides
 // DenseMap semantics that compare values in the key vector for the metadata
 // instance.
@@ -215,6 +231,10 @@ template <class ValueTy> class MetadataCache {
       return Hash;
     }
 
+    static size_t getKeyHash(const Key &key) {
+      return key.Hash;
+    }
+
     static size_t getExtraAllocationSize(const Key &key) {
       return key.KeyData.size() * sizeof(void*);
     }
@@ -261,17 +281,23 @@ template <class ValueTy> class MetadataCache {
   /// Allocator for entries of this cache.
   MetadataAllocator Allocator;
   
+  static MetadataCacheStatistics &getStatistics() {
+    return MetadataCacheStatisticsFor<ValueTy>::Statistics;
+  }
+
 public:
-  MetadataCache() : Concurrency(new ConcurrencyControl()) {}
+  MetadataCache() : Concurrency(new ConcurrencyControl()) {
+    _registerMetadataCacheStatistics(&getStatistics(), ValueTy::getName());
+    Allocator.setStatistics(&getStatistics());
+  }
   ~MetadataCache() {}
 
   /// Caches are not copyable.
   MetadataCache(const MetadataCache &other) = delete;
   MetadataCache &operator=(const MetadataCache &other) = delete;
 
-  /// Get the allocator for metadata in this cache.
-  /// The allocator can only be safely used while the cache is locked during
-  /// an addMetadataEntry call.
+  /// Get the allocator for metadata in this cache. The allocator is
+  /// thread-safe; allocations are charged to this cache kind's statistics.
   MetadataAllocator &getAllocator() { return Allocator; }
 
   /// Look up a cached metadata entry. If a cache match exists, return it.
@@ -332,6 +358,7 @@ public:
     // Otherwise, we created the entry and are responsible for
     // creating the metadata.
     auto value = builder();
+    getStatistics().NumEntries.fetch_add(1, std::memory_order_relaxed);
 
     // Update the linked list.
     value->Next = Head;
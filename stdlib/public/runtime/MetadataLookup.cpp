@@ -20,6 +20,7 @@
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/ADT/StringExtras.h"
@@ -84,6 +85,10 @@ namespace {
       return aName.compare(Name);
     }
 
+    static size_t getKeyHash(llvm::StringRef aName) {
+      return llvm::hash_value(aName);
+    }
+
     template <class... T>
     static size_t getExtraAllocationSize(T &&... ignored) {
       return 0;
@@ -120,6 +120,11 @@ namespace swift {
   const Metadata *
   _searchConformancesByMangledTypeName(const llvm::StringRef typeName);
 
+  /// Returns the number of conformance record sections registered so far.
+  /// It only grows when an image is loaded, so a failed conformance lookup is
+  /// known to fail again as long as it stays the same.
+  unsigned _getConformanceSectionCount();
+
 #if SWIFT_OBJC_INTEROP
   Demangle::NodePointer _swift_buildDemanglingForMetadata(const Metadata *type);
 #endif
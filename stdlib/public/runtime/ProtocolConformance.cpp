@@ -18,6 +18,9 @@
 #include "swift/Basic/Lazy.h"
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "Private.h"
 
 #if defined(__APPLE__) && defined(__MACH__)
@@ -28,8 +31,11 @@
 #include <link.h>
 #endif
 
+#include <deque>
 #include <dlfcn.h>
 #include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
 
 using namespace swift;
 
@@ -147,14 +153,68 @@ const {
 #endif
 
 namespace {
+  struct ConformanceSection;
+
+  /// The records of one conformance section, grouped by protocol, so that
+  /// a lookup only has to look at the records for the protocol it wants
+  /// instead of scanning the whole section.
+  class ConformanceSectionIndex {
+    /// The records, grouped by protocol. Within a group the records keep
+    /// their order in the section.
+    std::vector<const ProtocolConformanceRecord *> Records;
+
+    /// The [begin, end) range in Records for each protocol.
+    llvm::DenseMap<const ProtocolDescriptor *, std::pair<unsigned, unsigned>>
+      Ranges;
+
+  public:
+    explicit ConformanceSectionIndex(const ConformanceSection &section);
+
+    ArrayRef<const ProtocolConformanceRecord *>
+    lookup(const ProtocolDescriptor *proto) const {
+      auto found = Ranges.find(proto);
+      if (found == Ranges.end())
+        return {};
+      return llvm::makeArrayRef(Records).slice(
+               found->second.first, found->second.second - found->second.first);
+    }
+  };
+
   struct ConformanceSection {
     const ProtocolConformanceRecord *Begin, *End;
+
+    /// The protocol index of the section, built by the first lookup that
+    /// needs to scan this section.
+    mutable std::atomic<const ConformanceSectionIndex *> Index;
+
+    ConformanceSection(const ProtocolConformanceRecord *begin,
+                       const ProtocolConformanceRecord *end)
+      : Begin(begin), End(end), Index(nullptr) {}
+
     const ProtocolConformanceRecord *begin() const {
       return Begin;
     }
     const ProtocolConformanceRecord *end() const {
       return End;
     }
+
+    /// Get the protocol index of the section, building it if necessary.
+    /// This does not need the SectionsToScan lock; if two threads race to
+    /// build the index, one of them throws its copy away.
+    const ConformanceSectionIndex &getIndex() const {
+      if (auto index = Index.load(std::memory_order_acquire))
+        return *index;
+
+      auto newIndex = new ConformanceSectionIndex(*this);
+      const ConformanceSectionIndex *existing = nullptr;
+      if (Index.compare_exchange_strong(existing, newIndex,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire))
+        return *newIndex;
+
+      delete newIndex;
+      return *existing;
+    }
   };
 
   struct ConformanceCacheKey {
@@ -166,19 +226,55 @@ namespace {
       : Type(type), Proto(proto) {}
   };
 
+  ConformanceSectionIndex::ConformanceSectionIndex(
+                                         const ConformanceSection &section) {
+    // Count the records for each protocol.
+    for (const auto &record : section)
+      ++Ranges[record.getProtocol()].second;
+
+    // Assign each protocol its range. Until the records are distributed
+    // below, the second field is used as the insertion cursor.
+    unsigned offset = 0;
+    for (auto &range : Ranges) {
+      unsigned count = range.second.second;
+      range.second = {offset, offset};
+      offset += count;
+    }
+
+    Records.resize(offset);
+    for (const auto &record : section) {
+      auto &range = Ranges[record.getProtocol()];
+      Records[range.second++] = &record;
+    }
+  }
+
   struct ConformanceCacheEntry {
   private:
     const void *Type; 
     const ProtocolDescriptor *Proto;
-    std::atomic<const WitnessTable *> Table;
-    std::atomic<uintptr_t> FailureGeneration;
+    /// The witness table if the lookup succeeded. Otherwise the failure
+    /// generation, shifted left by one with the low bit set. Keeping both in
+    /// one word lets a failure be recorded without ever overwriting a
+    /// success that another thread found concurrently.
+    std::atomic<uintptr_t> Value;
+
+    static uintptr_t encodeFailure(uintptr_t failureGeneration) {
+      return (failureGeneration << 1) | 1;
+    }
+
+    static bool isFailure(uintptr_t value) {
+      return value & 1;
+    }
 
   public:
     ConformanceCacheEntry(ConformanceCacheKey key,
                           const WitnessTable *table,
                           uintptr_t failureGeneration)
-      : Type(key.Type), Proto(key.Proto), Table(table),
-        FailureGeneration(failureGeneration) {
+      : Type(key.Type), Proto(key.Proto),
+        Value(table ? reinterpret_cast<uintptr_t>(table)
+                    : encodeFailure(failureGeneration)) {
+      assert(!isFailure(reinterpret_cast<uintptr_t>(table)) &&
+             "witness table is misaligned");
     }
 
     int compareWithKey(const ConformanceCacheKey &key) const {
@@ -191,34 +287,53 @@ namespace {
       }
     }
 
+    static size_t getKeyHash(const ConformanceCacheKey &key) {
+      // Metadata and descriptors are at least pointer-aligned, so drop the
+      // low bits before mixing.
+      size_t H = (uintptr_t(key.Type) >> 3) ^
+                 ((uintptr_t(key.Proto) >> 3) * 0x56ba80d1);
+      H *= 0x27d4eb2d;
+      return H ^ (H >> 15);
+    }
+
     template <class... Args>
     static size_t getExtraAllocationSize(Args &&... ignored) {
       return 0;
     }
 
     bool isSuccessful() const {
-      return Table.load(std::memory_order_relaxed) != nullptr;
+      return !isFailure(Value.load(std::memory_order_relaxed));
     }
 
     void makeSuccessful(const WitnessTable *table) {
-      Table.store(table, std::memory_order_release);
+      Value.store(reinterpret_cast<uintptr_t>(table),
+                  std::memory_order_release);
     }
 
+    /// Raise the generation under which this lookup failed. Does nothing if
+    /// the lookup has succeeded or already failed under a later generation.
     void updateFailureGeneration(uintptr_t failureGeneration) {
-      assert(!isSuccessful());
-      FailureGeneration.store(failureGeneration, std::memory_order_relaxed);
+      uintptr_t newValue = encodeFailure(failureGeneration);
+      uintptr_t value = Value.load(std::memory_order_relaxed);
+      while (isFailure(value) && value < newValue) {
+        if (Value.compare_exchange_weak(value, newValue,
+                                        std::memory_order_relaxed))
+          return;
+      }
     }
     
     /// Get the cached witness table, if successful.
     const WitnessTable *getWitnessTable() const {
-      assert(isSuccessful());
-      return Table.load(std::memory_order_acquire);
+      uintptr_t value = Value.load(std::memory_order_acquire);
+      assert(!isFailure(value));
+      return reinterpret_cast<const WitnessTable *>(value);
     }
     
-    /// Get the generation number under which this lookup failed.
+    /// Get the generation number under which this lookup failed, or 0 if
+    /// another thread has found a conformance since it was checked.
     unsigned getFailureGeneration() const {
-      assert(!isSuccessful());
-      return FailureGeneration.load(std::memory_order_relaxed);
+      uintptr_t value = Value.load(std::memory_order_relaxed);
+      return isFailure(value) ? value >> 1 : 0;
     }
   };
 }
@@ -227,14 +342,31 @@ namespace {
 
 static void _initializeCallbacksToInspectDylib();
 
+static void _printFrontCacheStatistics();
+
 struct ConformanceState {
   ConcurrentMap<ConformanceCacheEntry> Cache;
-  std::vector<ConformanceSection> SectionsToScan;
+  /// A deque rather than a vector: sections never move once registered,
+  /// so a lookup can keep scanning them after it drops the lock.
+  std::deque<ConformanceSection> SectionsToScan;
   pthread_mutex_t SectionsToScanLock;
+  /// The size of SectionsToScan, readable without holding the lock.
+  std::atomic<unsigned> NumSections;
+
+  /// Whether to count hits and misses in the per-thread front cache.
+  /// Enabled by setting SWIFT_DEBUG_CONFORMANCE_CACHE_STATS in the
+  /// environment; the totals are printed to stderr at exit.
+  bool CollectFrontCacheStats;
+  std::atomic<size_t> FrontCacheHits;
+  std::atomic<size_t> FrontCacheMisses;
   
-  ConformanceState() {
-    SectionsToScan.reserve(16);
+  ConformanceState()
+    : NumSections(0), FrontCacheHits(0), FrontCacheMisses(0) {
     pthread_mutex_init(&SectionsToScanLock, nullptr);
+    CollectFrontCacheStats =
+      getenv("SWIFT_DEBUG_CONFORMANCE_CACHE_STATS") != nullptr;
+    if (CollectFrontCacheStats)
+      atexit(_printFrontCacheStatistics);
     _initializeCallbacksToInspectDylib();
   }
 
@@ -249,13 +381,18 @@ struct ConformanceState {
     }
   }
 
-  void cacheFailure(const void *type, const ProtocolDescriptor *proto) {
-    uintptr_t failureGeneration = SectionsToScan.size();
+  /// Record that the first \p failureGeneration sections contain no
+  /// conformance of \p type to \p proto.
+  void cacheFailure(const void *type, const ProtocolDescriptor *proto,
+                    uintptr_t failureGeneration) {
     auto result = Cache.getOrInsert(ConformanceCacheKey(type, proto),
                                     (const WitnessTable *) nullptr,
                                     failureGeneration);
 
-    // If the entry was already present, we may need to update it.
+    // If the entry was already present, we may need to update it. Sections
+    // are scanned outside the lock, so another thread may already have
+    // found a conformance or scanned more sections; the update never undoes
+    // either.
     if (!result.second) {
       result.first->updateFailureGeneration(failureGeneration);
     }
@@ -269,12 +406,32 @@ struct ConformanceState {
 
 static Lazy<ConformanceState> Conformances;
 
+// This variable is used to signal when a cache was generated and
+// it is correct to avoid a new scan. It is also bumped whenever new
+// conformance records are registered, which invalidates the per-thread
+// front caches.
+static std::atomic<unsigned> ConformanceCacheGeneration{0};
+
+unsigned swift::_getConformanceSectionCount() {
+  return Conformances.get().NumSections.load(std::memory_order_acquire);
+}
+
+static void _printFrontCacheStatistics() {
+  auto &C = Conformances.unsafeGetAlreadyInitialized();
+  fprintf(stderr, "swift_conformsToProtocol front cache: "
+                  "%zu hits, %zu misses\n",
+          C.FrontCacheHits.load(std::memory_order_relaxed),
+          C.FrontCacheMisses.load(std::memory_order_relaxed));
+}
+
 static void
 _registerProtocolConformances(ConformanceState &C,
                               const ProtocolConformanceRecord *begin,
                               const ProtocolConformanceRecord *end) {
   pthread_mutex_lock(&C.SectionsToScanLock);
-  C.SectionsToScan.push_back(ConformanceSection{begin, end});
+  C.SectionsToScan.emplace_back(begin, end);
+  C.NumSections.store(C.SectionsToScan.size(), std::memory_order_release);
+  ConformanceCacheGeneration.fetch_add(1, std::memory_order_release);
   pthread_mutex_unlock(&C.SectionsToScanLock);
 }
 
@@ -389,10 +546,6 @@ static void _initializeCallbacksToInspectDylib() {
 #endif
 }
 
-// This variable is used to signal when a cache was generated and
-// it is correct to avoid a new scan.
-static unsigned ConformanceCacheGeneration = 0;
-
 void
 swift::swift_registerProtocolConformances(const ProtocolConformanceRecord *begin,
                                           const ProtocolConformanceRecord *end){
@@ -430,7 +583,8 @@ recur_inside_cache_lock:
         foundEntry = Value;
 
       // If we got a cached negative response, check the generation number.
-      if (Value->getFailureGeneration() == C.SectionsToScan.size()) {
+      if (Value->getFailureGeneration()
+            == C.NumSections.load(std::memory_order_acquire)) {
         // We found an entry with a negative value.
         return std::make_pair(nullptr, true);
       }
@@ -501,19 +655,19 @@ bool isRelatedType(const Metadata *type, const void *candidate,
   return false;
 }
 
-const WitnessTable *
-swift::swift_conformsToProtocol(const Metadata *type,
-                                const ProtocolDescriptor *protocol) {
-  auto &C = Conformances.get();
+static const WitnessTable *
+_conformsToProtocolUncached(ConformanceState &C, const Metadata *type,
+                            const ProtocolDescriptor *protocol) {
   auto origType = type;
   unsigned numSections = 0;
   ConformanceCacheEntry *foundEntry;
 
 recur:
   // See if we have a cached conformance. The ConcurrentMap data structure
-  // allows us to insert and search the map concurrently without locking.
-  // We do lock the slow path because the SectionsToScan data structure is not
-  // concurrent.
+  // allows us to search the map concurrently without locking.
+  // We only take the lock in the slow path to snapshot the SectionsToScan
+  // data structure, which is not concurrent; the scan itself happens outside
+  // the lock.
   auto FoundConformance = searchInConformanceCache(type, protocol, foundEntry);
   // The negative answer does not always mean that there is no conformance,
   // unless it is an exact match on the type. If it is not an exact match,
@@ -524,7 +678,8 @@ recur:
       return FoundConformance.first;
   }
 
-  unsigned failedGeneration = ConformanceCacheGeneration;
+  unsigned failedGeneration =
+    ConformanceCacheGeneration.load(std::memory_order_relaxed);
 
   // If we didn't have an up-to-date cache entry, scan the conformance records.
   pthread_mutex_lock(&C.SectionsToScanLock);
@@ -532,7 +687,8 @@ recur:
   // If we have no new information to pull in (and nobody else pulled in
   // new information while we waited on the lock), we're done.
   if (C.SectionsToScan.size() == numSections) {
-    if (failedGeneration != ConformanceCacheGeneration) {
+    if (failedGeneration !=
+          ConformanceCacheGeneration.load(std::memory_order_relaxed)) {
       // Someone else pulled in new conformances while we were waiting.
       // Start over with our newly-populated cache.
       pthread_mutex_unlock(&C.SectionsToScanLock);
@@ -542,7 +698,7 @@ recur:
 
 
     // Save the failure for this type-protocol pair in the cache.
-    C.cacheFailure(type, protocol);
+    C.cacheFailure(type, protocol, numSections);
 
     pthread_mutex_unlock(&C.SectionsToScanLock);
     return nullptr;
@@ -553,29 +709,29 @@ recur:
 
   // Scan only sections that were not scanned yet.
   unsigned sectionIdx = foundEntry ? foundEntry->getFailureGeneration() : 0;
-  unsigned endSectionIdx = C.SectionsToScan.size();
+  unsigned endSectionIdx = numSections;
 
-  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = C.SectionsToScan[sectionIdx];
-    // Eagerly pull records for nondependent witnesses into our cache.
-    for (const auto &record : section) {
-      // If the record applies to a specific type, cache it.
-      if (auto metadata = record.getCanonicalTypeMetadata()) {
-        auto P = record.getProtocol();
+  SmallVector<const ConformanceSection *, 16> sections;
+  for (; sectionIdx < endSectionIdx; ++sectionIdx)
+    sections.push_back(&C.SectionsToScan[sectionIdx]);
 
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
+  pthread_mutex_unlock(&C.SectionsToScanLock);
 
+  for (auto section : sections) {
+    // Eagerly pull records for nondependent witnesses into our cache. The
+    // index only gives us the records for the protocol we're looking for.
+    for (auto record : section->getIndex().lookup(protocol)) {
+      // If the record applies to a specific type, cache it.
+      if (auto metadata = record->getCanonicalTypeMetadata()) {
         if (!isRelatedType(type, metadata, /*isMetadata=*/true))
           continue;
 
         // Store the type-protocol pair in the cache.
-        auto witness = record.getWitnessTable(metadata);
+        auto witness = record->getWitnessTable(metadata);
         if (witness) {
-          C.cacheSuccess(metadata, P, witness);
+          C.cacheSuccess(metadata, protocol, witness);
         } else {
-          C.cacheFailure(metadata, P);
+          C.cacheFailure(metadata, protocol, endSectionIdx);
         }
 
       // If the record provides a nondependent witness table for all instances
@@ -583,34 +739,86 @@ recur:
       // TODO: "Nondependent witness table" probably deserves its own flag.
       // An accessor function might still be necessary even if the witness table
       // can be shared.
-      } else if (record.getTypeKind()
+      } else if (record->getTypeKind()
                    == TypeMetadataRecordKind::UniqueNominalTypeDescriptor
-                 && record.getConformanceKind()
+                 && record->getConformanceKind()
                    == ProtocolConformanceReferenceKind::WitnessTable) {
 
-        auto R = record.getNominalTypeDescriptor();
-        auto P = record.getProtocol();
-
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
+        auto R = record->getNominalTypeDescriptor();
 
         if (!isRelatedType(type, R, /*isMetadata=*/false))
           continue;
 
         // Store the type-protocol pair in the cache.
-        C.cacheSuccess(R, P, record.getStaticWitnessTable());
+        C.cacheSuccess(R, protocol, record->getStaticWitnessTable());
       }
     }
   }
-  ++ConformanceCacheGeneration;
+  ConformanceCacheGeneration.fetch_add(1, std::memory_order_release);
 
-  pthread_mutex_unlock(&C.SectionsToScanLock);
   // Start over with our newly-populated cache.
   type = origType;
   goto recur;
 }
 
+namespace {
+  /// A small direct-mapped cache of recent swift_conformsToProtocol
+  /// results, private to each thread. It sits in front of the shared
+  /// conformance cache so that repeated casts of the same type to the same
+  /// protocol cost a few loads. Negative results are cached too.
+  ///
+  /// An entry is only valid for the ConformanceCacheGeneration under which
+  /// it was filled; any new conformance scan or newly registered image
+  /// invalidates every thread's cache at once.
+  struct ConformanceFrontCache {
+    enum : unsigned { NumEntries = 64 };
+
+    struct Entry {
+      const Metadata *Type;
+      const ProtocolDescriptor *Proto;
+      const WitnessTable *Table;
+      unsigned Generation;
+    };
+
+    Entry Entries[NumEntries];
+
+    Entry &getEntry(const Metadata *type, const ProtocolDescriptor *proto) {
+      uintptr_t H = (uintptr_t(type) >> 4) ^ (uintptr_t(proto) >> 3);
+      return Entries[(H ^ (H >> 7)) % NumEntries];
+    }
+  };
+}
+
+// This must stay trivially constructible and destructible so that it can
+// be a plain TLS variable without any per-thread initialization.
+static LLVM_THREAD_LOCAL ConformanceFrontCache FrontCache;
+
+const WitnessTable *
+swift::swift_conformsToProtocol(const Metadata *type,
+                                const ProtocolDescriptor *protocol) {
+  auto &C = Conformances.get();
+
+  // Read the generation before doing any lookup, so that an entry filled
+  // by a lookup that raced with a new scan is conservatively stale.
+  unsigned generation =
+    ConformanceCacheGeneration.load(std::memory_order_acquire);
+
+  auto &entry = FrontCache.getEntry(type, protocol);
+  if (entry.Type == type && entry.Proto == protocol &&
+      entry.Generation == generation) {
+    if (C.CollectFrontCacheStats)
+      C.FrontCacheHits.fetch_add(1, std::memory_order_relaxed);
+    return entry.Table;
+  }
+
+  if (C.CollectFrontCacheStats)
+    C.FrontCacheMisses.fetch_add(1, std::memory_order_relaxed);
+
+  auto table = _conformsToProtocolUncached(C, type, protocol);
+  entry = {type, protocol, table, generation};
+  return table;
+}
+
 const Metadata *
 swift::_searchConformancesByMangledTypeName(const llvm::StringRef typeName) {
   auto &C = Conformances.get();
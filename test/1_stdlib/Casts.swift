@@ -73,4 +73,41 @@ CastsTests.test("No overrelease of existential boxes in failed casts") {
     bar(err)
 }
 
+protocol Weighted {
+    var weight: Int { get }
+}
+
+struct WeightedBox : Weighted {
+    var weight: Int
+    let tracker: DeinitTester
+}
+
+struct UnweightedBox {
+    let tracker: DeinitTester
+}
+
+CastsTests.test("Repeated casts between the same types") {
+    // The runtime remembers the outcome of casts between concrete value
+    // types. Make sure replayed casts behave like the first one, including
+    // their ownership of the source value.
+    var deinitCount = 0
+    do {
+        let values: [Any] = [
+            WeightedBox(weight: 3, tracker: DeinitTester { deinitCount += 1 }),
+            UnweightedBox(tracker: DeinitTester { deinitCount += 1 }),
+        ]
+        for _ in 0..<10 {
+            if let w = values[0] as? Weighted {
+                expectEqual(3, w.weight)
+            } else {
+                expectUnreachable()
+            }
+            expectEmpty(values[1] as? Weighted)
+            expectEmpty(values[0] as? Int)
+            expectEmpty(values[1] as? WeightedBox)
+        }
+    }
+    expectEqual(2, deinitCount)
+}
+
 runAllTests()
@@ -0,0 +1,41 @@
+#!/usr/bin/env python
+# compare_solver_stats.py - Check that solver statistics went down
+#
+# Usage: compare_solver_stats.py <new stats> <old stats> <statistic>...
+#
+# Reads the output of two runs of the frontend with -print-stats and fails
+# unless each of the named constraint solver statistics is lower in the first
+# run than in the second.
+
+from __future__ import print_function
+
+import re
+import sys
+
+
+def read_stats(path):
+    stats = {}
+    with open(path) as f:
+        for line in f:
+            match = re.match(r'\s*(\d+) Constraint solver overall - (.*)$',
+                             line.rstrip())
+            if match:
+                stats[match.group(2)] = int(match.group(1))
+    return stats
+
+
+def main():
+    new_stats = read_stats(sys.argv[1])
+    old_stats = read_stats(sys.argv[2])
+    failed = False
+    for name in sys.argv[3:]:
+        new_value = new_stats.get(name, 0)
+        old_value = old_stats.get(name, 0)
+        print('{}: {} -> {}'.format(name, old_value, new_value))
+        if new_value >= old_value:
+            failed = True
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
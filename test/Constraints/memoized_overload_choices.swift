@@ -0,0 +1,28 @@
+// RUN: %target-swift-frontend -emit-sil %s -print-stats 2>&1 | FileCheck -check-prefix=CHECK-MEMO %s
+// RUN: %target-swift-frontend -emit-sil %s -disable-constraint-solver-memoization -print-stats 2>&1 | FileCheck -check-prefix=CHECK-NOMEMO %s
+// RUN: %target-swift-frontend -emit-silgen %s | FileCheck %s
+
+// REQUIRES: asserts
+
+// CHECK-MEMO: Statistics Collected
+// CHECK-MEMO: {{[0-9]+}} Constraint solver overall - # of systems solved with memoized overload choices
+
+// CHECK-NOMEMO: Statistics Collected
+// CHECK-NOMEMO-NOT: memoized overload choices
+
+let x0: Double = 1 + 2 * 3 - 4
+let x1: Double = 1 + 2 * 3 - 4
+let x2: Double = 1 + 2 * 3 - 4
+let x3: Double = 1 + 2 * 3 - 4
+
+// The same shape with a different contextual type gets its own choices.
+// CHECK-LABEL: sil hidden @_TF24memoized_overload_choices5sumsFT_T_
+// CHECK: function_ref @_TZFsoi1pFTSdSd_Sd
+// CHECK: function_ref @_TZFsoi1pFTSiSi_Si
+// CHECK: function_ref @_TZFsoi1pFTSdSd_Sd
+func sums() {
+  let a: Double = 1 + 2
+  let b: Int = 1 + 2
+  let c: Double = 1 + 2
+  _ = (a, b, c)
+}
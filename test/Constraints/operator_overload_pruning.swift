@@ -0,0 +1,33 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swift-frontend -parse %s -print-stats 2>&1 | FileCheck %s
+
+// Compare against trying every overload, for this file and for a case that
+// used to be too slow to type check.
+// RUN: %target-swift-frontend -parse %s -print-stats 2> %t/pruned.txt
+// RUN: %target-swift-frontend -parse %s -print-stats -disable-operator-overload-pruning 2> %t/unpruned.txt
+// RUN: %{python} %S/Inputs/compare_solver_stats.py %t/pruned.txt %t/unpruned.txt "# of disjunction terms explored" "# of solution states explored"
+// RUN: %target-swift-frontend -parse %S/../Interpreter/algorithms.swift -print-stats 2> %t/algorithms_pruned.txt
+// RUN: %target-swift-frontend -parse %S/../Interpreter/algorithms.swift -print-stats -disable-operator-overload-pruning 2> %t/algorithms_unpruned.txt
+// RUN: %{python} %S/Inputs/compare_solver_stats.py %t/algorithms_pruned.txt %t/algorithms_unpruned.txt "# of disjunction terms explored" "# of solution states explored"
+
+// REQUIRES: asserts
+
+// CHECK: Statistics Collected
+// CHECK: {{[0-9]+}} Constraint solver overall - # of operator overloads skipped for their argument types
+
+func mix(a: Double, b: Double, c: Double) -> Double {
+  return a * b + c * a - b / c
+}
+
+// Arguments that convert to the parameter type keep their overloads.
+func unwrapped(x: Int!, y: Int) -> Int {
+  return x + y
+}
+
+func optionals(x: Int?, y: Int) -> Bool {
+  return x == y
+}
+
+func compound(inout x: Double, y: Double) {
+  x += y * 2
+}
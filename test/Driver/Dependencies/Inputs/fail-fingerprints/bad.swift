@@ -0,0 +1,4 @@
+# Dependencies after compilation:
+provides-top-level: [bad]
+top-level-fingerprints: [[bad, "after"]]
+interface-hash: "after"
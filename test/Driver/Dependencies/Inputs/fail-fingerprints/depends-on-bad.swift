@@ -0,0 +1,3 @@
+# Dependencies after compilation:
+depends-top-level: [bad]
+interface-hash: "after"
@@ -0,0 +1,3 @@
+# Dependencies after compilation:
+depends-top-level: [main]
+interface-hash: "after"
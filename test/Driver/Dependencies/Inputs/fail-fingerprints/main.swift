@@ -0,0 +1,4 @@
+# Dependencies after compilation:
+provides-top-level: [main]
+top-level-fingerprints: [[main, "main"]]
+interface-hash: "after"
@@ -0,0 +1,34 @@
+// The driver records how long each compile job took in the build record, and
+// can report when each job ran.
+
+// RUN: rm -rf %t && cp -r %S/Inputs/independent/ %t
+// RUN: touch -t 201401240005 %t/*
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json ./main.swift ./other.swift -module-name main -j2 -driver-time-trace %t/trace.json -driver-show-critical-path 2>&1 | FileCheck -check-prefix=CHECK-PATH %s
+
+// CHECK-PATH: Critical path: 1 task running for {{[0-9]+\.[0-9]+}}s of {{[0-9]+\.[0-9]+}}s
+// CHECK-PATH: compile {{main|other}}.swift
+
+// RUN: FileCheck -check-prefix=CHECK-TRACE %s < %t/trace.json
+
+// CHECK-TRACE: "traceEvents":
+// CHECK-TRACE-DAG: "name": "compile main.swift"
+// CHECK-TRACE-DAG: "name": "compile other.swift"
+// CHECK-TRACE-DAG: "cat": "compile"
+// CHECK-TRACE-DAG: "ph": "X"
+// CHECK-TRACE: "displayTimeUnit": "ms"
+
+// RUN: FileCheck -check-prefix=CHECK-RECORD %s < %t/main~buildrecord.swiftdeps
+
+// CHECK-RECORD: job_history:
+// CHECK-RECORD-DAG: "./main.swift": {wall_us: {{[0-9]+}}, cpu_us: {{[0-9]+}}, max_rss: {{[0-9]+}}}
+// CHECK-RECORD-DAG: "./other.swift": {wall_us: {{[0-9]+}}, cpu_us: {{[0-9]+}}, max_rss: {{[0-9]+}}}
+
+// The next build reads the history back to decide which job to start first.
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json ./main.swift ./other.swift -module-name main -j2 -v 2>&1 | FileCheck -check-prefix=CHECK-SECOND %s
+// RUN: FileCheck -check-prefix=CHECK-RECORD %s < %t/main~buildrecord.swiftdeps
+
+// CHECK-SECOND-NOT: warning
+// CHECK-SECOND-DAG: Handled main.swift
+// CHECK-SECOND-DAG: Handled other.swift
@@ -58,14 +58,14 @@
 
 // CHECK-SECOND: "kind": "began"
 // CHECK-SECOND: "name": "compile"
-// CHECK-SECOND: ".\/main.swift"
+// CHECK-SECOND: ".\/{{main|other}}.swift"
 // CHECK-SECOND: {{^}$}}
 
 // CHECK-SECOND-NOT: finished
 
 // CHECK-SECOND: "kind": "began"
 // CHECK-SECOND: "name": "compile"
-// CHECK-SECOND: ".\/other.swift"
+// CHECK-SECOND: ".\/{{other|main}}.swift"
 // CHECK-SECOND: {{^}$}}
 
 // CHECK-SECOND-NOT: began
@@ -0,0 +1,39 @@
+/// main ==> depends-on-main | bad ==> depends-on-bad
+
+// A file whose fingerprints change in a build that fails must still cause its
+// dependents to be rebuilt once it compiles again.
+
+// RUN: rm -rf %t && cp -r %S/Inputs/fail-fingerprints/ %t
+// RUN: touch -t 201401240005 %t/*
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./bad.swift ./depends-on-main.swift ./depends-on-bad.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-FIRST %s
+
+// CHECK-FIRST-NOT: warning
+// CHECK-FIRST: Handled main.swift
+// CHECK-FIRST: Handled bad.swift
+// CHECK-FIRST: Handled depends-on-main.swift
+// CHECK-FIRST: Handled depends-on-bad.swift
+
+// Reset the .swiftdeps files to what everything was last built against.
+// RUN: cp -r %S/Inputs/fail-fingerprints/*.swiftdeps %t
+
+// The compile of bad.swift fails, and its .swiftdeps file is left alone.
+// RUN: touch -t 201401240006 %t/bad.swift
+// RUN: cd %t && not %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies-bad.py -output-file-map %t/output.json -incremental ./main.swift ./bad.swift ./depends-on-main.swift ./depends-on-bad.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-SECOND %s
+
+// CHECK-SECOND-NOT: Handled
+// CHECK-SECOND: Handled bad.swift
+// CHECK-SECOND-NOT: Handled
+
+// Now bad.swift compiles. Its fingerprint differs from the one
+// depends-on-bad.swift was built against, so that is rebuilt too.
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json -incremental ./main.swift ./bad.swift ./depends-on-main.swift ./depends-on-bad.swift -module-name main -j1 -v 2>&1 | FileCheck -check-prefix=CHECK-THIRD %s
+
+// CHECK-THIRD-NOT: Handled main.swift
+// CHECK-THIRD-NOT: Handled depends-on-main.swift
+// CHECK-THIRD: Handled bad.swift
+// CHECK-THIRD-NOT: Handled main.swift
+// CHECK-THIRD-NOT: Handled depends-on-main.swift
+// CHECK-THIRD: Handled depends-on-bad.swift
+// CHECK-THIRD-NOT: Handled main.swift
+// CHECK-THIRD-NOT: Handled depends-on-main.swift
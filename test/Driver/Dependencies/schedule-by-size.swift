@@ -0,0 +1,35 @@
+// Larger compile jobs start first when running in parallel, and jobs start
+// in input order when running serially.
+
+// RUN: rm -rf %t && cp -r %S/Inputs/independent/ %t
+// RUN: echo "# padding to make other.swift the larger input file" >> %t/other.swift
+// RUN: touch -t 201401240005 %t/*
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json ./main.swift ./other.swift -module-name main -j2 -parseable-output 2>&1 | FileCheck -check-prefix=CHECK-PARALLEL %s
+
+// CHECK-PARALLEL: "kind": "began"
+// CHECK-PARALLEL: "name": "compile"
+// CHECK-PARALLEL: ".\/other.swift"
+// CHECK-PARALLEL: {{^}$}}
+
+// CHECK-PARALLEL: "kind": "began"
+// CHECK-PARALLEL: "name": "compile"
+// CHECK-PARALLEL: ".\/main.swift"
+// CHECK-PARALLEL: {{^}$}}
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json ./main.swift ./other.swift -module-name main -j1 -parseable-output 2>&1 | FileCheck -check-prefix=CHECK-SERIAL %s
+
+// CHECK-SERIAL: "kind": "began"
+// CHECK-SERIAL: "name": "compile"
+// CHECK-SERIAL: ".\/main.swift"
+// CHECK-SERIAL: {{^}$}}
+
+// CHECK-SERIAL: "kind": "began"
+// CHECK-SERIAL: "name": "compile"
+// CHECK-SERIAL: ".\/other.swift"
+// CHECK-SERIAL: {{^}$}}
+
+// RUN: cd %t && %swiftc_driver -c -driver-use-frontend-path %S/Inputs/update-dependencies.py -output-file-map %t/output.json ./main.swift ./other.swift -module-name main -j2 -min-available-memory 1 -v 2>&1 | FileCheck -check-prefix=CHECK-MEMORY %s
+
+// CHECK-MEMORY-DAG: Handled main.swift
+// CHECK-MEMORY-DAG: Handled other.swift
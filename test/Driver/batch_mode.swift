@@ -0,0 +1,18 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: touch %t/a.swift %t/b.swift %t/c.swift %t/d.swift
+// RUN: cd %t && %swiftc_driver -enable-batch-mode -j2 -driver-skip-execution -v -c -module-name main %t/a.swift %t/b.swift %t/c.swift %t/d.swift 2>&1 | FileCheck %s
+// RUN: cd %t && %swiftc_driver -enable-batch-mode -j1 -driver-skip-execution -v -c -module-name main %t/a.swift %t/b.swift %t/c.swift %t/d.swift 2>&1 | FileCheck -check-prefix=ONE-BATCH %s
+// RUN: cd %t && %swiftc_driver -enable-batch-mode -j2 -driver-skip-execution -v -c -wmo -module-name main %t/a.swift %t/b.swift %t/c.swift %t/d.swift 2>&1 | FileCheck -check-prefix=WMO %s
+
+// Empty inputs cost the same, so they are dealt out to the batches in turn.
+// CHECK: -frontend -c -primary-file {{[^ ]*}}/a.swift {{[^ ]*}}/b.swift -primary-file {{[^ ]*}}/c.swift {{[^ ]*}}/d.swift
+// CHECK-SAME: -o {{[^ ]*}}a.o -o {{[^ ]*}}c.o
+// CHECK: -frontend -c {{[^ ]*}}/a.swift -primary-file {{[^ ]*}}/b.swift {{[^ ]*}}/c.swift -primary-file {{[^ ]*}}/d.swift
+// CHECK-SAME: -o {{[^ ]*}}b.o -o {{[^ ]*}}d.o
+// CHECK-NOT: -frontend
+
+// ONE-BATCH: -frontend -c -primary-file {{[^ ]*}}/a.swift -primary-file {{[^ ]*}}/b.swift -primary-file {{[^ ]*}}/c.swift -primary-file {{[^ ]*}}/d.swift
+// ONE-BATCH-NOT: -frontend
+
+// WMO: -frontend -c {{[^ ]*}}/a.swift {{[^ ]*}}/b.swift {{[^ ]*}}/c.swift {{[^ ]*}}/d.swift
+// WMO-NOT: -primary-file
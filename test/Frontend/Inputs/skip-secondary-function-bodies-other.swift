@@ -0,0 +1,9 @@
+struct Other {
+  var value: Int { return ) }
+
+  init() { let = 1 }
+
+  func describe() -> String {
+    return 1 +
+  }
+}
@@ -0,0 +1,12 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: touch %t/a.swift %t/b.swift
+// RUN: not %target-swift-frontend -c -primary-file %t/a.swift -primary-file %t/b.swift -o %t/a.o 2>&1 | FileCheck -check-prefix=OUTPUT-COUNT %s
+// RUN: not %target-swift-frontend -c -primary-file %t/a.swift -primary-file %t/b.swift -o %t/a.o -o %t/b.o -emit-dependencies-path %t/a.d 2>&1 | FileCheck -check-prefix=DEPS-COUNT %s
+// RUN: not %target-swift-frontend -emit-module -primary-file %t/a.swift -primary-file %t/b.swift -o %t/a.swiftmodule -o %t/b.swiftmodule 2>&1 | FileCheck -check-prefix=UNSUPPORTED %s
+
+// OUTPUT-COUNT: error: '-o' must be given once per -primary-file (got 1, expected 2)
+// DEPS-COUNT: error: '-emit-dependencies-path' must be given once per -primary-file (got 1, expected 2)
+// UNSUPPORTED: error: multiple -primary-file inputs are not supported in this mode
+
+// RUN: %target-swift-frontend -c -primary-file %t/a.swift -primary-file %t/b.swift -o %t/a.o -o %t/b.o -emit-dependencies -module-name main
+// RUN: ls %t/a.o %t/b.o %t/a.d %t/b.d
@@ -0,0 +1,24 @@
+// Without a server listening, the job is compiled in process.
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %target-swift-frontend -use-compile-server %t/missing -emit-silgen %s -module-name main | FileCheck %s
+
+// The idle timeout stops the server even if this test fails before the kill.
+// RUN: %target-swift-frontend -compile-server %t/server -compile-server-idle-timeout 60 > %t/server.log 2>&1 & echo $! > %t/server.pid
+// RUN: for i in $(seq 100); do test -S %t/server && break; sleep 0.1; done
+// RUN: %target-swift-frontend -use-compile-server %t/server -emit-silgen %s -module-name main | FileCheck %s
+
+// Diagnostics, the exit status and relative paths are the client's.
+// RUN: cd %t && not %target-swift-frontend -use-compile-server %t/server -parse -D BROKEN %s 2>&1 | FileCheck -check-prefix=BROKEN %s
+// RUN: cp %s %t/input.swift
+// RUN: cd %t && %target-swift-frontend -use-compile-server %t/server -emit-silgen input.swift -module-name main -o out.sil
+// RUN: FileCheck %s < %t/out.sil
+
+// RUN: kill `cat %t/server.pid`
+
+// CHECK: sil hidden @_TF4main3fooFT_Si
+func foo() -> Int { return 1 }
+
+#if BROKEN
+// BROKEN: error: cannot convert value of type 'String' to specified type 'Int'
+let x: Int = ""
+#endif
@@ -0,0 +1,11 @@
+// RUN: not %target-swift-frontend -parse -primary-file %s %S/Inputs/skip-secondary-function-bodies-other.swift -module-name main 2>&1 | FileCheck -check-prefix=CHECK-PARSED %s
+// RUN: %target-swift-frontend -parse -primary-file %s %S/Inputs/skip-secondary-function-bodies-other.swift -module-name main -skip-secondary-function-bodies
+
+// The primary file's own bodies are still parsed.
+// RUN: not %target-swift-frontend -parse -primary-file %S/Inputs/skip-secondary-function-bodies-other.swift %s -module-name main -skip-secondary-function-bodies 2>&1 | FileCheck -check-prefix=CHECK-PARSED %s
+
+// CHECK-PARSED: skip-secondary-function-bodies-other.swift:2:{{[0-9]+}}: error:
+
+func useOther() -> Other {
+  return Other()
+}
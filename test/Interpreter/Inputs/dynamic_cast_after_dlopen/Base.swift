@@ -0,0 +1,7 @@
+public protocol P {
+  func answer() -> Int
+}
+
+public struct S {
+  public init() {}
+}
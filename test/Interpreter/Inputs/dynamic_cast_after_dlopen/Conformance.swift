@@ -0,0 +1,5 @@
+import Base
+
+extension S : P {
+  public func answer() -> Int { return 42 }
+}
@@ -0,0 +1,31 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-build-swift -emit-library -module-name Base -emit-module-path %t/Base.swiftmodule %S/Inputs/dynamic_cast_after_dlopen/Base.swift -o %t/libBase.dylib
+// RUN: %target-build-swift -emit-library -I %t -L %t -lBase %S/Inputs/dynamic_cast_after_dlopen/Conformance.swift -o %t/libConformance.dylib
+// RUN: %target-build-swift -I %t -L %t -lBase %s -Xlinker -rpath -Xlinker %t -o %t/main
+// RUN: %target-run %t/main %t/libConformance.dylib | FileCheck %s
+
+// REQUIRES: executable_test
+// REQUIRES: OS=macosx
+
+// A cast that failed must not keep failing once a library that is loaded
+// later adds the conformance.
+
+import Darwin
+import Base
+
+func answer(value: Any) -> Int? {
+  return (value as? P)?.answer()
+}
+
+// Fail twice, so that the failure is cached and replayed.
+// CHECK: before: nil
+// CHECK: before: nil
+print("before: \(answer(S()))")
+print("before: \(answer(S()))")
+
+guard dlopen(Process.arguments[1], RTLD_NOW) != nil else {
+  fatalError(String.fromCString(dlerror())!)
+}
+
+// CHECK: after: Optional(42)
+print("after: \(answer(S()))")
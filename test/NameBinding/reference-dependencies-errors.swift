@@ -1,5 +1,11 @@
 // RUN: rm -rf %t && mkdir %t
 // RUN: cp %s %t/main.swift
-// RUN: not %target-swift-frontend -parse -primary-file %t/main.swift -emit-reference-dependencies-path - > %t.swiftdeps
+// RUN: not %target-swift-frontend -parse -primary-file %t/main.swift -emit-reference-dependencies-path - -emit-yaml-reference-dependencies > %t.swiftdeps
+
+// A failed compile leaves the dependencies of the last successful one alone.
+// RUN: echo "# previous" > %t/main.swiftdeps
+// RUN: not %target-swift-frontend -parse -primary-file %t/main.swift -emit-reference-dependencies-path %t/main.swiftdeps -emit-yaml-reference-dependencies
+// RUN: FileCheck -check-prefix=KEPT %s < %t/main.swiftdeps
+// KEPT: {{^}}# previous{{$}}
 
 extension Foo {}
@@ -0,0 +1,43 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %S/../../utils/split_file.py -o %t %s
+
+// RUN: %target-swift-frontend -parse -primary-file %t/a.swift -module-name main -emit-reference-dependencies-path %t/a.swiftdeps -emit-yaml-reference-dependencies
+// RUN: %target-swift-frontend -parse -primary-file %t/b.swift -module-name main -emit-reference-dependencies-path %t/b.swiftdeps -emit-yaml-reference-dependencies
+// RUN: %target-swift-frontend -parse -primary-file %t/c.swift -module-name main -emit-reference-dependencies-path %t/c.swiftdeps -emit-yaml-reference-dependencies
+
+// RUN: sed -n '/^top-level-fingerprints:$/,/^member-fingerprints:$/p' %t/a.swiftdeps > %t/a.fingerprints
+// RUN: sed -n '/^top-level-fingerprints:$/,/^member-fingerprints:$/p' %t/b.swiftdeps > %t/b.fingerprints
+// RUN: sed -n '/^top-level-fingerprints:$/,/^member-fingerprints:$/p' %t/c.swiftdeps > %t/c.fingerprints
+// RUN: FileCheck %s < %t/a.fingerprints
+
+// Adding a private stored property changes the layout of T, so every user of
+// T has to be rebuilt even though the fingerprints of T.init and T.a are the
+// same.
+// RUN: not cmp %t/a.fingerprints %t/b.fingerprints
+
+// Editing a method body does not.
+// RUN: cmp %t/a.fingerprints %t/c.fingerprints
+
+// CHECK-LABEL: {{^top-level-fingerprints:$}}
+// CHECK: "T"
+// CHECK-LABEL: {{^nominal-fingerprints:$}}
+// CHECK: "V4main1T"
+
+// BEGIN a.swift
+struct T {
+  var a = 1
+  func f() -> Int { return a }
+}
+
+// BEGIN b.swift
+struct T {
+  var a = 1
+  private var b = 2
+  func f() -> Int { return a }
+}
+
+// BEGIN c.swift
+struct T {
+  var a = 1
+  func f() -> Int { return a + 1 }
+}
@@ -1,6 +1,6 @@
 // RUN: rm -rf %t && mkdir %t
 // RUN: cp %s %t/main.swift
-// RUN: %target-swift-frontend -parse -primary-file %t/main.swift %S/Inputs/reference-dependencies-members-helper.swift -emit-reference-dependencies-path - > %t.swiftdeps
+// RUN: %target-swift-frontend -parse -primary-file %t/main.swift %S/Inputs/reference-dependencies-members-helper.swift -emit-reference-dependencies-path - -emit-yaml-reference-dependencies > %t.swiftdeps
 
 // RUN: FileCheck -check-prefix=PROVIDES-NOMINAL %s < %t.swiftdeps
 // RUN: FileCheck -check-prefix=PROVIDES-NOMINAL-NEGATIVE %s < %t.swiftdeps
@@ -68,4 +68,4 @@ extension OtherStruct {
 }
 
 // PROVIDES-NOMINAL-NEGATIVE-LABEL: {{^depends-nominal:$}}
-// PROVIDES-MEMBER-NEGATIVE-LABEL: {{^depends-member:$}}
+// PROVIDES-MEMBER-NEGATIVE-LABEL: {{^top-level-fingerprints:$}}
@@ -0,0 +1,55 @@
+// RUN: %target-swift-frontend -parse-as-library -emit-silgen -profile-use=%S/Inputs/pgo_profile_use.proftext %s | FileCheck %s
+// RUN: %target-swift-frontend -parse-as-library -emit-ir -profile-use=%S/Inputs/pgo_profile_use.proftext %s | FileCheck -check-prefix=IR %s
+// RUN: not %target-swift-frontend -parse-as-library -emit-silgen -profile-use=%t.missing %s 2>&1 | FileCheck -check-prefix=MISSING %s
+// RUN: %target-swift-frontend -parse-as-library -emit-silgen -profile-use=%S/Inputs/pgo_profile_use.proftext %s 2>&1 >/dev/null | FileCheck -check-prefix=STALE %s
+
+// Using a profile doesn't instrument the code.
+// CHECK-NOT: int_instrprof_increment
+// MISSING: error: cannot read profile '{{.*}}.missing'
+
+// CHECK-LABEL: sil hidden @_TF15pgo_profile_use6branchFSbSi
+// CHECK: bb0({{.*}}):{{ *}}// count: 10
+// CHECK: cond_br {{.*}}, [[THEN:bb[0-9]+]], {{bb[0-9]+}}
+// CHECK: [[THEN]]:{{ *}}// Preds: bb0 count: 3
+
+// The count of the else edge is the rest of the count of the branch.
+// IR-LABEL: define hidden i64 @_TF15pgo_profile_use6branchFSbSi
+// IR: br i1 {{.*}}, label {{.*}}, label {{.*}}, !prof ![[WEIGHTS:[0-9]+]]
+// IR: ![[WEIGHTS]] = !{!"branch_weights", i32 4, i32 8}
+func branch(b: Bool) -> Int {
+  if b {
+    return 1
+  }
+  return 0
+}
+
+// The loop body was never executed.
+// CHECK-LABEL: sil hidden @_TF15pgo_profile_use4loopFSiSi
+// CHECK: bb0({{.*}}):{{ *}}// count: 1
+// CHECK: count: 0
+func loop(n: Int) -> Int {
+  var sum = 0
+  while sum < n {
+    sum += n
+  }
+  return sum
+}
+
+// Functions that aren't in the profile get no counts.
+// CHECK-LABEL: sil hidden @_TF15pgo_profile_use9unprofiledFT_T_
+// CHECK-NOT: count:
+// CHECK: return
+func unprofiled() {}
+
+// Counts recorded for a different version of a function are not used.
+// STALE: warning: profile data for 'stale{{.*}}' does not match its source; ignoring it
+// STALE-NOT: warning:
+// CHECK-LABEL: sil hidden @_TF15pgo_profile_use5staleFSbSi
+// CHECK-NOT: count:
+// CHECK: return
+func stale(b: Bool) -> Int {
+  if b {
+    return 1
+  }
+  return 0
+}
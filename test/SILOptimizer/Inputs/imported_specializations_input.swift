@@ -0,0 +1,8 @@
+@inline(never)
+public func pick<T>(c: Bool, _ a: T, _ b: T) -> T {
+  return c ? a : b
+}
+
+public func pickInt(c: Bool, _ a: Int, _ b: Int) -> Int {
+  return pick(c, a, b)
+}
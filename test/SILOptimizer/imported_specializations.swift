@@ -0,0 +1,20 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swift-frontend -O -parse-as-library -module-name Specializations -sil-serialize-all %S/Inputs/imported_specializations_input.swift -emit-module-path %t/Specializations.swiftmodule
+// RUN: %target-swift-frontend -O %s -I %t -emit-sil | FileCheck -check-prefix=CHECK-LOCAL %s
+// RUN: %target-swift-frontend -O %s -I %t -emit-sil -enable-imported-specializations | FileCheck -check-prefix=CHECK-IMPORTED %s
+
+// The specialization of pick<Int> was already created when the imported
+// module was compiled. With -enable-imported-specializations it is linked from
+// there instead of being created again.
+
+import Specializations
+
+// CHECK-LOCAL-DAG: sil shared {{.*}}@_TTSg5Si___TF15Specializations4pick
+// CHECK-LOCAL-DAG: function_ref @_TTSg5Si___TF15Specializations4pick
+
+// CHECK-IMPORTED-NOT: sil shared {{.*}}@_TTSg5Si___TF15Specializations4pick
+// CHECK-IMPORTED-DAG: sil shared_external {{.*}}@_TTSg5Si___TF15Specializations4pick
+// CHECK-IMPORTED-DAG: function_ref @_TTSg5Si___TF15Specializations4pick
+public func callPick(c: Bool, a: Int, b: Int) -> Int {
+  return pick(c, a, b)
+}
@@ -0,0 +1,33 @@
+public struct Counter {
+  public var value: Int
+
+  public init(value: Int) {
+    self.value = value
+  }
+
+  public func incremented() -> Counter {
+    return Counter(value: value + 1)
+  }
+
+  public func decremented() -> Counter {
+    return Counter(value: value - 1)
+  }
+
+  public func doubled() -> Counter {
+    return Counter(value: value * 2)
+  }
+
+  public func halved() -> Counter {
+    return Counter(value: value / 2)
+  }
+}
+
+extension Counter {
+  public static var zero: Counter {
+    return Counter(value: 0)
+  }
+
+  public func reset() -> Counter {
+    return Counter.zero
+  }
+}
@@ -0,0 +1,9 @@
+// RUN: %target-swift-frontend -parse %s -print-stats 2>&1 | FileCheck %s
+
+// REQUIRES: asserts
+
+// The standard library is large enough to always be mapped rather than read.
+// CHECK: Statistics Collected
+// CHECK: {{[0-9]+}} Serialization - # of bytes of module and documentation files mapped into memory
+
+let x: Int = 1
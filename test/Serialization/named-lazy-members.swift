@@ -0,0 +1,24 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/named_lazy_members.swift
+// RUN: llvm-bcanalyzer %t/named_lazy_members.swiftmodule | FileCheck -check-prefix=CHECK-BC %s
+// RUN: %target-swift-frontend -parse -I %t %s -print-stats 2>&1 | FileCheck -check-prefix=CHECK-NAMED %s
+// RUN: %target-swift-frontend -parse -I %t %s -disable-named-lazy-member-loading -print-stats 2>&1 | FileCheck -check-prefix=CHECK-ALL %s
+
+// REQUIRES: asserts
+
+// CHECK-BC-NOT: UnknownCode
+// CHECK-BC: DECL_MEMBER_NAMES
+
+// CHECK-NAMED: Statistics Collected
+// CHECK-NAMED: {{[0-9]+}} Serialization - # of members loaded by name without loading their siblings
+
+// CHECK-ALL: Statistics Collected
+// CHECK-ALL: {{[0-9]+}} Serialization - # of decls deserialized
+// CHECK-ALL-NOT: loaded by name
+
+import named_lazy_members
+
+func useCounter(_ c: Counter) -> Counter {
+  return c.doubled().reset()
+}
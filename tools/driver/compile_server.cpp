@@ -0,0 +1,377 @@
+//===--- compile_server.cpp - Serving frontend jobs from one process ------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// A compile server is a frontend process that has set up a CompilerInstance
+// and loaded the standard library into it, and then waits for jobs on a Unix
+// domain socket. Each job is compiled in a child forked from the server, so
+// that it starts with the server's modules already deserialized but cannot
+// change them for the jobs that come after it.
+//
+// A client sends one request per connection. The request starts with the
+// size of the rest of the request, sent along with the client's standard
+// input, output and error as SCM_RIGHTS. The rest is the client's working
+// directory followed by the job's arguments, each terminated by '\0'. The
+// child acknowledges the request before it starts the job, and replies with
+// the job's exit status once it is done. A client that doesn't get the
+// acknowledgement compiles the job itself. Once the job has started, it may
+// have written output and diagnostics, so it must not be run again.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/AST/DiagnosticEngine.h"
+#include "swift/AST/DiagnosticsFrontend.h"
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstring>
+
+#if LLVM_ON_UNIX
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace swift;
+
+using CompileJobFn = int(ArrayRef<const char *> Args);
+
+#if LLVM_ON_UNIX
+
+namespace {
+/// Closes a file descriptor when it goes out of scope.
+class FileDescriptor {
+  int FD;
+
+public:
+  explicit FileDescriptor(int FD) : FD(FD) {}
+  FileDescriptor(const FileDescriptor &) = delete;
+  FileDescriptor &operator=(const FileDescriptor &) = delete;
+  ~FileDescriptor() {
+    if (FD >= 0)
+      close(FD);
+  }
+
+  int get() const { return FD; }
+  explicit operator bool() const { return FD >= 0; }
+};
+} // end anonymous namespace
+
+/// The job's standard input, output and error.
+static const unsigned NumForwardedFDs = 3;
+
+/// Sent by the child once it has received the request, before the job starts.
+static const char JobStarted = 'S';
+
+#ifdef MSG_NOSIGNAL
+static const int SendFlags = MSG_NOSIGNAL;
+#else
+static const int SendFlags = 0;
+#endif
+
+/// Keeps a write to \p FD from raising SIGPIPE if the other end has gone away.
+static void disableSigPipe(int FD) {
+#ifdef SO_NOSIGPIPE
+  int One = 1;
+  (void)setsockopt(FD, SOL_SOCKET, SO_NOSIGPIPE, &One, sizeof(One));
+#endif
+}
+
+/// \returns true if \p Path does not fit in a socket address.
+static bool getSocketAddress(StringRef Path, sockaddr_un &Addr) {
+  if (Path.size() >= sizeof(Addr.sun_path))
+    return true;
+  memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  memcpy(Addr.sun_path, Path.data(), Path.size());
+  return false;
+}
+
+static bool sendAll(int FD, const char *Data, size_t Size) {
+  while (Size) {
+    ssize_t Sent = send(FD, Data, Size, SendFlags);
+    if (Sent < 0) {
+      if (errno == EINTR)
+        continue;
+      return true;
+    }
+    Data += Sent;
+    Size -= Sent;
+  }
+  return false;
+}
+
+static bool readAll(int FD, char *Data, size_t Size) {
+  while (Size) {
+    ssize_t Read = read(FD, Data, Size);
+    if (Read < 0) {
+      if (errno == EINTR)
+        continue;
+      return true;
+    }
+    if (Read == 0)
+      return true;
+    Data += Read;
+    Size -= Read;
+  }
+  return false;
+}
+
+namespace {
+/// Room for the SCM_RIGHTS message carrying the forwarded descriptors.
+union ControlBuffer {
+  cmsghdr Align;
+  char Buf[CMSG_SPACE(sizeof(int) * NumForwardedFDs)];
+};
+} // end anonymous namespace
+
+static bool sendRequest(int FD, StringRef Payload) {
+  uint32_t Size = Payload.size();
+  iovec IOV = { &Size, sizeof(Size) };
+
+  ControlBuffer Control;
+  memset(&Control, 0, sizeof(Control));
+
+  msghdr Msg;
+  memset(&Msg, 0, sizeof(Msg));
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control.Buf;
+  Msg.msg_controllen = sizeof(Control.Buf);
+
+  cmsghdr *CMsg = CMSG_FIRSTHDR(&Msg);
+  CMsg->cmsg_level = SOL_SOCKET;
+  CMsg->cmsg_type = SCM_RIGHTS;
+  CMsg->cmsg_len = CMSG_LEN(sizeof(int) * NumForwardedFDs);
+  int FDs[NumForwardedFDs] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+  memcpy(CMSG_DATA(CMsg), FDs, sizeof(FDs));
+
+  ssize_t Sent;
+  do {
+    Sent = sendmsg(FD, &Msg, SendFlags);
+  } while (Sent < 0 && errno == EINTR);
+  if (Sent != sizeof(Size))
+    return true;
+
+  return sendAll(FD, Payload.data(), Payload.size());
+}
+
+static bool receiveRequest(int FD, int (&FDs)[NumForwardedFDs],
+                           std::string &Payload) {
+  uint32_t Size;
+  iovec IOV = { &Size, sizeof(Size) };
+
+  ControlBuffer Control;
+  memset(&Control, 0, sizeof(Control));
+
+  msghdr Msg;
+  memset(&Msg, 0, sizeof(Msg));
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control.Buf;
+  Msg.msg_controllen = sizeof(Control.Buf);
+
+  ssize_t Received;
+  do {
+    Received = recvmsg(FD, &Msg, 0);
+  } while (Received < 0 && errno == EINTR);
+  if (Received != sizeof(Size))
+    return true;
+
+  cmsghdr *CMsg = CMSG_FIRSTHDR(&Msg);
+  if (!CMsg || CMsg->cmsg_level != SOL_SOCKET ||
+      CMsg->cmsg_type != SCM_RIGHTS ||
+      CMsg->cmsg_len != CMSG_LEN(sizeof(FDs)))
+    return true;
+  memcpy(FDs, CMSG_DATA(CMsg), sizeof(FDs));
+
+  Payload.resize(Size);
+  return readAll(FD, &Payload[0], Size);
+}
+
+/// Compiles the job sent over \p Conn and replies with its exit status. Runs
+/// in the child forked for the connection and never returns.
+static void serveJob(int Conn, llvm::function_ref<CompileJobFn> RunJob) {
+  disableSigPipe(Conn);
+
+  int FDs[NumForwardedFDs];
+  std::string Payload;
+  if (receiveRequest(Conn, FDs, Payload) || Payload.empty() ||
+      Payload.back() != '\0' ||
+      sendAll(Conn, &JobStarted, sizeof(JobStarted)))
+    _exit(1);
+
+  for (int i = 0; i != int(NumForwardedFDs); ++i) {
+    if (FDs[i] == i)
+      continue;
+    dup2(FDs[i], i);
+    close(FDs[i]);
+  }
+
+  // The working directory comes first, then the arguments.
+  SmallVector<const char *, 64> Strings;
+  for (size_t i = 0, e = Payload.size(); i < e; i += strlen(&Payload[i]) + 1)
+    Strings.push_back(&Payload[i]);
+
+  int32_t Status;
+  if (chdir(Strings.front()) != 0) {
+    llvm::errs() << "error: compile server cannot change to '"
+                 << Strings.front() << "' (" << llvm::sys::StrError() << ")\n";
+    Status = 1;
+  } else {
+    Status = RunJob(llvm::makeArrayRef(Strings).slice(1));
+  }
+
+  // Do what returning from main would have done, such as printing the
+  // statistics, before telling the client that the job is done.
+  llvm::llvm_shutdown();
+  llvm::outs().flush();
+
+  (void)sendAll(Conn, reinterpret_cast<const char *>(&Status),
+                sizeof(Status));
+  exit(Status);
+}
+
+int serveCompileJobs(StringRef SocketPath, unsigned IdleTimeout,
+                     DiagnosticEngine &Diags,
+                     llvm::function_ref<CompileJobFn> RunJob) {
+  sockaddr_un Addr;
+  if (getSocketAddress(SocketPath, Addr)) {
+    Diags.diagnose(SourceLoc(), diag::error_compile_server_socket, SocketPath,
+                   "path is too long");
+    return 1;
+  }
+
+  auto diagnoseSocketError = [&]() -> int {
+    Diags.diagnose(SourceLoc(), diag::error_compile_server_socket, SocketPath,
+                   llvm::sys::StrError());
+    return 1;
+  };
+
+  FileDescriptor Listener(socket(AF_UNIX, SOCK_STREAM, 0));
+  if (!Listener)
+    return diagnoseSocketError();
+
+  // A server that was killed leaves its socket behind.
+  (void)unlink(Addr.sun_path);
+  if (bind(Listener.get(), reinterpret_cast<sockaddr *>(&Addr),
+           sizeof(Addr)) != 0 ||
+      listen(Listener.get(), SOMAXCONN) != 0)
+    return diagnoseSocketError();
+
+  // Nothing waits for the children; let the system reap them.
+  signal(SIGCHLD, SIG_IGN);
+
+  // Don't let every child print what the server had buffered.
+  llvm::outs().flush();
+
+  while (true) {
+    if (IdleTimeout) {
+      pollfd PollFD = { Listener.get(), POLLIN, 0 };
+      int Ready = poll(&PollFD, 1, IdleTimeout * 1000);
+      if (Ready < 0 && errno != EINTR)
+        return diagnoseSocketError();
+      if (Ready == 0) {
+        // Nobody has sent a job for a while; stop serving.
+        (void)unlink(Addr.sun_path);
+        return 0;
+      }
+      if (Ready < 0)
+        continue;
+    }
+
+    int Conn = accept(Listener.get(), nullptr, nullptr);
+    if (Conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      return diagnoseSocketError();
+    }
+
+    // If the fork fails, the client sees the connection close and compiles
+    // the job itself.
+    if (fork() == 0) {
+      signal(SIGCHLD, SIG_DFL);
+      close(Listener.get());
+      serveJob(Conn, RunJob);
+    }
+    close(Conn);
+  }
+}
+
+Optional<int> sendToCompileServer(StringRef SocketPath,
+                                  ArrayRef<const char *> Args) {
+  sockaddr_un Addr;
+  if (getSocketAddress(SocketPath, Addr))
+    return None;
+
+  FileDescriptor Conn(socket(AF_UNIX, SOCK_STREAM, 0));
+  if (!Conn)
+    return None;
+  disableSigPipe(Conn.get());
+  if (connect(Conn.get(), reinterpret_cast<sockaddr *>(&Addr),
+              sizeof(Addr)) != 0)
+    return None;
+
+  SmallString<128> WorkingDirectory;
+  if (llvm::sys::fs::current_path(WorkingDirectory))
+    return None;
+
+  std::string Payload(WorkingDirectory.begin(), WorkingDirectory.end());
+  Payload.push_back('\0');
+  for (const char *Arg : Args) {
+    Payload += Arg;
+    Payload.push_back('\0');
+  }
+
+  if (sendRequest(Conn.get(), Payload))
+    return None;
+
+  // If the server went away before starting the job, it's compiled here.
+  char Started;
+  if (readAll(Conn.get(), &Started, sizeof(Started)) || Started != JobStarted)
+    return None;
+
+  // Once the job has started, it may have written diagnostics and outputs
+  // already, so running it again would duplicate them.
+  int32_t Status;
+  if (readAll(Conn.get(), reinterpret_cast<char *>(&Status), sizeof(Status))) {
+    llvm::errs() << "error: compile server exited before finishing the job\n";
+    return 1;
+  }
+  return Status;
+}
+
+#else
+
+int serveCompileJobs(StringRef SocketPath, unsigned IdleTimeout,
+                     DiagnosticEngine &Diags,
+                     llvm::function_ref<CompileJobFn> RunJob) {
+  Diags.diagnose(SourceLoc(), diag::error_compile_server_socket, SocketPath,
+                 "not supported on this platform");
+  return 1;
+}
+
+Optional<int> sendToCompileServer(StringRef SocketPath,
+                                  ArrayRef<const char *> Args) {
+  return None;
+}
+
+#endif
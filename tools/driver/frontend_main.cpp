@@ -18,6 +18,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "swift/Subsystems.h"
+#include "swift/Strings.h"
+#include "swift/AST/ASTWalker.h"
 #include "swift/AST/DiagnosticsFrontend.h"
 #include "swift/AST/DiagnosticsSema.h"
 #include "swift/AST/IRGenOptions.h"
@@ -28,6 +30,7 @@
 #include "swift/Basic/Dwarf.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/FileSystem.h"
+#include "swift/Basic/ReferenceDependencies.h"
 #include "swift/Basic/SourceManager.h"
 #include "swift/Basic/Timer.h"
 #include "swift/Frontend/DiagnosticVerifier.h"
@@ -36,6 +39,7 @@
 #include "swift/Frontend/SerializedDiagnosticConsumer.h"
 #include "swift/Immediate/Immediate.h"
 #include "swift/Option/Options.h"
+#include "swift/Parse/Token.h"
 #include "swift/PrintAsObjC/PrintAsObjC.h"
 #include "swift/Serialization/SerializationOptions.h"
 #include "swift/SILOptimizer/PassManager/Passes.h"
@@ -44,6 +48,7 @@
 // This API should be sunk down to LLVM.
 #include "clang/Frontend/CompilerInstance.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -51,11 +56,11 @@
 #include "llvm/Option/Option.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/Timer.h"
-#include "llvm/Support/YAMLParser.h"
 
 #include <memory>
 #include <unordered_set>
@@ -175,6 +180,152 @@ static std::string mangleTypeAsContext(const NominalTypeDecl *type) {
   return mangler.finalize();
 }
 
+namespace {
+/// Computes fingerprints for the declarations that a source file provides.
+///
+/// A fingerprint hashes the tokens that spell a declaration, leaving out the
+/// bodies of any functions and accessors inside it. Editing a body or a
+/// comment therefore leaves every fingerprint as it was.
+class DeclFingerprinter : private ASTWalker {
+  const SourceFile &SF;
+  const SourceManager &SM;
+  unsigned BufferID;
+  std::vector<Token> Tokens;
+  std::vector<unsigned> TokenOffsets;
+
+  /// The half-open offset ranges of all function bodies, in source order.
+  std::vector<std::pair<unsigned, unsigned>> Bodies;
+
+  unsigned getOffset(SourceLoc loc) const {
+    return SM.getLocOffsetInBuffer(loc, BufferID);
+  }
+
+  void noteBody(const AbstractFunctionDecl *AFD) {
+    if (!AFD)
+      return;
+    SourceRange body = AFD->getBodySourceRange();
+    if (body.isInvalid())
+      return;
+    // The body ends with a '}', so its last character is at body.End.
+    Bodies.push_back({getOffset(body.Start), getOffset(body.End) + 1});
+  }
+
+  bool walkToDeclPre(Decl *D) override {
+    if (auto *AFD = dyn_cast<AbstractFunctionDecl>(D)) {
+      noteBody(AFD);
+    } else if (auto *ASD = dyn_cast<AbstractStorageDecl>(D)) {
+      noteBody(ASD->getGetter());
+      noteBody(ASD->getSetter());
+    }
+    return true;
+  }
+
+  bool isInThisFile(const Decl *D) const {
+    return D->getStartLoc().isValid() &&
+           D->getDeclContext()->getParentSourceFile() == &SF;
+  }
+
+  SourceLoc getStartLocIncludingAttrs(const Decl *D) const {
+    SourceLoc start = D->getStartLoc();
+    for (auto *attr : D->getAttrs()) {
+      SourceLoc attrStart = attr->getRangeWithAt().Start;
+      if (attrStart.isValid() && SM.isBeforeInBuffer(attrStart, start))
+        start = attrStart;
+    }
+    return start;
+  }
+
+  /// Hashes the tokens in the half-open offset range [begin, end) that are
+  /// not part of a function body.
+  void addTokens(llvm::MD5 &hash, unsigned begin, unsigned end) const {
+    auto body = std::lower_bound(Bodies.begin(), Bodies.end(),
+                                 std::make_pair(begin, 0U));
+    size_t i = std::lower_bound(TokenOffsets.begin(), TokenOffsets.end(),
+                                begin) - TokenOffsets.begin();
+    for (size_t e = Tokens.size(); i != e && TokenOffsets[i] < end; ++i) {
+      unsigned offset = TokenOffsets[i];
+      while (body != Bodies.end() && body->second <= offset)
+        ++body;
+      if (body != Bodies.end() && body->first <= offset)
+        continue;
+
+      hash.update(Tokens[i].getText());
+      // Separate tokens the same way the interface hash does.
+      uint8_t separator[1] = {0};
+      hash.update(separator);
+    }
+  }
+
+public:
+  explicit DeclFingerprinter(SourceFile &SF)
+      : SF(SF), SM(SF.getASTContext().SourceMgr),
+        BufferID(SF.getBufferID().getValue()) {
+    Tokens = tokenize(SF.getASTContext().LangOpts, SM, BufferID,
+                      /*Offset=*/0, /*EndOffset=*/0, /*KeepComments=*/false);
+    TokenOffsets.reserve(Tokens.size());
+    for (const Token &Tok : Tokens)
+      TokenOffsets.push_back(getOffset(Tok.getLoc()));
+
+    SF.walk(*this);
+    std::sort(Bodies.begin(), Bodies.end());
+  }
+
+  /// Hashes all of \p D. A variable is hashed along with the rest of its
+  /// pattern binding, so that its type annotation and initializer count.
+  void addDecl(llvm::MD5 &hash, const Decl *D) const {
+    if (!isInThisFile(D))
+      return;
+    if (auto *VD = dyn_cast<VarDecl>(D))
+      if (auto *PBD = VD->getParentPatternBinding())
+        if (PBD->getStartLoc().isValid())
+          D = PBD;
+    addTokens(hash, getOffset(getStartLocIncludingAttrs(D)),
+              getOffset(D->getEndLoc()) + 1);
+  }
+
+  /// Hashes the part of a type or extension declaration that comes before
+  /// its members.
+  void addHeader(llvm::MD5 &hash, const Decl *D, SourceRange braces) const {
+    if (!isInThisFile(D) || braces.isInvalid())
+      return;
+    addTokens(hash, getOffset(getStartLocIncludingAttrs(D)),
+              getOffset(braces.Start));
+  }
+
+  /// Hashes the members of \p NTD that decide its layout and its implicit
+  /// members, whatever their accessibility: stored properties, enum cases and
+  /// initializers. Users of the type have to be rebuilt when these change,
+  /// even if they only use members whose own fingerprints stay the same.
+  void addLayout(llvm::MD5 &hash, const NominalTypeDecl *NTD) const {
+    for (const Decl *member : NTD->getMembers(/*forceDelayed=*/false)) {
+      if (auto *VD = dyn_cast<VarDecl>(member)) {
+        if (VD->isStatic() || !VD->hasStorage())
+          continue;
+      } else if (!isa<EnumCaseDecl>(member) &&
+                 !isa<ConstructorDecl>(member)) {
+        continue;
+      }
+      addDecl(hash, member);
+    }
+  }
+
+  /// Hashes the members of a type or extension declaration.
+  void addMembers(llvm::MD5 &hash, const Decl *D, SourceRange braces) const {
+    if (!isInThisFile(D) || braces.isInvalid())
+      return;
+    addTokens(hash, getOffset(braces.Start), getOffset(braces.End) + 1);
+  }
+
+  static std::string finish(llvm::MD5 &hash) {
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+    llvm::SmallString<32> str;
+    llvm::MD5::stringifyResult(result, str);
+    return str.str();
+  }
+};
+} // end anonymous namespace
+
 /// Emits a Swift-style dependencies file.
 static bool emitReferenceDependencies(DiagnosticEngine &diags,
                                       SourceFile *SF,
@@ -197,16 +348,22 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     return true;
   }
 
-  auto escape = [](Identifier name) -> std::string {
-    return llvm::yaml::escape(name.str());
-  };
-
-  out << "### Swift dependencies file v0 ###\n";
+  namespace deps = reference_dependencies;
+  std::unique_ptr<deps::Writer> writer;
+  if (opts.EmitYAMLReferenceDependencies)
+    writer = deps::createYAMLWriter(out);
+  else
+    writer = deps::createBinaryWriter(out);
 
   llvm::MapVector<const NominalTypeDecl *, bool> extendedNominals;
   llvm::SmallVector<const ExtensionDecl *, 8> extensionsWithJustMembers;
 
-  out << "provides-top-level:\n";
+  DeclFingerprinter fingerprinter(*SF);
+  llvm::MapVector<StringRef, llvm::MD5> topLevelHashes;
+  llvm::DenseMap<const NominalTypeDecl *,
+                 SmallVector<const ExtensionDecl *, 2>> extensionsInFile;
+
+  writer->beginSection(deps::Section::ProvidesTopLevel);
   for (const Decl *D : SF->Decls) {
     switch (D->getKind()) {
     case DeclKind::Module:
@@ -238,15 +395,19 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         }
       }
       extendedNominals[NTD] |= !justMembers;
+      extensionsInFile[NTD].push_back(ED);
       findNominals(extendedNominals, ED->getMembers());
       break;
     }
 
     case DeclKind::InfixOperator:
     case DeclKind::PrefixOperator:
-    case DeclKind::PostfixOperator:
-      out << "- \"" << escape(cast<OperatorDecl>(D)->getName()) << "\"\n";
+    case DeclKind::PostfixOperator: {
+      StringRef name = cast<OperatorDecl>(D)->getName().str();
+      writer->addName(name);
+      fingerprinter.addDecl(topLevelHashes[name], D);
       break;
+    }
 
     case DeclKind::Enum:
     case DeclKind::Struct:
@@ -259,7 +420,11 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           NTD->getFormalAccess() == Accessibility::Private) {
         break;
       }
-      out << "- \"" << escape(NTD->getName()) << "\"\n";
+      writer->addName(NTD->getName().str());
+      // Other members are covered by the member fingerprints.
+      llvm::MD5 &hash = topLevelHashes[NTD->getName().str()];
+      fingerprinter.addHeader(hash, NTD, NTD->getBraces());
+      fingerprinter.addLayout(hash, NTD);
       extendedNominals[NTD] |= true;
       findNominals(extendedNominals, NTD->getMembers());
       break;
@@ -275,7 +440,8 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           VD->getFormalAccess() == Accessibility::Private) {
         break;
       }
-      out << "- \"" << escape(VD->getName()) << "\"\n";
+      writer->addName(VD->getName().str());
+      fingerprinter.addDecl(topLevelHashes[VD->getName().str()], VD);
       break;
     }
 
@@ -297,21 +463,16 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     }
   }
 
-  out << "provides-nominal:\n";
+  writer->beginSection(deps::Section::ProvidesNominal);
   for (auto entry : extendedNominals) {
     if (!entry.second)
       continue;
-    out << "- \"";
-    out << mangleTypeAsContext(entry.first);
-    out << "\"\n";
+    writer->addName(mangleTypeAsContext(entry.first));
   }
 
-  out << "provides-member:\n";
-  for (auto entry : extendedNominals) {
-    out << "- [\"";
-    out << mangleTypeAsContext(entry.first);
-    out << "\", \"\"]\n";
-  }
+  writer->beginSection(deps::Section::ProvidesMember);
+  for (auto entry : extendedNominals)
+    writer->addMember(mangleTypeAsContext(entry.first), "");
 
   // This is also part of "provides-member".
   for (auto *ED : extensionsWithJustMembers) {
@@ -324,45 +485,108 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           VD->getFormalAccess() == Accessibility::Private) {
         continue;
       }
-      out << "- [\"" << mangledName << "\", \""
-          << escape(VD->getName()) << "\"]\n";
+      writer->addMember(mangledName, VD->getName().str());
     }
   }
 
+  llvm::MapVector<StringRef, llvm::MD5> dynamicLookupHashes;
   if (SF->getASTContext().LangOpts.EnableObjCInterop) {
     // FIXME: This requires a traversal of the whole file to compute.
     // We should (a) see if there's a cheaper way to keep it up to date,
     // and/or (b) see if we can fast-path cases where there's no ObjC involved.
-    out << "provides-dynamic-lookup:\n";
+    writer->beginSection(deps::Section::ProvidesDynamicLookup);
     class ValueDeclPrinter : public VisibleDeclConsumer {
     private:
-      raw_ostream &out;
-      std::string (*escape)(Identifier);
+      deps::Writer &writer;
+      const DeclFingerprinter &fingerprinter;
+      llvm::MapVector<StringRef, llvm::MD5> &hashes;
     public:
-      ValueDeclPrinter(raw_ostream &out, decltype(escape) escape)
-        : out(out), escape(escape) {}
+      ValueDeclPrinter(deps::Writer &writer,
+                       const DeclFingerprinter &fingerprinter,
+                       llvm::MapVector<StringRef, llvm::MD5> &hashes)
+        : writer(writer), fingerprinter(fingerprinter), hashes(hashes) {}
 
       void foundDecl(ValueDecl *VD, DeclVisibilityKind Reason) override {
-        out << "- \"" << escape(VD->getName()) << "\"\n";
+        writer.addName(VD->getName().str());
+        fingerprinter.addDecl(hashes[VD->getName().str()], VD);
       }
     };
-    ValueDeclPrinter printer(out, escape);
+    ValueDeclPrinter printer(*writer, fingerprinter, dynamicLookupHashes);
     SF->lookupClassMembers({}, printer);
   }
 
+  // Fingerprints let the driver tell which of the names above changed, so
+  // that only the files that use those names need to be rebuilt.
+  writer->beginSection(deps::Section::TopLevelFingerprints);
+  for (auto &entry : topLevelHashes) {
+    writer->addFingerprint(entry.first,
+                           DeclFingerprinter::finish(entry.second));
+  }
+
+  writer->beginSection(deps::Section::NominalFingerprints);
+  for (auto entry : extendedNominals) {
+    if (!entry.second)
+      continue;
+    const NominalTypeDecl *NTD = entry.first;
+    llvm::MD5 hash;
+    fingerprinter.addHeader(hash, NTD, NTD->getBraces());
+    fingerprinter.addLayout(hash, NTD);
+    for (auto *ED : extensionsInFile.lookup(NTD))
+      fingerprinter.addHeader(hash, ED, ED->getBraces());
+    writer->addFingerprint(mangleTypeAsContext(NTD),
+                           DeclFingerprinter::finish(hash));
+  }
+
+  writer->beginSection(deps::Section::MemberFingerprints);
+  for (auto entry : extendedNominals) {
+    const NominalTypeDecl *NTD = entry.first;
+    auto mangledName = mangleTypeAsContext(NTD);
+
+    llvm::MD5 allMembersHash;
+    llvm::MapVector<StringRef, llvm::MD5> memberHashes;
+    auto addMembers = [&](const Decl *D, DeclRange members,
+                          SourceRange braces) {
+      fingerprinter.addMembers(allMembersHash, D, braces);
+      for (auto *member : members) {
+        auto *VD = dyn_cast<ValueDecl>(member);
+        if (!VD || !VD->hasName() ||
+            VD->getFormalAccess() == Accessibility::Private) {
+          continue;
+        }
+        fingerprinter.addDecl(memberHashes[VD->getName().str()], VD);
+      }
+    };
+
+    addMembers(NTD, NTD->getMembers(/*forceDelayed=*/false), NTD->getBraces());
+    for (auto *ED : extensionsInFile.lookup(NTD))
+      addMembers(ED, ED->getMembers(/*forceDelayed=*/false), ED->getBraces());
+
+    writer->addMemberFingerprint(mangledName, "",
+                                 DeclFingerprinter::finish(allMembersHash));
+    for (auto &member : memberHashes) {
+      writer->addMemberFingerprint(mangledName, member.first,
+                                   DeclFingerprinter::finish(member.second));
+    }
+  }
+
+  if (SF->getASTContext().LangOpts.EnableObjCInterop) {
+    writer->beginSection(deps::Section::DynamicLookupFingerprints);
+    for (auto &entry : dynamicLookupHashes) {
+      writer->addFingerprint(entry.first,
+                             DeclFingerprinter::finish(entry.second));
+    }
+  }
+
   ReferencedNameTracker *tracker = SF->getReferencedNameTracker();
 
   // FIXME: Sort these?
-  out << "depends-top-level:\n";
+  writer->beginSection(deps::Section::DependsTopLevel);
   for (auto &entry : tracker->getTopLevelNames()) {
     assert(!entry.first.empty());
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "\"" << escape(entry.first) << "\"\n";
+    writer->addName(entry.first.str(), entry.second);
   }
 
-  out << "depends-member:\n";
+  writer->beginSection(deps::Section::DependsMember);
   auto &memberLookupTable = tracker->getUsedMembers();
   using TableEntryTy = std::pair<ReferencedNameTracker::MemberPair, bool>;
   std::vector<TableEntryTy> sortedMembers{
@@ -389,18 +613,14 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         entry.first.first->getFormalAccess() == Accessibility::Private)
       continue;
 
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "[\"";
-    out << mangleTypeAsContext(entry.first.first);
-    out << "\", \"";
+    StringRef memberName;
     if (!entry.first.second.empty())
-      out << escape(entry.first.second);
-    out << "\"]\n";
+      memberName = entry.first.second.str();
+    writer->addMember(mangleTypeAsContext(entry.first.first), memberName,
+                      entry.second);
   }
 
-  out << "depends-nominal:\n";
+  writer->beginSection(deps::Section::DependsNominal);
   for (auto i = sortedMembers.begin(), e = sortedMembers.end(); i != e; ++i) {
     bool isCascading = i->second;
     while (i+1 != e && i[0].first.first == i[1].first.first) {
@@ -412,32 +632,24 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         i->first.first->getFormalAccess() == Accessibility::Private)
       continue;
 
-    out << "- ";
-    if (!isCascading)
-      out << "!private ";
-    out << "\"";
-    out <<  mangleTypeAsContext(i->first.first);
-    out << "\"\n";
+    writer->addName(mangleTypeAsContext(i->first.first), isCascading);
   }
 
   // FIXME: Sort these?
-  out << "depends-dynamic-lookup:\n";
+  writer->beginSection(deps::Section::DependsDynamicLookup);
   for (auto &entry : tracker->getDynamicLookupNames()) {
     assert(!entry.first.empty());
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "\"" << escape(entry.first) << "\"\n";
+    writer->addName(entry.first.str(), entry.second);
   }
 
-  out << "depends-external:\n";
-  for (auto &entry : depTracker.getDependencies()) {
-    out << "- \"" << llvm::yaml::escape(entry) << "\"\n";
-  }
+  writer->beginSection(deps::Section::DependsExternal);
+  for (auto &entry : depTracker.getDependencies())
+    writer->addName(entry);
 
   llvm::SmallString<32> interfaceHash;
   SF->getInterfaceHash(interfaceHash);
-  out << "interface-hash: \"" << interfaceHash << "\"\n";
+  writer->setInterfaceHash(interfaceHash);
+  writer->finish();
 
   return false;
 }
@@ -590,6 +802,51 @@ private:
   }
 };
 
+/// In batch mode, sends each diagnostic to the consumer of the primary input
+/// it occurs in, so that every file gets its own serialized diagnostics.
+/// Diagnostics without a location, or located in some other file, go to all
+/// of them; notes follow the diagnostic they are attached to.
+class BatchDiagnosticConsumer : public DiagnosticConsumer {
+  using Entry = std::pair<std::string, std::unique_ptr<DiagnosticConsumer>>;
+  SmallVector<Entry, 4> Consumers;
+
+  /// Where the last diagnostic other than a note went, or null if it was
+  /// sent to every consumer.
+  DiagnosticConsumer *LastConsumer = nullptr;
+
+public:
+  void addConsumer(StringRef InputFilename,
+                   std::unique_ptr<DiagnosticConsumer> Consumer) {
+    Consumers.emplace_back(InputFilename, std::move(Consumer));
+  }
+
+private:
+  DiagnosticConsumer *findConsumer(SourceManager &SM, SourceLoc Loc) {
+    if (Loc.isInvalid())
+      return nullptr;
+    StringRef BufferName =
+      SM.getIdentifierForBuffer(SM.findBufferContainingLoc(Loc));
+    for (auto &Entry : Consumers)
+      if (Entry.first == BufferName)
+        return Entry.second.get();
+    return nullptr;
+  }
+
+  void handleDiagnostic(SourceManager &SM, SourceLoc Loc,
+                        DiagnosticKind Kind, StringRef Text,
+                        const DiagnosticInfo &Info) override {
+    if (Kind != DiagnosticKind::Note)
+      LastConsumer = findConsumer(SM, Loc);
+
+    if (LastConsumer) {
+      LastConsumer->handleDiagnostic(SM, Loc, Kind, Text, Info);
+      return;
+    }
+    for (auto &Entry : Consumers)
+      Entry.second->handleDiagnostic(SM, Loc, Kind, Text, Info);
+  }
+};
+
 } // anonymous namespace
 
 // This is a separate function so that it shows up in stack traces.
@@ -606,6 +863,11 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
+static bool performCompileStepsPostSema(CompilerInstance &Instance,
+                                        CompilerInvocation &Invocation,
+                                        const FrontendOptions &opts,
+                                        int &ReturnValue);
+
 /// Performs the compile requested by the user.
 /// \returns true on error
 static bool performCompile(CompilerInstance &Instance,
@@ -710,13 +972,57 @@ static bool performCompile(CompilerInstance &Instance,
   if (opts.PrintClangStats && Context.getClangModuleLoader())
     Context.getClangModuleLoader()->printStatistics();
 
+  if (!opts.isBatchMode())
+    return performCompileStepsPostSema(Instance, Invocation, opts,
+                                       ReturnValue);
+
+  // Everything up to here is shared by the whole batch. Generate output for
+  // each primary input in turn, carrying on after errors so that every entry
+  // still gets its dependency files.
+  bool HadError = false;
+  for (unsigned i = 0, e = opts.Batch.size(); i != e; ++i) {
+    FrontendOptions EntryOpts = opts;
+    EntryOpts.selectBatchEntry(i);
+    Instance.selectBatchPrimarySourceFile(i);
+    HadError |= performCompileStepsPostSema(Instance, Invocation, EntryOpts,
+                                            ReturnValue);
+  }
+  return HadError;
+}
+
+/// Performs everything after type-checking for the primary input selected in
+/// \p opts, or for the whole module if there is none.
+/// \returns true on error
+static bool performCompileStepsPostSema(CompilerInstance &Instance,
+                                        CompilerInvocation &Invocation,
+                                        const FrontendOptions &opts,
+                                        int &ReturnValue) {
+  FrontendOptions::ActionType Action = opts.RequestedAction;
+  ASTContext &Context = Instance.getASTContext();
+  SourceFile *PrimarySourceFile = Instance.getPrimarySourceFile();
+
+  // Work on a copy, since the flags below are specific to this primary input.
+  IRGenOptions IRGenOpts = Invocation.getIRGenOptions();
+  if (opts.isBatchMode()) {
+    IRGenOpts.MainInputFilename =
+      opts.InputFilenames[opts.PrimaryInput->Index];
+    IRGenOpts.OutputFilenames = opts.OutputFilenames;
+  }
+
   if (!opts.DependenciesFilePath.empty())
     (void)emitMakeDependencies(Context.Diags, *Instance.getDependencyTracker(),
                                opts);
 
-  if (shouldTrackReferences)
+  // The driver finds the files to rebuild by comparing the dependencies it
+  // loaded at the start of the build with the ones written here, so a failed
+  // compile must leave those of the last successful one in place.
+  StringRef referenceDependenciesPath = opts.ReferenceDependenciesFilePath;
+  if (!referenceDependenciesPath.empty() &&
+      (!Context.hadError() || referenceDependenciesPath == "-" ||
+       !llvm::sys::fs::exists(referenceDependenciesPath))) {
     emitReferenceDependencies(Context.Diags, Instance.getPrimarySourceFile(),
                               *Instance.getDependencyTracker(), opts);
+  }
 
   if (Context.hadError())
     return true;
@@ -993,54 +1299,21 @@ static bool dumpAPI(Module *Mod, StringRef OutDir) {
   return false;
 }
 
-int frontend_main(ArrayRef<const char *>Args,
-                  const char *Argv0, void *MainAddr) {
-  llvm::InitializeAllTargets();
-  llvm::InitializeAllTargetMCs();
-  llvm::InitializeAllAsmPrinters();
-  llvm::InitializeAllAsmParsers();
-
-  CompilerInstance Instance;
-  PrintingDiagnosticConsumer PDC;
-  Instance.addDiagnosticConsumer(&PDC);
-
-  if (Args.empty()) {
-    Instance.getDiags().diagnose(SourceLoc(), diag::error_no_frontend_args);
-    return 1;
-  }
-
-  CompilerInvocation Invocation;
-  std::string MainExecutablePath = llvm::sys::fs::getMainExecutable(Argv0,
-                                                                    MainAddr);
-  Invocation.setMainExecutablePath(MainExecutablePath);
-
-  SmallString<128> workingDirectory;
-  llvm::sys::fs::current_path(workingDirectory);
-
-  // Parse arguments.
-  if (Invocation.parseArgs(Args, Instance.getDiags(), workingDirectory)) {
-    return 1;
-  }
-
+/// Compiles the job described by \p Invocation, which was parsed from
+/// \p Args, with \p Instance.
+///
+/// \p Instance is either fresh or has been set up by runCompileServer() with
+/// an ASTContext that \p Invocation is compatible with.
+static int performFrontend(CompilerInstance &Instance,
+                           PrintingDiagnosticConsumer &PDC,
+                           CompilerInvocation &Invocation,
+                           ArrayRef<const char *> Args) {
   // Setting DWARF Version depend on platform
   IRGenOptions &IRGenOpts = Invocation.getIRGenOptions();
   IRGenOpts.DWARFVersion = swift::GenericDWARFVersion;
   if (Invocation.getLangOptions().Target.isWindowsCygwinEnvironment())
     IRGenOpts.DWARFVersion = swift::CygwinDWARFVersion;
 
-  if (Invocation.getFrontendOptions().PrintHelp ||
-      Invocation.getFrontendOptions().PrintHelpHidden) {
-    unsigned IncludedFlagsBitmask = options::FrontendOption;
-    unsigned ExcludedFlagsBitmask =
-      Invocation.getFrontendOptions().PrintHelpHidden ? 0 :
-                                                        llvm::opt::HelpHidden;
-    std::unique_ptr<llvm::opt::OptTable> Options(createSwiftOptTable());
-    Options->PrintHelp(llvm::outs(), displayName(MainExecutablePath).c_str(),
-                       "Swift frontend", IncludedFlagsBitmask,
-                       ExcludedFlagsBitmask);
-    return 0;
-  }
-
   if (Invocation.getFrontendOptions().RequestedAction ==
         FrontendOptions::NoneAction) {
     Instance.getDiags().diagnose(SourceLoc(),
@@ -1052,9 +1325,9 @@ int frontend_main(ArrayRef<const char *>Args,
   // CompilerInvocation::parseArgs are included in the serialized file.
   std::unique_ptr<DiagnosticConsumer> SerializedConsumer;
   {
-    const std::string &SerializedDiagnosticsPath =
-      Invocation.getFrontendOptions().SerializedDiagnosticsPath;
-    if (!SerializedDiagnosticsPath.empty()) {
+    auto createSerializedConsumer =
+        [&](const std::string &SerializedDiagnosticsPath)
+          -> std::unique_ptr<DiagnosticConsumer> {
       std::error_code EC;
       std::unique_ptr<llvm::raw_fd_ostream> OS;
       OS.reset(new llvm::raw_fd_ostream(SerializedDiagnosticsPath,
@@ -1065,11 +1338,32 @@ int frontend_main(ArrayRef<const char *>Args,
         Instance.getDiags().diagnose(SourceLoc(),
                                      diag::cannot_open_serialized_file,
                                      SerializedDiagnosticsPath, EC.message());
-        return 1;
+        return nullptr;
       }
 
-      SerializedConsumer.reset(
+      return std::unique_ptr<DiagnosticConsumer>(
           serialized_diagnostics::createConsumer(std::move(OS)));
+    };
+
+    const FrontendOptions &opts = Invocation.getFrontendOptions();
+    if (!opts.SerializedDiagnosticsPath.empty()) {
+      if (opts.isBatchMode()) {
+        auto BatchConsumer = llvm::make_unique<BatchDiagnosticConsumer>();
+        for (auto &Entry : opts.Batch) {
+          auto Consumer =
+            createSerializedConsumer(Entry.SerializedDiagnosticsPath);
+          if (!Consumer)
+            return 1;
+          BatchConsumer->addConsumer(opts.InputFilenames[Entry.Input.Index],
+                                     std::move(Consumer));
+        }
+        SerializedConsumer = std::move(BatchConsumer);
+      } else {
+        SerializedConsumer =
+          createSerializedConsumer(opts.SerializedDiagnosticsPath);
+        if (!SerializedConsumer)
+          return 1;
+      }
       Instance.addDiagnosticConsumer(SerializedConsumer.get());
     }
   }
@@ -1113,13 +1407,21 @@ int frontend_main(ArrayRef<const char *>Args,
   }
 
   DependencyTracker depTracker;
-  if (!Invocation.getFrontendOptions().DependenciesFilePath.empty() ||
-      !Invocation.getFrontendOptions().ReferenceDependenciesFilePath.empty()) {
-    Instance.setDependencyTracker(&depTracker);
-  }
+  if (Instance.hasASTContext()) {
+    // The module loaders of a reused ASTContext already report to the
+    // instance's own dependency tracker.
+    if (Instance.setupReusingASTContext(Invocation))
+      return 1;
+  } else {
+    const FrontendOptions &opts = Invocation.getFrontendOptions();
+    if (!opts.DependenciesFilePath.empty() ||
+        !opts.ReferenceDependenciesFilePath.empty()) {
+      Instance.setDependencyTracker(&depTracker);
+    }
 
-  if (Instance.setup(Invocation)) {
-    return 1;
+    if (Instance.setup(Invocation)) {
+      return 1;
+    }
   }
 
   int ReturnValue = 0;
@@ -1145,3 +1447,189 @@ int frontend_main(ArrayRef<const char *>Args,
 
   return (HadError ? 1 : ReturnValue);
 }
+
+/// Describes everything that CompilerInstance::setup() bakes into the
+/// ASTContext and its module loaders. A job can only reuse the ASTContext of
+/// a compile server if this is the same for both of them.
+static std::string getSharedContextKey(const CompilerInvocation &Invocation) {
+  std::string Key;
+  llvm::raw_string_ostream Out(Key);
+  auto addList = [&Out](ArrayRef<std::string> Values) {
+    Out << Values.size() << ':';
+    for (const std::string &Value : Values)
+      Out << Value << '\0';
+  };
+
+  const LangOptions &LangOpts = Invocation.getLangOptions();
+  Out << LangOpts.Target.str() << '\0'
+      << LangOpts.EnableObjCInterop << LangOpts.EnableAppExtensionRestrictions
+      << LangOpts.OmitNeedlessWords << LangOpts.StripNSPrefix
+      << LangOpts.Swift3Migration << LangOpts.DebuggerSupport
+      << LangOpts.NamedLazyMemberLoading << LangOpts.UseMalloc;
+
+  const SearchPathOptions &SearchPathOpts = Invocation.getSearchPathOptions();
+  Out << SearchPathOpts.SDKPath << '\0'
+      << SearchPathOpts.RuntimeResourcePath << '\0'
+      << SearchPathOpts.RuntimeLibraryPath << '\0'
+      << SearchPathOpts.RuntimeLibraryImportPath << '\0'
+      << SearchPathOpts.SkipRuntimeLibraryImportPath;
+  addList(SearchPathOpts.ImportSearchPaths);
+  addList(SearchPathOpts.FrameworkSearchPaths);
+  addList(SearchPathOpts.LibrarySearchPaths);
+
+  const ClangImporterOptions &ClangOpts = Invocation.getClangImporterOptions();
+  Out << ClangOpts.ModuleCachePath << '\0'
+      << ClangOpts.OverrideResourceDir << '\0'
+      << ClangOpts.TargetCPU << '\0'
+      << unsigned(ClangOpts.Mode) << ClangOpts.DetailedPreprocessingRecord
+      << ClangOpts.DumpClangDiagnostics << ClangOpts.ImportForwardDeclarations
+      << ClangOpts.OmitNeedlessWords << ClangOpts.InferDefaultArguments
+      << ClangOpts.UseSwiftLookupTables;
+  addList(ClangOpts.ExtraArgs);
+
+  const FrontendOptions &Opts = Invocation.getFrontendOptions();
+  Out << Opts.EnableSourceImport << Opts.EnableResilience
+      << Opts.actionIsImmediate() << Opts.ParseStdlib;
+  addList(Opts.LLVMArgs);
+
+  return Out.str();
+}
+
+int frontend_main(ArrayRef<const char *>Args,
+                  const char *Argv0, void *MainAddr);
+
+extern int serveCompileJobs(StringRef SocketPath, unsigned IdleTimeout,
+                            DiagnosticEngine &Diags,
+                            llvm::function_ref<int(ArrayRef<const char *>)>
+                              RunJob);
+extern Optional<int> sendToCompileServer(StringRef SocketPath,
+                                         ArrayRef<const char *> Args);
+
+/// Sets up \p Instance for \p Invocation and loads the standard library into
+/// it, then compiles each job sent to the compile server socket in a child
+/// process that reuses \p Instance.
+static int runCompileServer(CompilerInstance &Instance,
+                            PrintingDiagnosticConsumer &PDC,
+                            CompilerInvocation &Invocation,
+                            const char *Argv0, void *MainAddr) {
+  // The module loaders keep the tracker they were created with, so every job
+  // shares this one. The modules loaded here are dependencies of every job.
+  DependencyTracker depTracker;
+  Instance.setDependencyTracker(&depTracker);
+  if (Instance.setup(Invocation))
+    return 1;
+
+  if (!Instance.getASTContext().getStdlibModule(/*loadIfAbsent=*/true)) {
+    Instance.getDiags().diagnose(SourceLoc(),
+                                 diag::error_compile_server_missing_stdlib);
+    return 1;
+  }
+
+  std::string ContextKey = getSharedContextKey(Invocation);
+  const FrontendOptions &ServerOpts = Invocation.getFrontendOptions();
+  return serveCompileJobs(ServerOpts.CompileServerPath,
+                          ServerOpts.CompileServerIdleTimeout,
+                          Instance.getDiags(),
+                          [&](ArrayRef<const char *> Args) -> int {
+    CompilerInvocation JobInvocation;
+    JobInvocation.setMainExecutablePath(
+        llvm::sys::fs::getMainExecutable(Argv0, MainAddr));
+
+    SmallString<128> workingDirectory;
+    llvm::sys::fs::current_path(workingDirectory);
+
+    if (JobInvocation.parseArgs(Args, Instance.getDiags(), workingDirectory))
+      return 1;
+
+    // Jobs that need a different ASTContext, or that would get in each
+    // other's way by sharing one, are compiled as if there were no server.
+    const FrontendOptions &Opts = JobInvocation.getFrontendOptions();
+    if (getSharedContextKey(JobInvocation) != ContextKey ||
+        Opts.PrintHelp || Opts.PrintHelpHidden ||
+        Opts.ModuleName == STDLIB_NAME)
+      return frontend_main(Args, Argv0, MainAddr);
+
+    return performFrontend(Instance, PDC, JobInvocation, Args);
+  });
+}
+
+/// If \p Args name a compile server to send the job to, returns the path of
+/// its socket and removes the option from \p Args.
+static StringRef takeCompileServerPath(SmallVectorImpl<const char *> &Args) {
+  StringRef Path;
+  bool IsServer = false;
+  for (auto i = Args.begin(); i != Args.end();) {
+    StringRef Arg = *i;
+    if (Arg == "-compile-server")
+      IsServer = true;
+    if (Arg != "-use-compile-server" || i + 1 == Args.end()) {
+      ++i;
+      continue;
+    }
+    Path = i[1];
+    i = Args.erase(i, i + 2);
+  }
+
+  // A server is never started by another one.
+  if (IsServer)
+    return StringRef();
+  return Path;
+}
+
+int frontend_main(ArrayRef<const char *>Args,
+                  const char *Argv0, void *MainAddr) {
+  // Let a compile server do the job if there is one; otherwise, or if the
+  // server fails to, do it here.
+  SmallVector<const char *, 64> JobArgs(Args.begin(), Args.end());
+  StringRef CompileServerPath = takeCompileServerPath(JobArgs);
+  if (!CompileServerPath.empty()) {
+    if (auto Status = sendToCompileServer(CompileServerPath, JobArgs))
+      return *Status;
+  }
+  Args = JobArgs;
+
+  llvm::InitializeAllTargets();
+  llvm::InitializeAllTargetMCs();
+  llvm::InitializeAllAsmPrinters();
+  llvm::InitializeAllAsmParsers();
+
+  CompilerInstance Instance;
+  PrintingDiagnosticConsumer PDC;
+  Instance.addDiagnosticConsumer(&PDC);
+
+  if (Args.empty()) {
+    Instance.getDiags().diagnose(SourceLoc(), diag::error_no_frontend_args);
+    return 1;
+  }
+
+  CompilerInvocation Invocation;
+  std::string MainExecutablePath = llvm::sys::fs::getMainExecutable(Argv0,
+                                                                    MainAddr);
+  Invocation.setMainExecutablePath(MainExecutablePath);
+
+  SmallString<128> workingDirectory;
+  llvm::sys::fs::current_path(workingDirectory);
+
+  // Parse arguments.
+  if (Invocation.parseArgs(Args, Instance.getDiags(), workingDirectory)) {
+    return 1;
+  }
+
+  if (Invocation.getFrontendOptions().PrintHelp ||
+      Invocation.getFrontendOptions().PrintHelpHidden) {
+    unsigned IncludedFlagsBitmask = options::FrontendOption;
+    unsigned ExcludedFlagsBitmask =
+      Invocation.getFrontendOptions().PrintHelpHidden ? 0 :
+                                                        llvm::opt::HelpHidden;
+    std::unique_ptr<llvm::opt::OptTable> Options(createSwiftOptTable());
+    Options->PrintHelp(llvm::outs(), displayName(MainExecutablePath).c_str(),
+                       "Swift frontend", IncludedFlagsBitmask,
+                       ExcludedFlagsBitmask);
+    return 0;
+  }
+
+  if (!Invocation.getFrontendOptions().CompileServerPath.empty())
+    return runCompileServer(Instance, PDC, Invocation, Argv0, MainAddr);
+
+  return performFrontend(Instance, PDC, Invocation, Args);
+}
@@ -1,4 +1,6 @@
 #include "swift/Driver/DependencyGraph.h"
+#include "swift/Basic/ReferenceDependencies.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace swift;
@@ -790,3 +792,261 @@ TEST(DependencyGraph, ChainedExternalPreMarked) {
   EXPECT_TRUE(graph.isMarked(0));
   EXPECT_FALSE(graph.isMarked(1));
 }
+
+namespace deps = swift::reference_dependencies;
+
+/// Writes a binary dependencies file containing \p names in \p section.
+static std::string
+makeBinary(ArrayRef<std::pair<deps::Section, ArrayRef<StringRef>>> sections,
+           StringRef interfaceHash = "") {
+  std::string result;
+  llvm::raw_string_ostream out(result);
+  auto writer = deps::createBinaryWriter(out);
+  for (auto &section : sections) {
+    writer->beginSection(section.first);
+    for (StringRef name : section.second) {
+      // Use a leading '!' to mean non-cascading, and '.' to split members.
+      bool isCascading = !name.startswith("!");
+      if (!isCascading)
+        name = name.drop_front();
+      auto parts = name.split('.');
+      if (section.first == deps::Section::ProvidesMember ||
+          section.first == deps::Section::DependsMember)
+        writer->addMember(parts.first, parts.second, isCascading);
+      else
+        writer->addName(name, isCascading);
+    }
+  }
+  if (!interfaceHash.empty())
+    writer->setInterfaceHash(interfaceHash);
+  writer->finish();
+  return out.str();
+}
+
+TEST(DependencyGraph, BinaryChained) {
+  DependencyGraph<uintptr_t> graph;
+  StringRef a[] = { "a" }, b[] = { "b" }, aMember[] = { "T.m" };
+  StringRef privateA[] = { "!a" };
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 makeBinary({{deps::Section::ProvidesTopLevel,
+                                              a},
+                                             {deps::Section::ProvidesMember,
+                                              aMember}})),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1,
+                                 makeBinary({{deps::Section::DependsMember,
+                                              aMember},
+                                             {deps::Section::ProvidesTopLevel,
+                                              b}})),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2,
+                                 makeBinary({{deps::Section::DependsTopLevel,
+                                              b}})),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(3,
+                                 makeBinary({{deps::Section::DependsTopLevel,
+                                              privateA}})),
+            LoadResult::UpToDate);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(3u, marked.size());
+  EXPECT_TRUE(contains(marked, 1));
+  EXPECT_TRUE(contains(marked, 2));
+  EXPECT_TRUE(contains(marked, 3));
+  EXPECT_TRUE(graph.isMarked(1));
+  EXPECT_TRUE(graph.isMarked(2));
+  EXPECT_FALSE(graph.isMarked(3));
+}
+
+TEST(DependencyGraph, BinaryMatchesYAML) {
+  DependencyGraph<uintptr_t> graph;
+  StringRef external[] = { "/foo" }, a[] = { "a" };
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 makeBinary({{deps::Section::DependsExternal,
+                                              external},
+                                             {deps::Section::ProvidesTopLevel,
+                                              a}}, "abc")),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, "depends-top-level: [a]"),
+            LoadResult::UpToDate);
+  EXPECT_TRUE(contains(graph.getExternalDependencies(), "/foo"));
+
+  // Reloading with a different interface hash affects downstream nodes.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 makeBinary({{deps::Section::ProvidesTopLevel,
+                                              a}}, "abc")),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(0,
+                                 makeBinary({{deps::Section::ProvidesTopLevel,
+                                              a}}, "def")),
+            LoadResult::AffectsDownstream);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markExternal(marked, "/foo");
+  EXPECT_EQ(2u, marked.size());
+  EXPECT_TRUE(graph.isMarked(0));
+  EXPECT_TRUE(graph.isMarked(1));
+}
+
+TEST(DependencyGraph, BinaryMalformed) {
+  DependencyGraph<uintptr_t> graph;
+  StringRef a[] = { "a" };
+  std::string valid = makeBinary({{deps::Section::ProvidesTopLevel, a}});
+
+  // Truncated.
+  EXPECT_EQ(graph.loadFromString(0, StringRef(valid).drop_back()),
+            LoadResult::HadError);
+  // Trailing garbage.
+  EXPECT_EQ(graph.loadFromString(1, valid + "x"), LoadResult::HadError);
+  // Only the signature.
+  EXPECT_EQ(graph.loadFromString(2, valid.substr(0, 4)),
+            LoadResult::HadError);
+}
+
+TEST(DependencyGraph, FingerprintsLimitMarking) {
+  DependencyGraph<uintptr_t> graph;
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-top-level: [a, b]\n"
+                                 "top-level-fingerprints: [[a, a1], [b, b1]]\n"
+                                 "interface-hash: \"abc\"\n"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, "depends-top-level: [a]"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, "depends-top-level: [b]"),
+            LoadResult::UpToDate);
+
+  // Nothing has been reloaded yet, so nothing is known to have changed.
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(0u, marked.size());
+
+  // Only b's fingerprint changes.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-top-level: [a, b]\n"
+                                 "top-level-fingerprints: [[a, a1], [b, b2]]\n"
+                                 "interface-hash: \"def\"\n"),
+            LoadResult::AffectsDownstream);
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_TRUE(contains(marked, 2));
+  EXPECT_FALSE(graph.isMarked(1));
+  EXPECT_TRUE(graph.isMarked(2));
+}
+
+TEST(DependencyGraph, FingerprintsUnchanged) {
+  DependencyGraph<uintptr_t> graph;
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-nominal: [a]\n"
+                                 "provides-member: [[a, \"\"], [a, m]]\n"
+                                 "nominal-fingerprints: [[a, a1]]\n"
+                                 "member-fingerprints: [[a, \"\", x1], "
+                                                       "[a, m, m1]]\n"
+                                 "interface-hash: \"abc\"\n"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, "depends-member: [[a, m]]"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, "depends-nominal: [a]"),
+            LoadResult::UpToDate);
+
+  // The interface hash changes, but none of the fingerprints do.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-nominal: [a]\n"
+                                 "provides-member: [[a, \"\"], [a, m]]\n"
+                                 "nominal-fingerprints: [[a, a1]]\n"
+                                 "member-fingerprints: [[a, \"\", x1], "
+                                                       "[a, m, m1]]\n"
+                                 "interface-hash: \"def\"\n"),
+            LoadResult::AffectsDownstream);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(0u, marked.size());
+  EXPECT_FALSE(graph.isMarked(1));
+  EXPECT_FALSE(graph.isMarked(2));
+
+  // A removed member counts as a change.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-nominal: [a]\n"
+                                 "provides-member: [[a, \"\"]]\n"
+                                 "nominal-fingerprints: [[a, a1]]\n"
+                                 "member-fingerprints: [[a, \"\", x2]]\n"
+                                 "interface-hash: \"ghi\"\n"),
+            LoadResult::AffectsDownstream);
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_TRUE(contains(marked, 1));
+  EXPECT_FALSE(graph.isMarked(2));
+}
+
+TEST(DependencyGraph, NominalFingerprintReachesMemberUsers) {
+  DependencyGraph<uintptr_t> graph;
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-nominal: [a]\n"
+                                 "provides-member: [[a, \"\"], [a, m]]\n"
+                                 "nominal-fingerprints: [[a, a1]]\n"
+                                 "member-fingerprints: [[a, \"\", x1], "
+                                                       "[a, m, m1]]\n"
+                                 "interface-hash: \"abc\"\n"),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, "depends-nominal: [a]\n"
+                                    "depends-member: [[a, m]]"),
+            LoadResult::UpToDate);
+
+  // A private stored property is added: a's layout changes, but m's
+  // fingerprint does not.
+  EXPECT_EQ(graph.loadFromString(0,
+                                 "provides-nominal: [a]\n"
+                                 "provides-member: [[a, \"\"], [a, m]]\n"
+                                 "nominal-fingerprints: [[a, a2]]\n"
+                                 "member-fingerprints: [[a, \"\", x2], "
+                                                       "[a, m, m1]]\n"
+                                 "interface-hash: \"def\"\n"),
+            LoadResult::AffectsDownstream);
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_TRUE(contains(marked, 1));
+  EXPECT_TRUE(graph.isMarked(1));
+}
+
+TEST(DependencyGraph, BinaryFingerprints) {
+  DependencyGraph<uintptr_t> graph;
+  StringRef a[] = { "a" };
+  StringRef fingerprint1[] = { StringRef("a\0a1", 4) };
+  StringRef fingerprint2[] = { StringRef("a\0a2", 4) };
+  StringRef missingFingerprint[] = { StringRef("a\0", 2) };
+
+  const auto fingerprints = deps::Section::TopLevelFingerprints;
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 makeBinary({{deps::Section::ProvidesTopLevel,
+                                              a},
+                                             {fingerprints, fingerprint1}},
+                                            "abc")),
+            LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, "depends-top-level: [a]"),
+            LoadResult::UpToDate);
+
+  EXPECT_EQ(graph.loadFromString(0,
+                                 makeBinary({{deps::Section::ProvidesTopLevel,
+                                              a},
+                                             {fingerprints, fingerprint2}},
+                                            "def")),
+            LoadResult::AffectsDownstream);
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(1u, marked.size());
+  EXPECT_TRUE(contains(marked, 1));
+
+  EXPECT_EQ(graph.loadFromString(2,
+                                 makeBinary({{fingerprints,
+                                              missingFingerprint}})),
+            LoadResult::HadError);
+}
@@ -13,9 +13,13 @@
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Concurrent.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iterator>
 #include <functional>
 #include <sys/mman.h>
+#include <thread>
 #include <vector>
 #include <pthread.h>
 
@@ -225,6 +229,7 @@ TEST(Concurrent, ConcurrentMap) {
     int compareWithKey(size_t key) const {
       return (key == Key ? 0 : (key < Key ? -1 : 1));
     }
+    static size_t getKeyHash(size_t key) { return key; }
     static size_t getExtraAllocationSize(size_t key) { return 0; }
   };
 
@@ -248,6 +253,99 @@ TEST(Concurrent, ConcurrentMap) {
   }
 }
 
+TEST(Concurrent, ConcurrentMapGrowth) {
+  // Enough elements to force the table to be resized several times while
+  // other threads are inserting and looking up.
+  const int numElem = 5000;
+
+  struct Entry {
+    size_t Key;
+    Entry(size_t key) : Key(key) {}
+    int compareWithKey(size_t key) const {
+      return (key == Key ? 0 : (key < Key ? -1 : 1));
+    }
+    static size_t getKeyHash(size_t key) { return key * 0x27d4eb2d; }
+    static size_t getExtraAllocationSize(size_t key) { return 0; }
+  };
+
+  ConcurrentMap<Entry> Map;
+
+  auto results = RaceTest<Entry*, 16>(
+    [&]() -> Entry* {
+      for (int i = 0; i < numElem; i++) {
+        auto result = Map.getOrInsert(size_t(i));
+        EXPECT_EQ(size_t(i), result.first->Key);
+        // An entry we just saw must stay visible across resizes.
+        EXPECT_EQ(result.first, Map.find(size_t(i)));
+      }
+      return nullptr;
+    }
+  );
+
+  for (int i = 0; i < numElem; i++) {
+    auto entry = Map.find(size_t(i));
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(size_t(i), entry->Key);
+  }
+  EXPECT_FALSE(Map.find(size_t(numElem)));
+}
+
+// Lookup throughput of ConcurrentMap with increasing numbers of threads.
+// This is a benchmark rather than a test, so it is disabled by default; run
+// it with --gtest_also_run_disabled_tests.
+TEST(Concurrent, DISABLED_ConcurrentMapLookupThroughput) {
+  const size_t numElem = 20000;
+  const size_t lookupsPerThread = 2000000;
+
+  struct Entry {
+    const void *Key;
+    Entry(const void *key) : Key(key) {}
+    int compareWithKey(const void *key) const {
+      return (key == Key ? 0 : (key < Key ? -1 : 1));
+    }
+    static size_t getKeyHash(const void *key) {
+      size_t H = uintptr_t(key) >> 3;
+      H *= 0x27d4eb2d;
+      return H ^ (H >> 15);
+    }
+    static size_t getExtraAllocationSize(const void *key) { return 0; }
+  };
+
+  // Use pointer-like keys, which is what the metadata and conformance
+  // caches are keyed on.
+  std::vector<uint64_t> keyStorage(numElem);
+  ConcurrentMap<Entry> Map;
+  for (auto &key : keyStorage)
+    Map.getOrInsert(static_cast<const void *>(&key));
+
+  for (unsigned numThreads = 1; numThreads <= 64; numThreads *= 2) {
+    std::atomic<size_t> found(0);
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t] {
+        size_t localFound = 0;
+        size_t index = t * 7919;
+        for (size_t i = 0; i < lookupsPerThread; ++i) {
+          index = (index + 104729) % numElem;
+          if (Map.find(static_cast<const void *>(&keyStorage[index])))
+            ++localFound;
+        }
+        found += localFound;
+      });
+    }
+    for (auto &thread : threads)
+      thread.join();
+
+    auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(size_t(numThreads) * lookupsPerThread, found.load());
+    printf("%2u threads: %8.1f M lookups/s\n", numThreads,
+           numThreads * lookupsPerThread / elapsed / 1e6);
+  }
+}
+
 
 TEST(MetadataAllocator, alloc_firstAllocationMoreThanPageSized) {
   using swift::MetadataAllocator;
@@ -266,6 +364,66 @@ TEST(MetadataAllocator, alloc_firstAllocationMoreThanPageSized) {
   munmap(page, pagesize);
 }
 
+TEST(MetadataAllocator, alloc_concurrentStatistics) {
+  using swift::MetadataAllocator;
+  static swift::MetadataCacheStatistics stats;
+
+  MetadataAllocationStatistics before;
+  swift_getMetadataAllocationStatistics(&before);
+
+  // Allocate from several threads at once through allocators sharing a
+  // statistics record, and make sure no two allocations overlap.
+  constexpr unsigned numAllocations = 1000;
+  auto results = RaceTest<char**, 8>([]() -> char** {
+    MetadataAllocator allocator;
+    allocator.setStatistics(&stats);
+    auto allocations = new char*[numAllocations];
+    for (unsigned i = 0; i < numAllocations; ++i) {
+      auto mem = (char*) allocator.alloc(24);
+      EXPECT_EQ(uintptr_t(mem) & (sizeof(void*) - 1), uintptr_t(0));
+      memset(mem, 0xA5, 24);
+      allocations[i] = mem;
+    }
+    return allocations;
+  });
+
+  std::vector<char*> all;
+  for (auto allocations : results) {
+    all.insert(all.end(), allocations, allocations + numAllocations);
+    delete [] allocations;
+  }
+  std::sort(all.begin(), all.end());
+  for (size_t i = 1; i < all.size(); ++i)
+    EXPECT_GE(all[i] - all[i-1], 24);
+
+  size_t expectedBytes = results.size() * numAllocations * 24;
+  EXPECT_EQ(expectedBytes, stats.NumBytes.load());
+
+  MetadataAllocationStatistics after;
+  swift_getMetadataAllocationStatistics(&after);
+  EXPECT_GE(after.BytesAllocated - before.BytesAllocated, expectedBytes);
+  EXPECT_GE(after.BytesReserved, after.BytesAllocated);
+  EXPECT_GT(after.NumSlabs, before.NumSlabs);
+}
+
+TEST(MetadataAllocator, enumerateCacheStatistics) {
+  // Instantiating a tuple type creates the tuple cache, which should then
+  // be reported with at least one entry.
+  const Metadata *elts[] = { &_TMBi64_ };
+  swift_getTupleTypeMetadata(1, elts, nullptr, nullptr);
+
+  bool foundTuples = false;
+  swift_enumerateMetadataCacheStatistics(
+    [](void *context, const char *name, size_t numEntries, size_t numBytes) {
+      if (strcmp(name, "TupleCache") != 0)
+        return;
+      EXPECT_GE(numEntries, size_t(1));
+      EXPECT_GT(numBytes, size_t(0));
+      *static_cast<bool*>(context) = true;
+    }, &foundTuples);
+  EXPECT_TRUE(foundTuples);
+}
+
 TEST(MetadataTest, getGenericMetadata) {
   auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
 
@@ -13,6 +13,14 @@
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "gtest/gtest.h"
+#include <chrono>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
 
 using namespace swift;
 
@@ -152,3 +160,156 @@ TEST(RefcountingTest, unowned_retain_release_n) {
   swift_release(object);
   EXPECT_EQ(1u, value);
 }
+
+TEST(RefcountingTest, weak_load_after_release) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  WeakReference ref;
+  swift_weakInit(&ref, object);
+
+  auto loaded = swift_weakLoadStrong(&ref);
+  EXPECT_EQ(object, loaded);
+  swift_release(loaded);
+  EXPECT_EQ(0u, value);
+
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref));
+  swift_weakDestroy(&ref);
+}
+
+TEST(RefcountingTest, weak_copy_take_assign) {
+  size_t value1 = 0, value2 = 0;
+  auto object1 = allocTestObject(&value1, 1);
+  auto object2 = allocTestObject(&value2, 2);
+
+  WeakReference ref1, ref2, ref3;
+  swift_weakInit(&ref1, object1);
+  swift_weakCopyInit(&ref2, &ref1);
+  swift_weakTakeInit(&ref3, &ref2);
+
+  auto loaded = swift_weakTakeStrong(&ref3);
+  EXPECT_EQ(object1, loaded);
+  swift_release(loaded);
+
+  swift_weakInit(&ref2, object2);
+  swift_weakCopyAssign(&ref1, &ref2);
+  loaded = swift_weakLoadStrong(&ref1);
+  EXPECT_EQ(object2, loaded);
+  swift_release(loaded);
+
+  swift_release(object1);
+  EXPECT_EQ(1u, value1);
+  swift_release(object2);
+  EXPECT_EQ(2u, value2);
+
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref1));
+  EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref2));
+  swift_weakDestroy(&ref1);
+  swift_weakDestroy(&ref2);
+}
+
+TEST(RefcountingTest, weak_does_not_hold_memory) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  WeakReference ref;
+  swift_weakInit(&ref, object);
+
+#if SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE
+  // Weak references point at the side table entry, not the object, so they
+  // don't keep the object's memory alive.
+  EXPECT_EQ(1u, swift_unownedRetainCount(object));
+#else
+  // Each weak reference holds an unowned retain on the object.
+  EXPECT_EQ(2u, swift_unownedRetainCount(object));
+#endif
+
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+  EXPECT_EQ(nullptr, swift_weakTakeStrong(&ref));
+}
+
+/// A large object, so that memory kept alive by dead objects shows up in the
+/// malloc statistics.
+static const size_t BlobSize = 16 * 1024;
+
+static void destroyBlob(HeapObject *object) {
+  swift_deallocObject(object, BlobSize, alignof(HeapObject) - 1);
+}
+
+static const FullMetadata<ClassMetadata> BlobClassMetadata = {
+  { { &destroyBlob }, { &_TWVBo } },
+  { { { MetadataKind::Class } }, 0, /*rodata*/ 1,
+  ClassFlags::UsesSwift1Refcounting, nullptr, 0, 0, 0, 0, 0 }
+};
+
+/// \returns the number of bytes currently allocated with malloc, or 0 if
+/// that isn't known on this platform.
+static size_t getMallocBytesInUse() {
+#if defined(__APPLE__)
+  malloc_statistics_t stats;
+  malloc_zone_statistics(nullptr, &stats);
+  return stats.size_in_use;
+#elif defined(__GLIBC__)
+  return size_t(unsigned(mallinfo().uordblks));
+#else
+  return 0;
+#endif
+}
+
+// Models a cache that refers to objects only weakly, and reports how much
+// memory the dead objects still hold and how long the weak reference entry
+// points take. Run it against runtimes built with and without
+// SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE to compare the two schemes.
+// This is a benchmark rather than a test, so it is disabled by default; run
+// it with --gtest_also_run_disabled_tests.
+TEST(RefcountingTest, DISABLED_weak_footprint_and_latency) {
+  const unsigned numObjects = 2000;
+  std::vector<WeakReference> refs(numObjects);
+  using Clock = std::chrono::steady_clock;
+  auto nsPerRef = [&](Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(
+             Clock::now() - start).count() / numObjects;
+  };
+
+  size_t bytesBefore = getMallocBytesInUse();
+  auto start = Clock::now();
+  for (auto &ref : refs) {
+    auto object = swift_allocObject(&BlobClassMetadata, BlobSize,
+                                    alignof(HeapObject) - 1);
+    swift_weakInit(&ref, object);
+    swift_release(object);
+  }
+  double initNs = nsPerRef(start);
+  size_t bytesAfter = getMallocBytesInUse();
+  size_t bytesHeld = bytesAfter > bytesBefore ? bytesAfter - bytesBefore : 0;
+
+  start = Clock::now();
+  for (auto &ref : refs)
+    EXPECT_EQ(nullptr, swift_weakLoadStrong(&ref));
+  double loadNs = nsPerRef(start);
+
+  start = Clock::now();
+  for (auto &ref : refs)
+    swift_weakDestroy(&ref);
+  double destroyNs = nsPerRef(start);
+
+#if SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE
+  const char *scheme = "side table";
+#else
+  const char *scheme = "unowned retain";
+#endif
+  printf("%s: %zu KB held by %u dead objects; per reference: "
+         "%.1f ns init, %.1f ns load, %.1f ns destroy\n",
+         scheme, bytesHeld / 1024, numObjects, initNs, loadNs, destroyNs);
+
+  if (!bytesBefore && !bytesAfter)
+    return;
+#if SWIFT_RUNTIME_ENABLE_WEAK_SIDE_TABLE
+  // Only the side table entries outlive the objects.
+  EXPECT_LT(bytesHeld, numObjects * BlobSize / 4);
+#else
+  // Every dead object stays allocated until its weak reference is cleared.
+  EXPECT_GE(bytesHeld, numObjects * BlobSize);
+#endif
+}